@@ -0,0 +1,1152 @@
+#include "YokelGraph/AsyncTrace.hpp"
+#include "YokelGraph/Graph.hpp"
+#include "YokelGraph/MappedGraph.hpp"
+#include "test_graphs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <filesystem>
+#include <latch>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <fmt/format.h>
+#include <sys/resource.h>
+
+/*
+  Every heap allocation made by the process is counted, so the suite can
+  report allocations per query. The aligned forms are replaced too, as the
+  path cache allocates its shards over-aligned.
+*/
+static std::atomic<std::size_t> heap_allocations{0};
+
+void* operator new(std::size_t size) {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc((size) ? size : 1)) { return p; }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto align = static_cast<std::size_t>(alignment);
+  if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) { return p; }
+  throw std::bad_alloc();
+}
+
+// These pair with the malloc-backed operator new above, but once GCC inlines
+// them it sees free() on memory from a new-expression and warns. The pairing
+// is correct, so the warning is silenced for these definitions only.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+namespace {
+
+/*
+  The recursive all-simple-paths search that graph_c::find used before
+  it became a breadth-first search. Kept here, outside of the library,
+  so the two engines can be compared on the same inputs.
+*/
+class legacy_graph_c {
+public:
+  bool build_from(const test_data_t& source) {
+    for(auto& node : source.nodes) {
+      _nodes.emplace(node, node_s{node, {}, false});
+    }
+    for(auto& edge : source.edges) {
+      auto from = _nodes.find(edge.from);
+      auto to = _nodes.find(edge.to);
+      if (from == _nodes.end() || to == _nodes.end()) { return false; }
+      from->second.out.push_back(&to->second);
+    }
+    return true;
+  }
+
+  std::size_t trace(const std::string& from, const std::string& to) {
+    if (_nodes.find(from) == _nodes.end()) { return 0; }
+    if (_nodes.find(to) == _nodes.end()) { return 0; }
+    path_t path;
+    if (!find(from, to, path)) { return 0; }
+    return (path.empty()) ? 1 : path.size();
+  }
+
+private:
+  struct node_s {
+    std::string id;
+    std::vector<node_s*> out;
+    bool marked{false};
+  };
+  using path_t = std::vector<node_s*>;
+
+  std::map<std::string, node_s> _nodes;
+
+  bool find(const std::string& from, const std::string& to, path_t& path) {
+    auto& node = _nodes[from];
+    if (node.marked) { return false; }
+    path.push_back(&node);
+    if (node.id == to) { return true; }
+
+    std::vector<path_t> traversed_path;
+    traversed_path.reserve(node.out.size());
+    node.marked = true;
+    for(auto* neighbor : node.out) {
+      path_t current_path;
+      current_path.reserve(path.capacity());
+      if (find(neighbor->id, to, current_path)) {
+        traversed_path.push_back({current_path});
+      }
+      for(auto* x : current_path) { x->marked = false; }
+    }
+    node.marked = false;
+
+    if (traversed_path.empty()) {
+      path.pop_back();
+      return false;
+    }
+    std::size_t idx{0};
+    for(std::size_t i = 1; i < traversed_path.size(); i++) {
+      if (traversed_path[i].size() < traversed_path[idx].size()) { idx = i; }
+    }
+    path.insert(path.end(), traversed_path[idx].begin(), traversed_path[idx].end());
+    return true;
+  }
+};
+
+using query_t = std::pair<std::string, std::string>;
+
+struct workload_s {
+  std::string name;
+  test_data_t data;
+  std::vector<query_t> queries;
+  bool run_legacy{true};
+};
+
+//! \brief One root fanning out to `mids` nodes, each of which fans
+//!        out to `leaves` nodes. Every node has exactly one simple path
+//!        from the root, so the legacy engine finishes in linear time.
+workload_s make_fan_out(std::size_t mids, std::size_t leaves) {
+  workload_s w;
+  w.name = fmt::format("fan-out {}x{}", mids, leaves);
+  w.data.nodes.push_back("root");
+  for(std::size_t m = 0; m < mids; m++) {
+    auto mid = fmt::format("m{}", m);
+    w.data.nodes.push_back(mid);
+    w.data.edges.push_back({"root", mid, ""});
+    for(std::size_t l = 0; l < leaves; l++) {
+      auto leaf = fmt::format("m{}l{}", m, l);
+      w.data.nodes.push_back(leaf);
+      w.data.edges.push_back({mid, leaf, ""});
+    }
+  }
+  for(std::size_t m = 0; m < mids; m += mids / 8) {
+    w.queries.push_back({"root", fmt::format("m{}l{}", m, leaves - 1)});
+  }
+  return w;
+}
+
+//! \brief Uniformly random out-edges (no duplicate pairs)
+workload_s make_random(std::size_t nodes, std::size_t degree, bool run_legacy) {
+  workload_s w;
+  w.name = fmt::format("random {} nodes x{} out", nodes, degree);
+  w.run_legacy = run_legacy;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<std::size_t> pick(0, nodes - 1);
+  for(std::size_t i = 0; i < nodes; i++) {
+    w.data.nodes.push_back(std::to_string(i));
+  }
+  for(std::size_t i = 0; i < nodes; i++) {
+    std::vector<std::size_t> used;
+    while (used.size() < degree) {
+      auto j = pick(rng);
+      if (j == i || std::find(used.begin(), used.end(), j) != used.end()) { continue; }
+      used.push_back(j);
+      w.data.edges.push_back({w.data.nodes[i], w.data.nodes[j], ""});
+    }
+  }
+  for(std::size_t q = 0; q < 16; q++) {
+    w.queries.push_back({w.data.nodes[pick(rng)], w.data.nodes[pick(rng)]});
+  }
+  return w;
+}
+
+//! \brief Preferential attachment: each new node links to `degree`
+//!        earlier nodes picked in proportion to their degree, in a random
+//!        direction, which gives a few hubs and a long tail
+workload_s make_power_law(std::size_t nodes, std::size_t degree) {
+  workload_s w;
+  w.name = fmt::format("power-law {} nodes x{}", nodes, degree);
+  w.run_legacy = false;
+  std::mt19937 rng(4321);
+  std::vector<std::size_t> ends;
+  for(std::size_t i = 0; i < nodes; i++) {
+    w.data.nodes.push_back(std::to_string(i));
+    std::vector<std::size_t> used;
+    for(std::size_t k = 0; k < std::min(degree, i); k++) {
+      std::size_t j = (ends.empty()) ? 0 : ends[rng() % ends.size()];
+      if (std::find(used.begin(), used.end(), j) != used.end()) { continue; }
+      used.push_back(j);
+      if (rng() % 2) {
+        w.data.edges.push_back({w.data.nodes[i], w.data.nodes[j], ""});
+      } else {
+        w.data.edges.push_back({w.data.nodes[j], w.data.nodes[i], ""});
+      }
+      ends.push_back(i);
+      ends.push_back(j);
+    }
+    if (i == 1 && ends.empty()) {
+      w.data.edges.push_back({w.data.nodes[0], w.data.nodes[1], ""});
+      ends.push_back(0);
+      ends.push_back(1);
+    }
+  }
+  return w;
+}
+
+//! \brief A grid with edges both ways between horizontal and vertical
+//!        neighbors. Paths are long and many are tied
+workload_s make_grid(std::size_t width, std::size_t height) {
+  workload_s w;
+  w.name = fmt::format("grid {}x{}", width, height);
+  w.run_legacy = false;
+  auto at = [&](std::size_t x, std::size_t y) { return w.data.nodes[y * width + x]; };
+  for(std::size_t i = 0; i < width * height; i++) {
+    w.data.nodes.push_back(std::to_string(i));
+  }
+  for(std::size_t y = 0; y < height; y++) {
+    for(std::size_t x = 0; x < width; x++) {
+      if (x + 1 < width) {
+        w.data.edges.push_back({at(x, y), at(x + 1, y), ""});
+        w.data.edges.push_back({at(x + 1, y), at(x, y), ""});
+      }
+      if (y + 1 < height) {
+        w.data.edges.push_back({at(x, y), at(x, y + 1), ""});
+        w.data.edges.push_back({at(x, y + 1), at(x, y), ""});
+      }
+    }
+  }
+  return w;
+}
+
+//! \brief One directed chain, the deepest graph per edge there is
+workload_s make_chain(std::size_t nodes) {
+  workload_s w;
+  w.name = fmt::format("chain {}", nodes);
+  w.run_legacy = false;
+  for(std::size_t i = 0; i < nodes; i++) {
+    w.data.nodes.push_back(std::to_string(i));
+    if (i) { w.data.edges.push_back({w.data.nodes[i - 1], w.data.nodes[i], ""}); }
+  }
+  return w;
+}
+
+//! \brief Every ordered pair of distinct nodes, the densest graph there is
+workload_s make_clique(std::size_t nodes) {
+  workload_s w;
+  w.name = fmt::format("clique {}", nodes);
+  w.run_legacy = false;
+  for(std::size_t i = 0; i < nodes; i++) {
+    w.data.nodes.push_back(std::to_string(i));
+  }
+  for(std::size_t i = 0; i < nodes; i++) {
+    for(std::size_t j = 0; j < nodes; j++) {
+      if (i != j) { w.data.edges.push_back({w.data.nodes[i], w.data.nodes[j], ""}); }
+    }
+  }
+  return w;
+}
+
+workload_s make_test_graphs() {
+  workload_s w;
+  w.name = "test.cpp graphs (merged)";
+  std::size_t graph_idx{0};
+  for(auto graph_fn : {
+      graph_one, graph_two, graph_three, graph_four,
+      graph_five, graph_six, graph_seven }) {
+    auto graph = graph_fn();
+    auto prefix = fmt::format("g{}.", graph_idx++);
+    for(auto& node : graph.data.nodes) {
+      w.data.nodes.push_back(prefix + node);
+    }
+    for(auto& edge : graph.data.edges) {
+      w.data.edges.push_back({prefix + edge.from, prefix + edge.to, edge.data});
+    }
+    for(auto& path : graph.paths) {
+      w.queries.push_back({prefix + path.from, prefix + path.to});
+    }
+  }
+  return w;
+}
+
+template<class Fn>
+double ns_per_query(const workload_s& w, std::size_t rounds, Fn&& fn) {
+  std::size_t checksum{0};
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t r = 0; r < rounds; r++) {
+    for(auto& [from, to] : w.queries) {
+      checksum += fn(from, to);
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  if (checksum == std::numeric_limits<std::size_t>::max()) { fmt::print(" "); }
+  const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  return ns / static_cast<double>(rounds * w.queries.size());
+}
+
+//! \brief Per-query latency distribution and heap allocations
+struct latency_s {
+  double mean{0};
+  double p50{0};
+  double p99{0};
+  double allocations{0};
+};
+
+template<class Fn>
+latency_s measure(const std::vector<query_t>& queries, std::size_t passes, Fn&& fn) {
+  std::vector<double> samples;
+  samples.reserve(queries.size() * passes);
+  std::size_t checksum{0};
+
+  const auto allocations = heap_allocations.load(std::memory_order_relaxed);
+  for(std::size_t pass = 0; pass < passes; pass++) {
+    for(auto& [from, to] : queries) {
+      const auto start = std::chrono::steady_clock::now();
+      checksum += fn(from, to);
+      const auto end = std::chrono::steady_clock::now();
+      samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+  }
+  const auto allocated = heap_allocations.load(std::memory_order_relaxed) - allocations;
+  if (checksum == std::numeric_limits<std::size_t>::max()) { fmt::print(" "); }
+  if (samples.empty()) { return {}; }
+
+  latency_s result;
+  for(auto& ns : samples) { result.mean += ns; }
+  result.mean /= static_cast<double>(samples.size());
+  std::sort(samples.begin(), samples.end());
+  result.p50 = samples[samples.size() / 2];
+  result.p99 = samples[samples.size() * 99 / 100];
+  result.allocations = static_cast<double>(allocated) / static_cast<double>(samples.size());
+  return result;
+}
+
+//! \brief Largest resident set the process has had so far, in MiB
+double peak_rss_mib() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024.0;
+}
+
+void print_latency(const std::string& name, const std::string& what, const latency_s& l) {
+  fmt::print("{:<32} {:<24} {:>10.0f} ns/query  p50 {:>9.0f}  p99 {:>10.0f}  {:>6.2f} allocs/query\n",
+      name, what, l.mean, l.p50, l.p99, l.allocations);
+}
+
+//! \brief One row per measure, for a generated graph: build and cycle
+//!        check times, then trace with the cache off and on (with and
+//!        without optimize_trace, which only acts on a cache) and
+//!        load_edges, over the same repeated stream of random pairs
+void run_suite(workload_s w, std::size_t pairs, std::size_t passes) {
+  std::mt19937 rng(99);
+  std::uniform_int_distribution<std::size_t> pick(0, w.data.nodes.size() - 1);
+  std::vector<query_t> queries;
+  for(std::size_t i = 0; i < pairs; i++) {
+    queries.push_back({w.data.nodes[pick(rng)], w.data.nodes[pick(rng)]});
+  }
+
+  test_graph_t graph(false);
+  const auto build_start = std::chrono::steady_clock::now();
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  const auto build_end = std::chrono::steady_clock::now();
+  const bool cyclic = graph.contains_cycles();
+  const auto cycles_end = std::chrono::steady_clock::now();
+  fmt::print("{:<32} {:>8} nodes {:>9} edges {:>10.1f} ms build_from {:>8.1f} ms contains_cycles ({}) {:>8.1f} MiB peak RSS\n",
+      w.name, w.data.nodes.size(), w.data.edges.size(),
+      std::chrono::duration<double, std::milli>(build_end - build_start).count(),
+      std::chrono::duration<double, std::milli>(cycles_end - build_end).count(),
+      cyclic, peak_rss_mib());
+
+  auto traced = [&](auto& from, auto& to) -> std::size_t {
+    auto path = graph.trace(from, to);
+    return (path.has_value()) ? path->size() : 0;
+  };
+  print_latency(w.name, "trace, cache off", measure(queries, passes, traced));
+
+  graph.toggle_cache(true);
+  print_latency(w.name, "trace, cache on", measure(queries, passes, traced));
+
+  // A pass to learn the average path length from, then a cold cache
+  measure(queries, 1, traced);
+  graph.optimize_trace();
+  graph.clear_cache();
+  print_latency(w.name, "trace, cache + optimize", measure(queries, passes, traced));
+
+  std::vector<test_graph_t::node_list_t> paths;
+  for(auto& [from, to] : queries) {
+    if (auto path = graph.trace(from, to); path.has_value() && path->size() > 1) {
+      paths.push_back(*path);
+    }
+  }
+  std::size_t next{0};
+  print_latency(w.name, "load_edges", measure(queries, passes, [&](auto&, auto&) -> std::size_t {
+    if (paths.empty()) { return 0; }
+    return graph.load_edges(paths[next++ % paths.size()])->size();
+  }));
+}
+
+void run(const workload_s& w, std::size_t rounds) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+
+  // Cross check the engines before timing them
+  legacy_graph_c legacy;
+  if (w.run_legacy) {
+    legacy.build_from(w.data);
+  }
+  for(auto& [from, to] : w.queries) {
+    graph.set_search_strategy(test_graph_t::search_strategy_e::BREADTH_FIRST);
+    auto path = graph.trace(from, to);
+    graph.set_search_strategy(test_graph_t::search_strategy_e::BIDIRECTIONAL);
+    auto other = graph.trace(from, to);
+    auto len = (path.has_value()) ? path->size() : 0;
+    if (len != ((other.has_value()) ? other->size() : 0) ||
+        (w.run_legacy && len != legacy.trace(from, to))) {
+      fmt::print(stderr, "Engines disagree on {} -> {} in {}\n", from, to, w.name);
+    }
+  }
+
+  auto traced = [&](auto& from, auto& to) -> std::size_t {
+    auto path = graph.trace(from, to);
+    return (path.has_value()) ? path->size() : 0;
+  };
+
+  graph.set_search_strategy(test_graph_t::search_strategy_e::BREADTH_FIRST);
+  const double bfs_ns = ns_per_query(w, rounds, traced);
+
+  graph.set_search_strategy(test_graph_t::search_strategy_e::BIDIRECTIONAL);
+  const double bidir_ns = ns_per_query(w, rounds, traced);
+
+  auto frozen = graph.freeze();
+  test_graph_t::frozen_t::path_t frozen_path;
+  const double frozen_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    return (frozen.trace(from, to, frozen_path)) ? frozen_path.size() : 0;
+  });
+
+  // Unit costs, so the weighted searches do the same work as bfs plus the heap
+  auto unit_cost = [](const std::string&) { return 1u; };
+  const double dijkstra_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    auto path = graph.trace_weighted(from, to, unit_cost);
+    return (path.has_value()) ? path->nodes.size() : 0;
+  });
+  const double frozen_dijkstra_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    auto cost = frozen.trace_weighted(*frozen.index_of(from), *frozen.index_of(to), unit_cost, frozen_path);
+    return (cost.has_value()) ? frozen_path.size() : 0;
+  });
+
+  // Edge lookups only, over paths traced ahead of time
+  std::vector<test_graph_t::node_list_t> paths;
+  for(auto& [from, to] : w.queries) {
+    if (auto path = graph.trace(from, to); path.has_value() && path->size() > 1) {
+      paths.push_back(*path);
+    }
+  }
+  std::size_t hops{0};
+  const auto edges_start = std::chrono::steady_clock::now();
+  for(std::size_t r = 0; r < rounds * 100; r++) {
+    for(auto& path : paths) {
+      hops += graph.load_edges(path)->size();
+    }
+  }
+  const auto edges_end = std::chrono::steady_clock::now();
+  const double edge_ns = (hops) ?
+    std::chrono::duration<double, std::nano>(edges_end - edges_start).count() / hops : 0;
+
+  // The same lookups over indexed paths, which are a plain gather
+  std::vector<test_graph_t::indexed_path_s> indexed(paths.size());
+  for(std::size_t i = 0; i < paths.size(); i++) {
+    graph.trace_indexed(*paths[i].front()->data(), *paths[i].back()->data(), indexed[i]);
+  }
+  test_graph_t::edge_list_t gathered;
+  std::size_t indexed_hops{0};
+  const auto gather_start = std::chrono::steady_clock::now();
+  for(std::size_t r = 0; r < rounds * 100; r++) {
+    for(auto& path : indexed) {
+      graph.load_edges(path, gathered);
+      indexed_hops += gathered.size();
+    }
+  }
+  const auto gather_end = std::chrono::steady_clock::now();
+  const double gather_ns = (indexed_hops) ?
+    std::chrono::duration<double, std::nano>(gather_end - gather_start).count() / indexed_hops : 0;
+
+  fmt::print("{:<32} {:>8} edges {:>12.1f} ns (bfs) {:>12.1f} ns (bidirectional) {:>12.1f} ns (frozen) {:>12.1f} ns (dijkstra) {:>12.1f} ns (frozen dijkstra) {:>6.1f} ns/hop (load_edges) {:>6.1f} ns/hop (indexed)",
+      w.name, w.data.edges.size(), bfs_ns, bidir_ns, frozen_ns, dijkstra_ns, frozen_dijkstra_ns, edge_ns, gather_ns);
+
+  if (!w.run_legacy) {
+    fmt::print(" {:>12} (legacy)\n", "skipped");
+    return;
+  }
+
+  const double legacy_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) {
+    return legacy.trace(from, to);
+  });
+  fmt::print(" {:>12.1f} ns (legacy)\n", legacy_ns);
+}
+
+//! \brief Build time and lookup-dominated (single hop) trace time
+//!        for one node storage policy
+template<class GRAPH>
+void run_storage(const std::string& policy, const workload_s& w, std::size_t lookups) {
+  GRAPH graph(false);
+  const auto build_start = std::chrono::steady_clock::now();
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  const auto build_end = std::chrono::steady_clock::now();
+
+  std::size_t checksum{0};
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t i = 0; i < lookups; i++) {
+    auto& edge = w.data.edges[(i * 7919) % w.data.edges.size()];
+    auto path = graph.trace(edge.from, edge.to);
+    checksum += (path.has_value()) ? path->size() : 0;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  if (checksum != lookups * 2) {
+    fmt::print(stderr, "Unexpected single hop results for {}\n", policy);
+  }
+
+  fmt::print("{:<32} {:>8} nodes {:>12.1f} ms (build_from) {:>12.1f} ns/query (single hop, {} storage)\n",
+      w.name, w.data.nodes.size(),
+      std::chrono::duration<double, std::milli>(build_end - build_start).count(),
+      std::chrono::duration<double, std::nano>(end - start).count() / lookups,
+      policy);
+}
+
+//! \brief The same single hop lookups with the numeric names of a random
+//!        workload as integral identifiers, under each storage policy
+template<class STORAGE>
+void run_integral(const std::string& policy, const workload_s& w, std::size_t lookups) {
+  yokel::graph_c<std::uint32_t, std::uint32_t, STORAGE> graph(false);
+  yokel::graph_source_s<std::uint32_t, std::uint32_t> source;
+  for(auto& node : w.data.nodes) {
+    source.nodes.push_back(static_cast<std::uint32_t>(std::stoul(node)));
+  }
+  for(std::size_t i = 0; i < w.data.edges.size(); i++) {
+    source.edges.push_back({static_cast<std::uint32_t>(std::stoul(w.data.edges[i].from)),
+                            static_cast<std::uint32_t>(std::stoul(w.data.edges[i].to)),
+                            static_cast<std::uint32_t>(i)});
+  }
+
+  const auto build_start = std::chrono::steady_clock::now();
+  if (!graph.build_from(std::move(source))) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  const auto build_end = std::chrono::steady_clock::now();
+
+  std::size_t checksum{0};
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t i = 0; i < lookups; i++) {
+    auto& edge = w.data.edges[(i * 7919) % w.data.edges.size()];
+    auto path = graph.trace(std::stoul(edge.from), std::stoul(edge.to));
+    checksum += (path.has_value()) ? path->size() : 0;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  if (checksum != lookups * 2) {
+    fmt::print(stderr, "Unexpected single hop results for {}\n", policy);
+  }
+
+  fmt::print("{:<32} {:>8} nodes {:>12.1f} ms (build_from) {:>12.1f} ns/query (single hop, uint32 ids, {} storage)\n",
+      w.name, w.data.nodes.size(),
+      std::chrono::duration<double, std::milli>(build_end - build_start).count(),
+      std::chrono::duration<double, std::nano>(end - start).count() / lookups,
+      policy);
+}
+
+//! \brief Aggregate trace throughput with several threads sharing one graph
+// Streams edges ahead of their nodes, as a file with the edge list first
+// would, against build_from on the same data
+template<class GRAPH>
+void run_stream(const std::string& policy, const workload_s& w) {
+  GRAPH graph(false);
+  const auto start = std::chrono::steady_clock::now();
+  const bool built = graph.stream_from(w.data.nodes.size(), w.data.edges.size(), [&](auto& builder) {
+    for(auto& edge : w.data.edges) {
+      builder.add_edge(edge.from, edge.to, edge.data);
+    }
+    for(auto& node : w.data.nodes) {
+      builder.add_node(node);
+    }
+  });
+  const auto end = std::chrono::steady_clock::now();
+  if (!built) {
+    fmt::print(stderr, "Failed to stream {}\n", w.name);
+    return;
+  }
+  fmt::print("{:<32} {:>8} nodes {:>12.1f} ms (stream_from, edges first, {} storage)\n",
+      w.name, w.data.nodes.size(),
+      std::chrono::duration<double, std::milli>(end - start).count(), policy);
+
+  auto source = w.data;
+  GRAPH moved(false);
+  const auto move_start = std::chrono::steady_clock::now();
+  moved.build_from(std::move(source));
+  const auto move_end = std::chrono::steady_clock::now();
+  fmt::print("{:<32} {:>8} nodes {:>12.1f} ms (build_from, moved source, {} storage)\n",
+      w.name, w.data.nodes.size(),
+      std::chrono::duration<double, std::milli>(move_end - move_start).count(), policy);
+}
+
+// Removing a slice of the edges in place against rebuilding without them
+void run_removal(const workload_s& w, std::size_t removals) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  removals = std::min(removals, w.data.edges.size());
+
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t i = 0; i < removals; i++) {
+    auto& edge = w.data.edges[i];
+    graph.remove_edge(edge.from, edge.to);
+  }
+  const auto removed = std::chrono::steady_clock::now();
+  graph.compact();
+  const auto compacted = std::chrono::steady_clock::now();
+
+  test_data_t rest{w.data.nodes, {w.data.edges.begin() + static_cast<std::ptrdiff_t>(removals), w.data.edges.end()}};
+  test_graph_t rebuilt(false);
+  const auto rebuild_start = std::chrono::steady_clock::now();
+  rebuilt.build_from(rest);
+  const auto rebuild_end = std::chrono::steady_clock::now();
+
+  fmt::print("{:<32} {:>12.0f} ns/remove_edge ({} removed), {:.1f} ms compact, {:.1f} ms rebuild\n",
+      w.name,
+      std::chrono::duration<double, std::nano>(removed - start).count() / static_cast<double>(removals),
+      removals,
+      std::chrono::duration<double, std::milli>(compacted - removed).count(),
+      std::chrono::duration<double, std::milli>(rebuild_end - rebuild_start).count());
+}
+
+void run_threads(const workload_s& w, bool cache, std::size_t queries_per_thread) {
+  test_graph_t graph(cache);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  graph.set_search_strategy(test_graph_t::search_strategy_e::BIDIRECTIONAL);
+
+  const std::size_t max_threads = std::max<std::size_t>(8, std::thread::hardware_concurrency());
+  for(std::size_t count = 1; count <= max_threads; count *= 2) {
+    graph.clear_cache();
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for(std::size_t t = 0; t < count; t++) {
+      threads.emplace_back([&, t]() {
+        for(std::size_t i = 0; i < queries_per_thread; i++) {
+          auto& [from, to] = w.queries[(i + t) % w.queries.size()];
+          auto path = graph.trace(from, to);
+          (void)path;
+        }
+      });
+    }
+    for(auto& thread : threads) {
+      thread.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    fmt::print("{:<32} cache {:<3} {:>3} threads {:>14.0f} queries/s\n",
+        w.name, (cache) ? "on" : "off", count,
+        static_cast<double>(count * queries_per_thread) / seconds);
+  }
+}
+
+//! \brief Many pairs sharing a few sources, traced in a loop and as a batch
+void run_batch(const workload_s& w, std::size_t sources, std::size_t per_source) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+
+  std::mt19937 rng(99);
+  std::uniform_int_distribution<std::size_t> pick(0, w.data.nodes.size() - 1);
+  std::vector<test_graph_t::query_t> queries;
+  for(std::size_t s = 0; s < sources; s++) {
+    auto& from = w.data.nodes[pick(rng)];
+    for(std::size_t t = 0; t < per_source; t++) {
+      queries.push_back({from, w.data.nodes[pick(rng)]});
+    }
+  }
+
+  auto timed = [&](auto&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / queries.size();
+  };
+
+  const double loop_ns = timed([&]() {
+    for(auto& [from, to] : queries) {
+      auto path = graph.trace(from, to);
+      (void)path;
+    }
+  });
+  const double batch_ns = timed([&]() {
+    auto result = graph.trace_batch(queries);
+    (void)result;
+  });
+  yokel::thread_pool_c pool;
+  const double pool_ns = timed([&]() {
+    auto result = graph.trace_batch(queries, pool);
+    (void)result;
+  });
+
+  const double tree_ns = timed([&]() {
+    for(std::size_t s = 0; s < sources; s++) {
+      auto tree = graph.trace_all_from(queries[s * per_source].first);
+      for(std::size_t t = 0; t < per_source; t++) {
+        auto path = tree->path_to(queries[s * per_source + t].second);
+        (void)path;
+      }
+    }
+  });
+
+  fmt::print("{:<32} {:>6} queries {:>12.1f} ns (trace loop) {:>12.1f} ns (batch) {:>12.1f} ns (batch, {} threads) {:>12.1f} ns (trace_all_from)\n",
+      w.name, queries.size(), loop_ns, batch_ns, pool_ns, pool.size(), tree_ns);
+}
+
+template<class Fn>
+double ns_per_stream(const std::vector<std::size_t>& stream, Fn&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for(auto q : stream) {
+    fn(q);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(stream.size());
+}
+
+//! \brief Skewed query stream over a pool of pairs, traced through a
+//!        cache bounded to each of the given entry limits (0 = unbounded)
+void run_cache(const workload_s& w, std::size_t pairs, std::size_t queries,
+               const std::vector<std::size_t>& limits) {
+  test_graph_t graph(true);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  graph.set_search_strategy(test_graph_t::search_strategy_e::BIDIRECTIONAL);
+
+  std::mt19937 rng(99);
+  std::uniform_int_distribution<std::size_t> pick(0, w.data.nodes.size() - 1);
+  std::vector<query_t> pool;
+  for(std::size_t i = 0; i < pairs; i++) {
+    pool.push_back({w.data.nodes[pick(rng)], w.data.nodes[pick(rng)]});
+  }
+  std::geometric_distribution<std::size_t> skew(8.0 / static_cast<double>(pairs));
+  std::vector<std::size_t> stream;
+  for(std::size_t i = 0; i < queries; i++) {
+    stream.push_back(skew(rng) % pairs);
+  }
+
+  for(auto limit : limits) {
+    graph.set_cache_limits({limit, 0});
+    const auto before = graph.cache_stats();
+    const auto start = std::chrono::steady_clock::now();
+    for(auto q : stream) {
+      auto path = graph.trace(pool[q].first, pool[q].second);
+      (void)path;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const auto stats = graph.cache_stats();
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const auto hits = stats.hits - before.hits;
+    fmt::print("{:<32} cache limit {:>6} {:>10.0f} ns/query {:>6.1f}% hits {:>8} evictions {:>10} bytes\n",
+        w.name, (limit) ? std::to_string(limit) : "none", ns / static_cast<double>(queries),
+        100.0 * static_cast<double>(hits) / static_cast<double>(queries),
+        stats.evictions - before.evictions, stats.bytes);
+  }
+
+  // Every query hits from here on, copied out by trace or viewed by trace_view
+  graph.set_cache_limits({0, 0});
+  for(auto& [from, to] : pool) {
+    graph.trace(from, to);
+  }
+  std::size_t checksum{0};
+  const double copy_ns = ns_per_stream(stream, [&](std::size_t q) {
+    auto path = graph.trace(pool[q].first, pool[q].second);
+    checksum += (path.has_value()) ? path->size() : 0;
+  });
+  const double view_ns = ns_per_stream(stream, [&](std::size_t q) {
+    auto path = graph.trace_view(pool[q].first, pool[q].second);
+    checksum -= (path.has_value()) ? path->size() : 0;
+  });
+  if (checksum != 0) {
+    fmt::print(stderr, "trace and trace_view disagree on {}\n", w.name);
+  }
+  fmt::print("{:<32} cache hit {:>10.0f} ns/query (trace) {:>10.0f} ns/query (trace_view)\n",
+      w.name, copy_ns, view_ns);
+
+  for(auto& [from, to] : pool) {
+    graph.trace_with_edges(from, to);
+  }
+  const double load_ns = ns_per_stream(stream, [&](std::size_t q) {
+    auto path = graph.trace(pool[q].first, pool[q].second);
+    if (path.has_value() && path->size() > 1) {
+      checksum += graph.load_edges(*path)->size();
+    }
+  });
+  const double fused_ns = ns_per_stream(stream, [&](std::size_t q) {
+    auto path = graph.trace_with_edges(pool[q].first, pool[q].second);
+    if (path.has_value() && path->nodes.size() > 1) {
+      checksum -= path->edges.size();
+    }
+  });
+  if (checksum != 0) {
+    fmt::print(stderr, "trace_with_edges and load_edges disagree on {}\n", w.name);
+  }
+  fmt::print("{:<32} cache hit {:>10.0f} ns/query (trace + load_edges) {:>10.0f} ns/query (trace_with_edges)\n",
+      w.name, load_ns, fused_ns);
+}
+
+//! \brief Time contains_cycles, which finds the strongly connected components
+void run_cycles(const workload_s& w) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const bool cyclic = graph.contains_cycles();
+  const auto end = std::chrono::steady_clock::now();
+  fmt::print("{:<32} {:>12.1f} ms (contains_cycles, {} edges, {} components, cyclic: {})\n",
+      w.name, std::chrono::duration<double, std::milli>(end - start).count(),
+      w.data.edges.size(), graph.strongly_connected_components().size(), cyclic);
+}
+
+//! \brief Alternate routes: the k shortest simple paths, and every
+//!        fewest-hop path (counted, and enumerated up to a limit)
+void run_alternates(const workload_s& w, std::size_t k, std::size_t limit) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  std::size_t produced{0};
+  const double k_ns = ns_per_query(w, 1, [&](auto& from, auto& to) -> std::size_t {
+    auto paths = graph.trace_k(from, to, k);
+    if (!paths) { return 0; }
+    for(auto& path : *paths) {
+      produced += !path.nodes.empty();
+    }
+    return produced;
+  });
+  std::uint64_t counted{0};
+  std::size_t walked{0};
+  const double all_ns = ns_per_query(w, 1, [&](auto& from, auto& to) -> std::size_t {
+    auto paths = graph.trace_all_shortest(from, to);
+    if (!paths) { return 0; }
+    counted = std::max(counted, paths->count());
+    std::size_t n{0};
+    for(auto it = paths->begin(); it != paths->end() && n < limit; ++it) {
+      n++;
+    }
+    walked += n;
+    return n;
+  });
+
+  fmt::print("{:<32} {:>12.1f} ns (trace_k, k={}, {} paths) {:>12.1f} ns (trace_all_shortest, up to {} each, {} walked, most {})\n",
+      w.name, k_ns, k, produced, all_ns, limit, walked, counted);
+}
+
+//! \brief Coroutine that starts at once and frees itself when it ends
+struct detached_s {
+  struct promise_type {
+    detached_s get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+detached_s await_trace(yokel::async_tracer_c<test_graph_t>& tracer, const query_t& query,
+                       std::atomic<std::size_t>& found, std::latch& done) {
+  auto path = co_await tracer.trace_async(query.first, query.second);
+  found += path.has_value();
+  done.count_down();
+}
+
+//! \brief `copies` concurrent requests for each query, all issued at once
+//!        on a cold cache, so repeats merge into the search in flight
+void run_async(const workload_s& w, std::size_t copies, std::size_t threads) {
+  test_graph_t graph(true);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  yokel::thread_pool_c pool(threads);
+  yokel::async_tracer_c<test_graph_t> tracer(graph, pool);
+
+  std::atomic<std::size_t> found{0};
+  std::latch done(static_cast<std::ptrdiff_t>(copies * w.queries.size()));
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t c = 0; c < copies; c++) {
+    for(auto& query : w.queries) {
+      await_trace(tracer, query, found, done);
+    }
+  }
+  const auto issued = std::chrono::steady_clock::now();
+  done.wait();
+  const auto end = std::chrono::steady_clock::now();
+
+  const auto stats = tracer.stats();
+  fmt::print("{:<32} {:>8} requests {:>10.2f} ms to issue {:>10.2f} ms to answer ({} threads, {} searches, {} merged, {} immediate)\n",
+      w.name, stats.requests, std::chrono::duration<double, std::milli>(issued - start).count(),
+      std::chrono::duration<double, std::milli>(end - start).count(), pool.size(),
+      stats.searches, stats.merged, stats.immediate);
+}
+
+//! \brief First pass over the queries on a cold cache against one restored
+//!        from a cache file saved after the same pass
+void run_cache_file(const workload_s& w) {
+  const auto path = (std::filesystem::temp_directory_path() / "yokel_bench.paths").string();
+  using clock_t = std::chrono::steady_clock;
+  auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+  auto pass = [&](test_graph_t& graph) {
+    std::size_t found{0};
+    for(auto& [from, to] : w.queries) {
+      found += graph.trace(from, to).has_value();
+    }
+    return found;
+  };
+
+  test_graph_t graph(true);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  const auto cold_start = clock_t::now();
+  pass(graph);
+  const auto cold_end = clock_t::now();
+  graph.save_cache(path);
+  const auto save_end = clock_t::now();
+
+  test_graph_t restarted(true);
+  restarted.build_from(w.data);
+  const auto load_start = clock_t::now();
+  const bool loaded = restarted.load_cache(path);
+  const auto load_end = clock_t::now();
+  pass(restarted);
+  const auto warm_end = clock_t::now();
+
+  fmt::print("{:<32} {:>8} paths {:>10.2f} ms (cold pass) {:>8.2f} ms save {:>8.2f} ms load ({}) {:>8.2f} ms (restored pass, {} bytes)\n",
+      w.name, w.queries.size(), ms(cold_start, cold_end), ms(cold_end, save_end),
+      ms(load_start, load_end), loaded, ms(load_end, warm_end), std::filesystem::file_size(path));
+  std::filesystem::remove(path);
+}
+
+//! \brief trace against trace with the reachability index built, and reachable
+void run_reachability(const workload_s& w, std::size_t rounds) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  auto traced = [&](auto& from, auto& to) -> std::size_t {
+    return graph.trace(from, to).has_value();
+  };
+  const double plain_ns = ns_per_query(w, rounds, traced);
+
+  const auto start = std::chrono::steady_clock::now();
+  graph.index_reachability();
+  const double index_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  const double indexed_ns = ns_per_query(w, rounds, traced);
+
+  std::size_t reached{0};
+  const double reachable_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    const bool found = graph.reachable(from, to);
+    reached += found;
+    return found;
+  });
+
+  fmt::print("{:<32} {:>12.1f} ms (index) {:>12.1f} ns (trace) {:>12.1f} ns (trace, indexed) {:>12.1f} ns (reachable, {:.1f}% reached)\n",
+      w.name, index_ms, plain_ns, indexed_ns, reachable_ns,
+      100.0 * static_cast<double>(reached) / static_cast<double>(rounds * w.queries.size()));
+}
+
+//! \brief build_from on one thread against build_from on a pool
+template<class GRAPH>
+void run_parallel_build(const std::string& policy, const workload_s& w, std::size_t threads) {
+  yokel::thread_pool_c pool(threads);
+  auto timed = [&](auto&& build) {
+    GRAPH graph(false);
+    const auto start = std::chrono::steady_clock::now();
+    if (!build(graph)) {
+      fmt::print(stderr, "Failed to build {}\n", w.name);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  };
+  const double serial_ms = timed([&](GRAPH& graph) { return graph.build_from(w.data); });
+  const double parallel_ms = timed([&](GRAPH& graph) { return graph.build_from(w.data, pool); });
+
+  fmt::print("{:<32} {:>8} edges {:>12.1f} ms (build_from) {:>12.1f} ms (build_from, {} threads, {} storage)\n",
+      w.name, w.data.edges.size(), serial_ms, parallel_ms, pool.size() + 1, policy);
+}
+
+//! \brief Frozen trace against the bitmap direction-optimizing trace_wide
+//!        on the workload's queries, and a full reach from each source
+void run_wide(const workload_s& w, std::size_t rounds) {
+  test_graph_t graph(false);
+  if (!graph.build_from(w.data)) {
+    fmt::print(stderr, "Failed to build {}\n", w.name);
+    return;
+  }
+  auto frozen = graph.freeze();
+  test_graph_t::frozen_t::path_t path;
+
+  const double narrow_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    return (frozen.trace(from, to, path)) ? path.size() : 0;
+  });
+  const double wide_ns = ns_per_query(w, rounds, [&](auto& from, auto& to) -> std::size_t {
+    return (frozen.trace_wide(*frozen.index_of(from), *frozen.index_of(to), path)) ? path.size() : 0;
+  });
+  yokel::visit_bitmap_c reached;
+  std::size_t reach_count{0};
+  const double reach_ns = ns_per_query(w, rounds, [&](auto& from, auto&) -> std::size_t {
+    reach_count = frozen.reach(*frozen.index_of(from), reached);
+    return reach_count;
+  });
+
+  fmt::print("{:<32} {:>8} edges {:>12.1f} ns (frozen trace) {:>12.1f} ns (trace_wide) {:>12.1f} ns (reach, {} nodes, {})\n",
+      w.name, frozen.edge_count(), narrow_ns, wide_ns, reach_ns, reach_count,
+#ifdef GRAPH_SIMD_AVX2
+      "avx2");
+#else
+      "scalar");
+#endif
+}
+
+// Edge data has to be trivially copyable to go into a graph file, so the
+// workload's string edges are replaced by their position
+void run_mapped(const workload_s& w, std::size_t queries) {
+  using mapped_source_t = yokel::graph_c<std::string, std::uint32_t>;
+  mapped_source_t graph(false);
+  for(auto& node : w.data.nodes) {
+    graph.add_node(node);
+  }
+  std::uint32_t position{0};
+  for(auto& edge : w.data.edges) {
+    graph.add_edge(edge.from, edge.to, position++);
+  }
+
+  const auto path = (std::filesystem::temp_directory_path() / "yokel_bench.graph").string();
+  using clock_t = std::chrono::steady_clock;
+  auto ms = [](auto start, auto end) { return std::chrono::duration<double, std::milli>(end - start).count(); };
+
+  const auto write_start = clock_t::now();
+  if (!yokel::write_graph_file(graph, path)) {
+    fmt::print(stderr, "Failed to write {}\n", path);
+    return;
+  }
+  const auto open_start = clock_t::now();
+  auto mapped = yokel::mapped_graph_c<std::string, std::uint32_t>::open(path);
+  const auto open_end = clock_t::now();
+  if (!mapped) {
+    fmt::print(stderr, "Failed to map {}\n", path);
+    return;
+  }
+  const bool verified = mapped->verify();
+  const auto verify_end = clock_t::now();
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<std::size_t> pick(0, w.data.nodes.size() - 1);
+  yokel::mapped_graph_c<std::string, std::uint32_t>::path_t result;
+  std::size_t found{0};
+  const auto trace_start = clock_t::now();
+  for(std::size_t i = 0; i < queries; i++) {
+    found += mapped->trace(w.data.nodes[pick(rng)], w.data.nodes[pick(rng)], result);
+  }
+  const auto trace_end = clock_t::now();
+
+  fmt::print("{:<32} {:>12.1f} ms write, {:.3f} ms open, {:.1f} ms verify ({}), {:.0f} ns/trace ({} found, {} bytes)\n",
+      w.name, ms(write_start, open_start), ms(open_start, open_end), ms(open_end, verify_end), verified,
+      ms(trace_start, trace_end) * 1e6 / static_cast<double>(queries), found, std::filesystem::file_size(path));
+  std::filesystem::remove(path);
+}
+
+
+void run_suites() {
+  for(std::size_t scale : {1000, 100000}) {
+    run_suite(make_random(scale, 4, false), 500, 4);
+    run_suite(make_power_law(scale, 3), 500, 4);
+    const auto side = static_cast<std::size_t>(std::sqrt(static_cast<double>(scale)));
+    run_suite(make_grid(side, side), 500, 4);
+    run_suite(make_chain(scale), 200, 4);
+  }
+  run_suite(make_clique(64), 500, 4);
+  run_suite(make_clique(512), 500, 4);
+}
+
+} // namespace
+
+//! \brief Runs every benchmark, or with "suite" as the argument only the
+//!         generated graph suite (make bench-suite)
+int main(int argc, char** argv) {
+  run_suites();
+  if (argc > 1 && std::string(argv[1]) == "suite") { return 0; }
+
+  // Cache is disabled so that every query reaches the search engine
+  run(make_test_graphs(), 20000);
+  run(make_random(20, 3, true), 10);
+  run(make_fan_out(400, 300), 20);
+  run(make_random(20000, 6, false), 20);
+  run(make_random(30000, 20, false), 20);
+  run_wide(make_random(30000, 20, false), 20);
+
+  auto threaded = make_random(20000, 6, false);
+  run_threads(threaded, false, 2000);
+  run_threads(threaded, true, 200000);
+  run_batch(threaded, 100, 200);
+  run_alternates(threaded, 10, 1000);
+  run_reachability(threaded, 5);
+  run_cache_file(threaded);
+  run_async(threaded, 1000, 0);
+  run_cache(threaded, 4096, 200000, {0, 1024, 256, 64});
+
+  auto many_nodes = make_random(500000, 2, false);
+  run_storage<test_graph_t>("ordered", many_nodes, 1000000);
+  run_storage<yokel::graph_c<std::string, std::string, yokel::flat_storage_s>>(
+    "flat", many_nodes, 1000000);
+  run_integral<yokel::ordered_storage_s>("ordered", many_nodes, 1000000);
+  run_integral<yokel::flat_storage_s>("flat", many_nodes, 1000000);
+  run_integral<yokel::direct_storage_s>("direct", many_nodes, 1000000);
+  run_stream<test_graph_t>("ordered", many_nodes);
+  run_stream<yokel::graph_c<std::string, std::string, yokel::flat_storage_s>>("flat", many_nodes);
+  run_parallel_build<test_graph_t>("ordered", many_nodes, 0);
+  run_parallel_build<yokel::graph_c<std::string, std::string, yokel::flat_storage_s>>("flat", many_nodes, 0);
+  run_cycles(many_nodes);
+  run_wide(many_nodes, 5);
+  run_reachability(many_nodes, 2);
+  run_removal(many_nodes, 10000);
+  run_mapped(many_nodes, 500);
+  return 0;
+}
@@ -0,0 +1,286 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_ASYNC_TRACE_HPP
+#define YOKEL_ASYNC_TRACE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "EdgeIndex.hpp"
+#include "ThreadPool.hpp"
+
+namespace yokel {
+
+//! \brief Totals kept by an async_tracer_c
+struct async_trace_stats_s {
+  std::uint64_t requests{0};  //! trace_async calls awaited
+  std::uint64_t immediate{0}; //! Answered without suspending (cache hit, unknown node or no path)
+  std::uint64_t searches{0};  //! Searches sent to the pool
+  std::uint64_t merged{0};    //! Requests that joined a search already in flight
+  std::uint64_t unreachable{0}; //! Answered from the pairs a search found no path for
+};
+
+//! \brief Awaitable front end for a graph_c, for callers running C++20
+//!        coroutines on an event loop. co_await trace_async(from, to)
+//!        yields what graph.trace(from, to) would. A cached path is
+//!        returned without suspending; otherwise the coroutine suspends
+//!        while a worker of the pool searches, and is resumed on that
+//!        worker. Requests for a pair some search is already working on
+//!        wait for that search instead of starting another, and every
+//!        search fills the graph's path cache as trace does. Pairs a
+//!        search found no path for, which the path cache does not hold,
+//!        are remembered by the tracer (the most recent max_unreachable of
+//!        them, until the graph's epoch moves) and answered at once too.
+//!
+//!        As with trace, the graph must not change while requests are in
+//!        flight. The destructor waits until every search has finished
+//!        resuming its waiters; the pool must outlive it. Searches queue
+//!        behind the pool's other tasks, so the pool should not also run
+//!        parallel_for calls made from its own workers: one that waits on
+//!        helpers queued behind a blocked worker may never finish
+//! \param GRAPH The graph_c type traced
+template<class GRAPH>
+class async_tracer_c {
+public:
+  using graph_t = GRAPH;
+  using id_t = typename GRAPH::query_t::first_type;
+  using result_t = std::optional<typename GRAPH::node_list_t>;
+
+private:
+  struct request_s {
+    std::vector<std::coroutine_handle<>> waiters;
+    result_t result;
+    std::exception_ptr error;
+  };
+
+public:
+  //! \brief What trace_async returns. Await it once
+  class awaitable_c {
+  public:
+    bool await_ready() {
+      auto& tracer = *_tracer;
+      tracer._requests.fetch_add(1, std::memory_order_relaxed);
+      const auto from = tracer._graph.index_of(_from);
+      const auto to = tracer._graph.index_of(_to);
+      if (from && to) {
+        _result = tracer._graph.trace_cached(_from, _to);
+        if (!_result) {
+          _key = edge_index_c::make_key(*from, *to);
+          return false;
+        }
+      }
+      tracer._immediate.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    //! \brief Join the search for this pair, or start one. A search that
+    //!        finished since await_ready looked leaves the pair cached or
+    //!        known unreachable before it leaves _in_flight, so both are
+    //!        checked again under the lock and answered without
+    //!        suspending. Once the lock is let go the coroutine may be
+    //!        resumed (and this awaitable destroyed) on a worker at any
+    //!        moment, so only locals are used after that
+    //! \returns false to resume at once, with the answer in _result
+    bool await_suspend(std::coroutine_handle<> handle) {
+      auto* tracer = _tracer;
+      const auto key = _key;
+      std::shared_ptr<request_s> request;
+      {
+        std::lock_guard lock(tracer->_mutex);
+        if (tracer->known_unreachable_locked(key)) {
+          tracer->_unreachable_hits.fetch_add(1, std::memory_order_relaxed);
+          tracer->_immediate.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        if (auto it = tracer->_in_flight.find(key); it != tracer->_in_flight.end()) {
+          tracer->_merged.fetch_add(1, std::memory_order_relaxed);
+          _request = it->second;
+          it->second->waiters.push_back(handle);
+          return true;
+        }
+        _result = tracer->_graph.trace_cached(_from, _to);
+        if (_result) {
+          tracer->_immediate.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        auto& slot = tracer->_in_flight[key];
+        slot = std::make_shared<request_s>();
+        slot->waiters.push_back(handle);
+        _request = slot;
+        request = slot;
+        tracer->_searches.fetch_add(1, std::memory_order_relaxed);
+        tracer->_outstanding++;
+      }
+      tracer->_pool.submit([tracer, request, key, from = _from, to = _to]() {
+        tracer->search(*request, key, from, to);
+      });
+      return true;
+    }
+
+    result_t await_resume() {
+      if (!_request) { return std::move(_result); }
+      if (_request->error) { std::rethrow_exception(_request->error); }
+      return _request->result;
+    }
+
+  private:
+    friend class async_tracer_c;
+
+    awaitable_c(async_tracer_c* tracer, id_t from, id_t to)
+      : _tracer(tracer),
+        _from(std::move(from)),
+        _to(std::move(to)) {}
+
+    async_tracer_c* _tracer;
+    id_t _from;
+    id_t _to;
+    std::uint64_t _key{0};
+    result_t _result;
+    std::shared_ptr<request_s> _request;
+  };
+
+  static constexpr std::size_t DEFAULT_MAX_UNREACHABLE = 4096;
+
+  //! \brief Serve traces of `graph` on the workers of `pool`
+  //! \param max_unreachable Pairs with no path remembered at most, the
+  //!        oldest forgotten first. Zero remembers none
+  async_tracer_c(GRAPH& graph, thread_pool_c& pool,
+      const std::size_t& max_unreachable = DEFAULT_MAX_UNREACHABLE)
+    : _graph(graph),
+      _pool(pool),
+      _max_unreachable(max_unreachable) {}
+
+  async_tracer_c(const async_tracer_c&) = delete;
+  async_tracer_c& operator=(const async_tracer_c&) = delete;
+
+  //! \brief Waits for every search to finish, including resuming its
+  //!        waiters, which may themselves start more
+  ~async_tracer_c() {
+    std::unique_lock lock(_mutex);
+    _idle.wait(lock, [this]() { return _outstanding == 0; });
+  }
+
+  //! \brief Attempt to find a path between two nodes, as trace does,
+  //!        without blocking the awaiting thread on a search
+  awaitable_c trace_async(id_t from, id_t to) {
+    return awaitable_c(this, std::move(from), std::move(to));
+  }
+
+  //! \brief Totals since the tracer was created
+  async_trace_stats_s stats() const {
+    async_trace_stats_s stats;
+    stats.requests = _requests.load(std::memory_order_relaxed);
+    stats.immediate = _immediate.load(std::memory_order_relaxed);
+    stats.searches = _searches.load(std::memory_order_relaxed);
+    stats.merged = _merged.load(std::memory_order_relaxed);
+    stats.unreachable = _unreachable_hits.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  GRAPH& _graph;
+  thread_pool_c& _pool;
+
+  // Searches in flight by (from, to) index key. A request leaves the map
+  // before its waiters resume, so later requests find the cached path
+  std::mutex _mutex;
+  std::condition_variable _idle;
+  std::unordered_map<std::uint64_t, std::shared_ptr<request_s>> _in_flight;
+  std::size_t _outstanding{0}; //! Searches submitted whose waiters have not all resumed
+
+  // Keys a search found no path for while the graph was at
+  // _unreachable_epoch, and the order they were found in, under _mutex
+  std::unordered_set<std::uint64_t> _unreachable;
+  std::deque<std::uint64_t> _unreachable_order;
+  std::uint64_t _unreachable_epoch{0};
+  std::size_t _max_unreachable;
+
+  std::atomic<std::uint64_t> _requests{0};
+  std::atomic<std::uint64_t> _immediate{0};
+  std::atomic<std::uint64_t> _searches{0};
+  std::atomic<std::uint64_t> _merged{0};
+  std::atomic<std::uint64_t> _unreachable_hits{0};
+
+  //! \brief Forget the unreachable pairs once the graph has changed
+  void drop_stale_locked() {
+    if (_graph.epoch() == _unreachable_epoch) { return; }
+    _unreachable.clear();
+    _unreachable_order.clear();
+    _unreachable_epoch = _graph.epoch();
+  }
+
+  bool known_unreachable_locked(const std::uint64_t& key) {
+    drop_stale_locked();
+    return _unreachable.count(key) != 0;
+  }
+
+  void record_unreachable_locked(const std::uint64_t& key) {
+    drop_stale_locked();
+    if (_max_unreachable == 0 || !_unreachable.insert(key).second) { return; }
+    _unreachable_order.push_back(key);
+    if (_unreachable_order.size() > _max_unreachable) {
+      _unreachable.erase(_unreachable_order.front());
+      _unreachable_order.pop_front();
+    }
+  }
+
+  //! \brief Runs on a worker: trace, then resume everyone waiting
+  void search(request_s& request, const std::uint64_t& key, const id_t& from, const id_t& to) {
+    try {
+      request.result = _graph.trace(from, to);
+    } catch (...) {
+      request.error = std::current_exception();
+    }
+
+    std::vector<std::coroutine_handle<>> waiters;
+    {
+      std::lock_guard lock(_mutex);
+      if (!request.result && !request.error) { record_unreachable_locked(key); }
+      _in_flight.erase(key);
+      waiters.swap(request.waiters);
+    }
+    for(auto waiter : waiters) {
+      waiter.resume();
+    }
+
+    // Nothing of the tracer is touched once the lock is let go
+    std::lock_guard lock(_mutex);
+    if (--_outstanding == 0) { _idle.notify_all(); }
+  }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,139 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_CACHE_FILE_HPP
+#define YOKEL_CACHE_FILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Hash.hpp"
+
+/*
+  Path cache file layout (version 1), written by graph_c::save_cache. Every
+  integer is in host byte order, as in graph files.
+
+    header             cache_file_header_s
+    ids                fixed size ids:  NODE_ID_TYPE x id_count
+                       std::string ids: (uint32 length, characters) x id_count
+    paths              (uint32 length, uint32 x length) x path_count
+
+  Only the nodes some saved path crosses are listed, and paths refer to
+  them by position in that list, so the file does not grow with the
+  graph. A path's key is its first and last node, so none is stored.
+  content_hash is graph_c::content_hash() of the graph the paths were
+  traced on, average_path_len is the reservation graph_c::optimize_trace had
+  computed (0 if none), and checksum is 64 bit FNV-1a over everything after
+  the header. Any change to the header or body layout must bump VERSION, so
+  load_cache refuses files written in the old one.
+*/
+
+namespace yokel {
+
+struct cache_file_header_s {
+  static constexpr char MAGIC[8] = {'Y', 'O', 'K', 'E', 'L', 'P', 'C', 'F'};
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::uint32_t ENDIAN_MARK = 0x01020304;
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t endian;
+  std::uint32_t id_kind;      //! 0 for fixed size ids, 1 for std::string
+  std::uint32_t id_size;      //! sizeof a fixed size id
+  std::uint64_t content_hash;
+  std::uint64_t average_path_len;
+  std::uint64_t id_count;
+  std::uint64_t path_count;
+  std::uint64_t body_size;
+  std::uint64_t checksum;
+};
+
+static_assert(sizeof(cache_file_header_s) == 72,
+  "The cache file header layout changed; bump cache_file_header_s::VERSION");
+
+namespace detail {
+
+//! \brief Writes and reads node identifiers in the id section of a
+//!        cache file, and hashes them for graph_c::content_hash
+template<class NODE_ID_TYPE>
+struct id_bytes_s {
+  static constexpr bool STRING = std::is_same_v<NODE_ID_TYPE, std::string>;
+  static_assert(STRING || std::is_trivially_copyable_v<NODE_ID_TYPE>,
+    "Cache files and content hashes need std::string or trivially copyable node ids");
+
+  static std::uint64_t hash(const NODE_ID_TYPE& id) {
+    fnv1a_c fnv;
+    if constexpr (STRING) {
+      fnv.update(id.data(), id.size());
+    } else {
+      fnv.update(&id, sizeof(NODE_ID_TYPE));
+    }
+    return fnv.value();
+  }
+
+  static void write(std::vector<char>& out, const NODE_ID_TYPE& id) {
+    if constexpr (STRING) {
+      const auto length = static_cast<std::uint32_t>(id.size());
+      append(out, &length, sizeof(length));
+      append(out, id.data(), id.size());
+    } else {
+      append(out, &id, sizeof(NODE_ID_TYPE));
+    }
+  }
+
+  //! \returns false if the id runs past the end
+  static bool read(const char*& at, const char* end, NODE_ID_TYPE& id) {
+    if constexpr (STRING) {
+      std::uint32_t length;
+      if (!take(at, end, &length, sizeof(length)) ||
+          static_cast<std::size_t>(end - at) < length) { return false; }
+      id.assign(at, length);
+      at += length;
+      return true;
+    } else {
+      return take(at, end, &id, sizeof(NODE_ID_TYPE));
+    }
+  }
+
+  static void append(std::vector<char>& out, const void* data, const std::size_t& size) {
+    auto* bytes = static_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+  }
+
+  static bool take(const char*& at, const char* end, void* data, const std::size_t& size) {
+    if (static_cast<std::size_t>(end - at) < size) { return false; }
+    std::memcpy(data, at, size);
+    at += size;
+    return true;
+  }
+};
+
+} // namespace detail
+
+} // namespace
+
+#endif
@@ -0,0 +1,332 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_CSR_VIEW_HPP
+#define YOKEL_CSR_VIEW_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "SearchScratch.hpp"
+#include "VisitBitmap.hpp"
+#include "WeightedSearch.hpp"
+
+namespace yokel {
+
+//! \brief Per-thread state of a level-by-level search (see
+//!        csr_view_s::trace_wide)
+struct level_scratch_s {
+  visit_bitmap_c visited;
+  visit_bitmap_c frontier;
+  visit_bitmap_c next;
+  std::vector<std::uint32_t> queue;
+  std::vector<std::uint32_t> next_queue;
+};
+
+//! \brief Searches over compressed sparse row arrays owned by someone
+//!        else. The out edges of node n are the targets in
+//!        [offsets[n], offsets[n+1]), sorted by index, and edge data sits
+//!        in an array parallel to the targets. Both frozen_graph_c (which
+//!        owns vectors) and mapped_graph_c (which maps a file) search
+//!        through one of these, so they share every algorithm.
+//!
+//!        The in edges are optional: when given, the sources of the in
+//!        edges of node n are [in_offsets[n], in_offsets[n+1]) of sources,
+//!        and trace_wide and reach can expand large frontiers bottom-up.
+template<class EDGE_DATA>
+struct csr_view_s {
+  using index_t = std::uint32_t;
+  using path_t = std::vector<index_t>;
+  using edge_list_t = std::vector<const EDGE_DATA*>;
+
+  std::span<const index_t> offsets;
+  std::span<const index_t> targets;
+  std::span<const EDGE_DATA> edges;
+  std::span<const index_t> in_offsets;
+  std::span<const index_t> sources;
+
+  std::size_t node_count() const { return (offsets.empty()) ? 0 : offsets.size() - 1; }
+  std::size_t edge_count() const { return targets.size(); }
+
+  //! \brief Out neighbors of a node
+  std::span<const index_t> out(const index_t& node) const {
+    return targets.subspan(offsets[node], offsets[node + 1] - offsets[node]);
+  }
+
+  //! \brief Fewest-hop path by breadth-first search. On success the
+  //!        path is overwritten with node indices, both endpoints included
+  bool trace(const index_t& from, const index_t& to, path_t& path) const {
+    path.clear();
+
+    if (from == to) {
+      path.push_back(from);
+      return true;
+    }
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(node_count());
+
+    auto& queue = scratch.frontier;
+    scratch.visit(from);
+    queue.push_back(from);
+
+    for(std::size_t head = 0; head < queue.size(); head++) {
+      const index_t node = queue[head];
+      GRAPH_STAT(scratch.nodes_visited++)
+      for(auto idx = offsets[node]; idx < offsets[node + 1]; idx++) {
+        GRAPH_STAT(scratch.edges_scanned++)
+        const index_t neighbor = targets[idx];
+        if (scratch.visited(neighbor)) { continue; }
+
+        scratch.visit(neighbor);
+        scratch.parent[neighbor] = node;
+
+        if (neighbor == to) {
+          unwind(from, to, scratch, path);
+          return true;
+        }
+        queue.push_back(neighbor);
+      }
+    }
+    return false;
+  }
+
+  //! \brief Fewest-hop path by a breadth-first search that keeps its
+  //!        visited set as a bitmap and expands each level either
+  //!        top-down (scanning the out edges of the frontier) or, when the
+  //!        frontier holds a large share of the unexplored edges and in
+  //!        edges are present, bottom-up (scanning the in edges of every
+  //!        unvisited node for one in the frontier), as described by
+  //!        Beamer et al. Clearing the bitmap costs node_count() / 8 bytes
+  //!        per search, so this pays off for searches that cover much of a
+  //!        large graph; trace is faster for short paths
+  bool trace_wide(const index_t& from, const index_t& to, path_t& path) const {
+    path.clear();
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(node_count());
+    if (!level_search<true>(from, to, search_scratch_c::typed<level_scratch_s>().visited)) {
+      return false;
+    }
+    unwind(from, to, scratch, path);
+    return true;
+  }
+
+  //! \brief Mark every node reachable from `from` (itself included) in
+  //!        `reached`, with the search trace_wide uses
+  //! \returns the number of nodes reached
+  std::size_t reach(const index_t& from, visit_bitmap_c& reached) const {
+    level_search<false>(from, NONE, reached);
+    return reached.count();
+  }
+
+  //! \brief Cheapest path, where crossing an edge costs cost_fn(edge_data)
+  //!        (never negative), guided by an A* heuristic(index). On success
+  //!        the path is overwritten with node indices and the cost returned
+  template<class COST_FN, class HEURISTIC>
+  auto trace_weighted(
+    const index_t& from,
+    const index_t& to,
+    COST_FN&& cost_fn,
+    path_t& path,
+    HEURISTIC&& heuristic) const {
+
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    path.clear();
+
+    auto cost = weighted_search<cost_t>(from, to, node_count(),
+      [&](const index_t& node, auto&& relax) {
+        for(auto idx = offsets[node]; idx < offsets[node + 1]; idx++) {
+          relax(targets[idx], idx, static_cast<cost_t>(cost_fn(edges[idx])));
+        }
+      },
+      heuristic);
+    if (cost) {
+      unwind(from, to, search_scratch_c::local(), path);
+    }
+    return cost;
+  }
+
+  //! \brief Load data from all edges crossed by a path. The edge list
+  //!        is overwritten
+  bool load_edges(const path_t& path, edge_list_t& list) const {
+    list.clear();
+    if (path.empty()) { return false; }
+    if (path.size() == 1) {
+      auto* edge = get_edge(path[0], path[0]);
+      if (!edge) { return false; }
+      list.push_back(edge);
+      return true;
+    }
+    for(std::size_t i = 0; i < path.size() - 1; i++) {
+      auto* edge = get_edge(path[i], path[i + 1]);
+      if (!edge) { return false; }
+      list.push_back(edge);
+    }
+    return true;
+  }
+
+  //! \brief Data of the edge from->to, if it exists
+  const EDGE_DATA* get_edge(const index_t& from, const index_t& to) const {
+    if (from >= node_count() || to >= node_count()) { return nullptr; }
+    const auto begin = targets.begin() + offsets[from];
+    const auto end = targets.begin() + offsets[from + 1];
+    const auto it = std::lower_bound(begin, end, to);
+    if (it == end || *it != to) { return nullptr; }
+    return &edges[it - targets.begin()];
+  }
+
+private:
+  static constexpr index_t NONE = ~index_t{0};
+
+  // Beamer's switching thresholds: go bottom-up once the frontier's out
+  // edges exceed 1/ALPHA of the unexplored edges, and back top-down once
+  // a shrinking frontier holds fewer than 1/BETA of the nodes. A bottom-up
+  // level looks at every unvisited node at least once, so it is also only
+  // tried when the frontier has more out edges than there are unvisited
+  // nodes, which keeps sparse graphs with long paths top-down
+  static constexpr std::size_t ALPHA = 14;
+  static constexpr std::size_t BETA = 24;
+
+  std::size_t degree(const index_t& node) const { return offsets[node + 1] - offsets[node]; }
+
+  //! \brief Level-synchronous search from `from` until `to` is marked or
+  //!        every reachable node is. Parents go to the search scratch
+  //!        when PARENTS is set
+  template<bool PARENTS>
+  bool level_search(const index_t& from, const index_t& to, visit_bitmap_c& visited) const {
+    const std::size_t nodes = node_count();
+    auto& scratch = search_scratch_c::local();
+    auto& level = search_scratch_c::typed<level_scratch_s>();
+    auto& queue = level.queue;
+
+    visited.reset(nodes);
+    visited.set(from);
+    if (from == to) { return true; }
+
+    queue.clear();
+    queue.push_back(from);
+    const bool can_pull = !in_offsets.empty();
+    bool bottom_up = false;
+    std::size_t frontier_size = 1;
+    std::size_t frontier_edges = degree(from);
+    std::size_t unexplored = edge_count() - frontier_edges;
+    std::size_t unvisited = nodes - 1;
+    bool growing = true;
+
+    while (frontier_size) {
+      if (!bottom_up && can_pull && frontier_edges * ALPHA > unexplored && frontier_edges > unvisited) {
+        level.frontier.reset(nodes);
+        for(auto node : queue) {
+          level.frontier.set(node);
+        }
+        bottom_up = true;
+      } else if (bottom_up && !growing && frontier_size * BETA < nodes) {
+        queue.clear();
+        level.frontier.for_each_set([&](const index_t& node) { queue.push_back(node); });
+        bottom_up = false;
+      }
+
+      std::size_t next_size{0};
+      std::size_t next_edges{0};
+      bool found = false;
+
+      if (!bottom_up) {
+        auto& next = level.next_queue;
+        next.clear();
+        for(auto node : queue) {
+          GRAPH_STAT(scratch.nodes_visited++)
+          GRAPH_STAT(scratch.edges_scanned += degree(node))
+          visited.for_each_clear_in(out(node), [&](const index_t& neighbor) {
+            visited.set(neighbor);
+            if constexpr (PARENTS) { scratch.parent[neighbor] = node; }
+            next.push_back(neighbor);
+            next_edges += degree(neighbor);
+            found |= (neighbor == to);
+          });
+          if (found) { return true; }
+        }
+        queue.swap(next);
+        next_size = queue.size();
+      } else {
+        // The target is on the next level exactly when one of its in
+        // edges leaves the frontier, so look at it before everyone else
+        if (to != NONE) {
+          for(auto idx = in_offsets[to]; idx < in_offsets[to + 1]; idx++) {
+            GRAPH_STAT(scratch.edges_scanned++)
+            if (!level.frontier.test(sources[idx])) { continue; }
+            visited.set(to);
+            if constexpr (PARENTS) { scratch.parent[to] = sources[idx]; }
+            return true;
+          }
+        }
+
+        level.next.reset(nodes);
+        visited.for_each_clear([&](const index_t& node) {
+          for(auto idx = in_offsets[node]; idx < in_offsets[node + 1]; idx++) {
+            GRAPH_STAT(scratch.edges_scanned++)
+            const index_t parent = sources[idx];
+            if (!level.frontier.test(parent)) { continue; }
+
+            GRAPH_STAT(scratch.nodes_visited++)
+            visited.set(node);
+            if constexpr (PARENTS) { scratch.parent[node] = parent; }
+            level.next.set(node);
+            next_size++;
+            next_edges += degree(node);
+            break;
+          }
+        });
+        level.frontier.swap(level.next);
+      }
+
+      growing = next_size > frontier_size;
+      unvisited -= next_size;
+      unexplored -= next_edges;
+      frontier_size = next_size;
+      frontier_edges = next_edges;
+    }
+    return false;
+  }
+
+  static void unwind(
+    const index_t& from,
+    const index_t& to,
+    const search_scratch_c& scratch,
+    path_t& path) {
+
+    for(index_t x = to; x != from; x = scratch.parent[x]) {
+      path.push_back(x);
+    }
+    path.push_back(from);
+    std::reverse(path.begin(), path.end());
+  }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,190 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_EDGE_INDEX_HPP
+#define YOKEL_EDGE_INDEX_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace yokel {
+
+//! \brief Open-addressing (linear probing) map from an ordered pair of
+//!        dense node indices to a 32 bit value. Both indices are packed
+//!        into the key, so unlike hashing the identifiers, two different
+//!        pairs can never share a key.
+class edge_index_c {
+public:
+  using key_t = std::uint64_t;
+  using value_t = std::uint32_t;
+
+  //! \brief Pack an ordered pair of node indices into a key
+  static constexpr key_t make_key(const std::uint32_t& from, const std::uint32_t& to) {
+    return (static_cast<key_t>(from) << 32) | static_cast<key_t>(to);
+  }
+
+  //! \brief Node index the key was made from
+  static constexpr std::uint32_t key_from(const key_t& key) {
+    return static_cast<std::uint32_t>(key >> 32);
+  }
+
+  //! \brief Node index the key leads to
+  static constexpr std::uint32_t key_to(const key_t& key) {
+    return static_cast<std::uint32_t>(key);
+  }
+
+  edge_index_c() = default;
+
+  //! \brief Number of keys stored
+  std::size_t size() const { return _size; }
+
+  //! \brief Drop all keys (keeps the allocated table)
+  void clear() {
+    std::fill(_keys.begin(), _keys.end(), EMPTY);
+    _size = 0;
+  }
+
+  //! \brief Make room for at least `count` keys without rehashing
+  void reserve(const std::size_t& count) {
+    std::size_t capacity{MIN_CAPACITY};
+    while (capacity * MAX_LOAD_NUM < count * MAX_LOAD_DEN) {
+      capacity <<= 1;
+    }
+    if (capacity > _keys.size()) {
+      rehash(capacity);
+    }
+  }
+
+  //! \brief Retrieve the value stored for a key, or nullptr
+  const value_t* find(const key_t& key) const {
+    if (_keys.empty()) { return nullptr; }
+    const std::size_t mask = _keys.size() - 1;
+    for(std::size_t slot = mix(key) & mask; ; slot = (slot + 1) & mask) {
+      if (_keys[slot] == key) { return &_values[slot]; }
+      if (_keys[slot] == EMPTY) { return nullptr; }
+    }
+  }
+
+  //! \brief Add a key (must not already be present)
+  //! \returns false if the key already exists
+  bool insert(const key_t& key, const value_t& value) {
+    reserve(_size + 1);
+    const std::size_t mask = _keys.size() - 1;
+    for(std::size_t slot = mix(key) & mask; ; slot = (slot + 1) & mask) {
+      if (_keys[slot] == key) { return false; }
+      if (_keys[slot] == EMPTY) {
+        _keys[slot] = key;
+        _values[slot] = value;
+        _size++;
+        return true;
+      }
+    }
+  }
+
+  //! \brief Add a key known not to be present. Any number of threads may
+  //!        do this at once, provided reserve() has made room for all the
+  //!        keys they add and nothing else touches the index meanwhile
+  void insert_concurrent(const key_t& key, const value_t& value) {
+    const std::size_t mask = _keys.size() - 1;
+    for(std::size_t slot = mix(key) & mask; ; slot = (slot + 1) & mask) {
+      std::atomic_ref<key_t> claim(_keys[slot]);
+      key_t expected = EMPTY;
+      if (claim.load(std::memory_order_relaxed) == EMPTY &&
+          claim.compare_exchange_strong(expected, key, std::memory_order_relaxed)) {
+        _values[slot] = value;
+        std::atomic_ref<std::size_t>(_size).fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  //! \brief Remove a key. Keys later in the same probe run move back
+  //!        into the gap, so the table never needs tombstones
+  //! \returns false if the key was not present
+  bool erase(const key_t& key) {
+    if (_keys.empty()) { return false; }
+    const std::size_t mask = _keys.size() - 1;
+    std::size_t hole = mix(key) & mask;
+    while (_keys[hole] != key) {
+      if (_keys[hole] == EMPTY) { return false; }
+      hole = (hole + 1) & mask;
+    }
+    for(std::size_t slot = (hole + 1) & mask; _keys[slot] != EMPTY; slot = (slot + 1) & mask) {
+      // A key may fill the hole only if its probe run passes through it
+      const std::size_t home = mix(_keys[slot]) & mask;
+      if (((slot - home) & mask) < ((slot - hole) & mask)) { continue; }
+      _keys[hole] = _keys[slot];
+      _values[hole] = _values[slot];
+      hole = slot;
+    }
+    _keys[hole] = EMPTY;
+    _size--;
+    return true;
+  }
+
+private:
+  // Node indices never reach the maximum, so this pair is never stored
+  static constexpr key_t EMPTY = std::numeric_limits<key_t>::max();
+  static constexpr std::size_t MIN_CAPACITY = 16;
+  static constexpr std::size_t MAX_LOAD_NUM = 7;
+  static constexpr std::size_t MAX_LOAD_DEN = 8;
+
+  std::vector<key_t> _keys;
+  std::vector<value_t> _values;
+  std::size_t _size{0};
+
+  //! \brief Finalizer from splitmix64, spreads packed pairs over the table
+  static constexpr std::size_t mix(key_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<std::size_t>(x);
+  }
+
+  void rehash(const std::size_t& capacity) {
+    std::vector<key_t> keys(capacity, EMPTY);
+    std::vector<value_t> values(capacity, 0);
+    const std::size_t mask = capacity - 1;
+    for(std::size_t i = 0; i < _keys.size(); i++) {
+      if (_keys[i] == EMPTY) { continue; }
+      std::size_t slot = mix(_keys[i]) & mask;
+      while (keys[slot] != EMPTY) {
+        slot = (slot + 1) & mask;
+      }
+      keys[slot] = _keys[i];
+      values[slot] = _values[i];
+    }
+    _keys.swap(keys);
+    _values.swap(values);
+  }
+};
+
+} // namespace
+
+#endif
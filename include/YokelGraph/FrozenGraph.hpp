@@ -0,0 +1,202 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_FROZEN_GRAPH_HPP
+#define YOKEL_FROZEN_GRAPH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "CsrView.hpp"
+
+namespace yokel {
+
+//! \brief Read-only snapshot of a graph_c in compressed sparse row form.
+//!        Node identifiers are interned into dense indices (in sorted
+//!        identifier order) and the out edges of node n are the targets
+//!        in [offsets[n], offsets[n+1]), sorted by index. Edge data sits
+//!        in an array parallel to the targets.
+//!
+//!        Searching uses the per-thread search scratch, so a trace into a
+//!        caller-owned path does not touch the heap once the path and the
+//!        scratch have grown to fit, and any number of threads may query
+//!        one snapshot at once.
+//!
+//!        The in edges are indexed too (sources only, no data), which
+//!        lets trace_wide and reach expand large frontiers bottom-up.
+//! \param NODE_ID_TYPE Data type nodes are identified by (must be ordered)
+//! \param EDGE_DATA Data type encoded into the edges
+template<class NODE_ID_TYPE, class EDGE_DATA>
+class frozen_graph_c {
+public:
+  using view_t = csr_view_s<EDGE_DATA>;
+  using index_t = typename view_t::index_t;
+  using path_t = typename view_t::path_t;
+  using edge_list_t = typename view_t::edge_list_t;
+
+  frozen_graph_c() = default;
+
+  //! \brief Construct from prebuilt arrays, normally by graph_c::freeze.
+  //! \param ids Node identifiers, sorted and unique. Position is the index
+  //! \param offsets ids.size()+1 entries into targets
+  //! \param targets Target index of each edge, sorted within each node
+  //! \param edges Data of each edge, parallel to targets
+  frozen_graph_c(
+    std::vector<NODE_ID_TYPE> ids,
+    std::vector<index_t> offsets,
+    std::vector<index_t> targets,
+    std::vector<EDGE_DATA> edges)
+    : _ids(std::move(ids)),
+      _offsets(std::move(offsets)),
+      _targets(std::move(targets)),
+      _edges(std::move(edges)) {
+    index_in_edges();
+  }
+
+  //! \brief Number of nodes in the snapshot
+  std::size_t node_count() const { return _ids.size(); }
+
+  //! \brief Number of edges in the snapshot
+  std::size_t edge_count() const { return _targets.size(); }
+
+  //! \brief Find the dense index of a node
+  std::optional<index_t> index_of(const NODE_ID_TYPE& id) const {
+    const auto it = std::lower_bound(_ids.begin(), _ids.end(), id);
+    if (it == _ids.end() || *it != id) { return std::nullopt; }
+    return {static_cast<index_t>(it - _ids.begin())};
+  }
+
+  //! \brief Retrieve the identifier of a node by index
+  const NODE_ID_TYPE& id_of(const index_t& node) const {
+    return _ids[node];
+  }
+
+  //! \brief Retrieve the out neighbors of a node by index
+  std::span<const index_t> out(const index_t& node) const {
+    return view().out(node);
+  }
+
+  //! \brief Attempt to find a path between two nodes. On success the
+  //!        path is overwritten with the node indices of the fewest-hop
+  //!        route, including both endpoints
+  bool trace(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to, path_t& path) const {
+    const auto to_idx = index_of(to);
+    if (!to_idx) { return false; }
+
+    const auto from_idx = index_of(from);
+    if (!from_idx) { return false; }
+
+    return trace_index(*from_idx, *to_idx, path);
+  }
+
+  //! \brief Attempt to find a path between two nodes by index
+  bool trace_index(const index_t& from, const index_t& to, path_t& path) const {
+    return view().trace(from, to, path);
+  }
+
+  //! \brief Attempt to find a fewest-hop path between two nodes by index
+  //!        with a direction-optimizing search (see csr_view_s::trace_wide),
+  //!        for queries expected to cover much of the graph
+  bool trace_wide(const index_t& from, const index_t& to, path_t& path) const {
+    return view().trace_wide(from, to, path);
+  }
+
+  //! \brief Mark every node reachable from a node in `reached`
+  //! \returns the number of nodes reached, the node itself included
+  std::size_t reach(const index_t& from, visit_bitmap_c& reached) const {
+    return view().reach(from, reached);
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes, where
+  //!        crossing an edge costs cost_fn(edge_data) (never negative),
+  //!        optionally guided by an A* heuristic(index). On success the
+  //!        path is overwritten with node indices and the cost returned
+  template<class COST_FN, class HEURISTIC>
+  auto trace_weighted(
+    const index_t& from,
+    const index_t& to,
+    COST_FN&& cost_fn,
+    path_t& path,
+    HEURISTIC&& heuristic) const {
+    return view().trace_weighted(from, to, cost_fn, path, heuristic);
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes with
+  //!        Dijkstra's algorithm
+  template<class COST_FN>
+  auto trace_weighted(const index_t& from, const index_t& to, COST_FN&& cost_fn, path_t& path) const {
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    return trace_weighted(from, to, cost_fn, path, [](const index_t&) { return cost_t{}; });
+  }
+
+  //! \brief Given some result path from trace, load data from all
+  //!        edges that were crossed. The edge list is overwritten
+  bool load_edges(const path_t& path, edge_list_t& edges) const {
+    return view().load_edges(path, edges);
+  }
+
+  //! \brief Retrieve the data of the edge from->to, if it exists
+  const EDGE_DATA* get_edge(const index_t& from, const index_t& to) const {
+    return view().get_edge(from, to);
+  }
+
+  //! \brief The arrays of the snapshot, for searching or writing out
+  view_t view() const { return {_offsets, _targets, _edges, _in_offsets, _sources}; }
+  std::span<const NODE_ID_TYPE> ids() const { return _ids; }
+
+private:
+  std::vector<NODE_ID_TYPE> _ids;
+  std::vector<index_t> _offsets;
+  std::vector<index_t> _targets;
+  std::vector<EDGE_DATA> _edges;
+  std::vector<index_t> _in_offsets;
+  std::vector<index_t> _sources;
+
+  //! \brief Counting sort of the edges by target. Sources come out in
+  //!        ascending order within each node since nodes are visited in order
+  void index_in_edges() {
+    if (_ids.empty()) { return; }
+    _in_offsets.assign(_ids.size() + 1, 0);
+    for(auto target : _targets) {
+      _in_offsets[target + 1]++;
+    }
+    for(std::size_t n = 0; n < _ids.size(); n++) {
+      _in_offsets[n + 1] += _in_offsets[n];
+    }
+    _sources.resize(_targets.size());
+    std::vector<index_t> fill(_in_offsets.begin(), _in_offsets.end() - 1);
+    for(index_t n = 0; n < _ids.size(); n++) {
+      for(auto idx = _offsets[n]; idx < _offsets[n + 1]; idx++) {
+        _sources[fill[_targets[idx]]++] = n;
+      }
+    }
+  }
+};
+
+} // namespace
+
+#endif
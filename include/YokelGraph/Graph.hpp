@@ -25,13 +25,39 @@
 #ifndef YOKEL_GRAPH_HPP
 #define YOKEL_GRAPH_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <limits>
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <optional>
-#include <stack>
+#include <set>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "CacheFile.hpp"
+#include "EdgeIndex.hpp"
+#include "FrozenGraph.hpp"
+#include "GraphStats.hpp"
+#include "Hash.hpp"
+#include "NodeStorage.hpp"
+#include "PathCache.hpp"
+#include "ReachIndex.hpp"
+#include "SearchScratch.hpp"
+#include "ThreadPool.hpp"
+#include "WeightedSearch.hpp"
+
 /*
   When this is enabled in build it will require fmt/format.h to build
   correctly. 
@@ -50,291 +76,2747 @@
 
 namespace yokel {
 
+//! \brief Nodes and edges to load a graph from. Shared by every storage
+//!        policy so one source can feed any graph of matching types
+template<class NODE_ID_TYPE, class EDGE_DATA>
+struct graph_source_s {
+  struct edge_s {
+    NODE_ID_TYPE from;
+    NODE_ID_TYPE to;
+    EDGE_DATA data;
+  };
+  std::vector<NODE_ID_TYPE> nodes;
+  std::vector<edge_s> edges;
+};
+
 //! \brief Graph implementation
 //! \param NODE_ID_TYPE Data type to encode node identifiers as (must be default constructable)
 //! \param EDGE_DATA Data type to encode into graph edges (must be default constructable)
-template<class NODE_ID_TYPE, class EDGE_DATA>
+//! \param STORAGE Policy used to look nodes up by identifier (see NodeStorage.hpp),
+//!                direct tables for integral identifiers and std::map otherwise
+template<class NODE_ID_TYPE, class EDGE_DATA, class STORAGE = default_storage_t<NODE_ID_TYPE>>
 class graph_c {
 public:
 
   //! \brief A helpful structure to quickly load the graph
-  struct source_s {
-    struct edge_s {
-      NODE_ID_TYPE from;
-      NODE_ID_TYPE to;
-      EDGE_DATA data;
-    };
-    std::vector<NODE_ID_TYPE> nodes;
-    std::vector<edge_s> edges;
-  };
+  using source_s = graph_source_s<NODE_ID_TYPE, EDGE_DATA>;
 
   //! \brief Interface handed back to users when a path
-  //!        is traced from one node to another
+  //!        is traced from one node to another. Every node_if is the
+  //!        base of a graph node, so data() is a plain member access
   class node_if {
   public:
     node_if() = default;
-    virtual const NODE_ID_TYPE* data() const = 0;
+    const NODE_ID_TYPE* data() const {
+      return &static_cast<const node_s*>(this)->id;
+    }
   };
 
   using node_list_t = std::vector<node_if*>; 
   using edge_list_t = std::vector<EDGE_DATA*>;
+  using frozen_t = frozen_graph_c<NODE_ID_TYPE, EDGE_DATA>;
+  using query_t = std::pair<NODE_ID_TYPE, NODE_ID_TYPE>;
+  using path_view_t = cached_path_c<node_if*>;
 
-  graph_c() = default;
-  graph_c(const bool& cache_enabled)
-    : _cache_enabled{cache_enabled} {}
+  //! \brief A path together with the data of the edge crossed at each hop
+  struct traced_path_s {
+    node_list_t nodes;
+    edge_list_t edges; //! Edge i joins nodes[i] to nodes[i+1]
+  };
 
-  //! \brief Attempt to laod the graph
-  bool build_from(const source_s& source) {
-    for(auto& node : source.nodes) {
-      if (!add_node(node)) {
-        GRAPH_DBG("Failed to add node\n")
-        return false;
-      }
+  //! \brief A cheapest path and its total cost, as found by trace_weighted
+  template<class COST>
+  struct weighted_path_s : traced_path_s {
+    COST cost{};
+  };
+
+  //! \brief Edge cost used by the cached form of trace_weighted
+  using edge_cost_t = std::function<double(const EDGE_DATA&)>;
+
+  //! \brief A path as plain indices: the dense index of the first node
+  //!        and the index of the edge taken at each hop. Node i+1 of the
+  //!        path is edge_target(edges[i])
+  struct indexed_path_s {
+    std::uint32_t source{0};
+    std::vector<std::uint32_t> edges;
+
+    //! \brief Number of nodes on the path
+    std::size_t size() const { return edges.size() + 1; }
+  };
+
+  //! \brief Paths found by trace_batch, stored back to back in one buffer
+  struct batch_result_s {
+    node_list_t nodes;
+    std::vector<std::size_t> offsets; //! Query i spans [offsets[i], offsets[i+1])
+
+    //! \brief Number of queries in the batch
+    std::size_t size() const {
+      return (offsets.empty()) ? 0 : offsets.size() - 1;
     }
-    for(auto& edge : source.edges) {
-      if (!add_edge(edge.from, edge.to, edge.data)) {
-        GRAPH_DBG("Failed to add edge\n")
-        return false;
+
+    //! \brief Check if a path was found for a query
+    bool found(const std::size_t& query) const {
+      return offsets[query + 1] > offsets[query];
+    }
+
+    //! \brief The path for a query (empty when none was found)
+    std::span<node_if* const> path(const std::size_t& query) const {
+      return {nodes.data() + offsets[query], nodes.data() + offsets[query + 1]};
+    }
+  };
+
+  //! \brief Strongly connected components, as found by Tarjan's
+  //!        algorithm. Components are numbered in reverse topological
+  //!        order, so every edge between two components runs from a
+  //!        higher number to a lower one. Collapsing each component to a
+  //!        single node gives an acyclic graph
+  struct components_s {
+    node_list_t nodes;                    //! Members of every component, back to back
+    std::vector<std::size_t> offsets;     //! Component c spans [offsets[c], offsets[c+1])
+    std::vector<std::uint32_t> component; //! Component of each node, by dense index (max for removed slots)
+    std::vector<bool> cyclic;             //! Component has more than one node or a self loop
+
+    //! \brief Number of components
+    std::size_t size() const {
+      return (offsets.empty()) ? 0 : offsets.size() - 1;
+    }
+
+    //! \brief The nodes of a component
+    std::span<node_if* const> members(const std::size_t& component) const {
+      return {nodes.data() + offsets[component], nodes.data() + offsets[component + 1]};
+    }
+  };
+
+  //! \brief Fewest-hop paths from one node to every node, as produced by
+  //!        trace_all_from. Arrays are indexed by dense node index. The
+  //!        tree refers back to the graph it came from, and describes the
+  //!        graph as it was when traced; it must not outlive the graph
+  class path_tree_c {
+  public:
+    static constexpr std::uint32_t UNREACHED = std::numeric_limits<std::uint32_t>::max();
+
+    //! \brief The node the tree was traced from
+    node_if* root() const { return &_graph->_nodes[_root]; }
+
+    //! \brief Predecessor of each node on its path from the root
+    //!        (the root is its own parent, UNREACHED if no path exists)
+    std::span<const std::uint32_t> parents() const { return _parent; }
+
+    //! \brief Hop count from the root to each node (UNREACHED if no path exists)
+    std::span<const std::uint32_t> distances() const { return _distance; }
+
+    //! \brief Hops from the root to a node, if it is reachable
+    std::optional<std::size_t> distance(const NODE_ID_TYPE& to) const {
+      auto* node = _graph->load_node(to);
+      if (!node || !reached(node->index)) { return std::nullopt; }
+      return {_distance[node->index]};
+    }
+
+    //! \brief Build the path from the root to a node without searching.
+    //!        Matches what trace returns under breadth-first search
+    std::optional<node_list_t> path_to(const NODE_ID_TYPE& to) const {
+      auto* node = _graph->load_node(to);
+      if (!node || !reached(node->index)) { return std::nullopt; }
+
+      node_list_t path(_distance[node->index] + 1, nullptr);
+      auto x = node->index;
+      for(auto i = path.size(); i > 0; i--) {
+        path[i - 1] = &_graph->_nodes[x];
+        x = _parent[x];
       }
+      return {path};
     }
-    return true;
-  }
 
-  //! \brief Add a new node by copy (must have unique id)
-  bool add_node(const NODE_ID_TYPE& id) {
-    if (load_node(id)) { return false; }
+  private:
+    friend class graph_c;
 
-    clear_cache();
-    _node_storage.emplace(id, node_s(id));
-    _contains_cycles = false;
-    return true;
-  }
+    path_tree_c(graph_c* graph, std::uint32_t root)
+      : _graph(graph),
+        _root(root),
+        _parent(graph->_nodes.size(), UNREACHED),
+        _distance(graph->_nodes.size(), UNREACHED) {}
 
-  //! \brief Add an edge (must be a unique pair of nodes)
-  bool add_edge(
-    const NODE_ID_TYPE& from,
-    const NODE_ID_TYPE& to,
-    const EDGE_DATA& edge_data) {
+    bool reached(const std::uint32_t& node) const { return _distance[node] != UNREACHED; }
 
-    auto* to_node = load_node(to);
-    if (!to_node) { return false; }
+    graph_c* _graph;
+    std::uint32_t _root;
+    std::vector<std::uint32_t> _parent;
+    std::vector<std::uint32_t> _distance;
+  };
 
-    auto* from_node = load_node(from);
-    if (!from_node) { return false; }
+  //! \brief Every fewest-hop path between two nodes, as produced by
+  //!        trace_all_shortest. Only the edges lying on some fewest-hop
+  //!        path are kept; the paths themselves, of which there may be
+  //!        exponentially many, are produced one at a time by iterating,
+  //!        depth first in edge insertion order. Like path_tree_c it
+  //!        describes the graph as it was and must not outlive it
+  class shortest_paths_c {
+  public:
+    //! \brief Walks the paths. The path it points at is reused, so copy
+    //!        it to keep it past the next increment
+    class iterator_c {
+    public:
+      using value_type = traced_path_s;
+      using difference_type = std::ptrdiff_t;
 
-    const std::size_t edge_hash = merge_ids(from, to);
-    {
-      const auto it = _edge_storage.find(edge_hash);
-      if (it != _edge_storage.end()) { return false; }
+      const traced_path_s& operator*() const { return _path; }
+      const traced_path_s* operator->() const { return &_path; }
+      iterator_c& operator++() {
+        advance();
+        return *this;
+      }
+      void operator++(int) { advance(); }
+      bool operator==(std::default_sentinel_t) const { return _done; }
+
+    private:
+      friend class shortest_paths_c;
+
+      explicit iterator_c(const shortest_paths_c* paths) : _paths(paths) {
+        _stack.push_back(paths->_root);
+        descend();
+        expand();
+      }
+
+      //! \brief Take the first edge out of each node until the target.
+      //!        Every kept node but the target has one, at the next depth
+      void descend() {
+        while (_stack.size() < _paths->_hops + 1) {
+          _at.push_back(_paths->_offsets[_stack.back()]);
+          _stack.push_back(_paths->_next[_at.back()]);
+        }
+      }
+
+      //! \brief Move the deepest edge that has a sibling left to it
+      void advance() {
+        while (!_at.empty()) {
+          _stack.pop_back();
+          if (++_at.back() < _paths->_offsets[_stack.back() + 1]) {
+            _stack.push_back(_paths->_next[_at.back()]);
+            descend();
+            expand();
+            return;
+          }
+          _at.pop_back();
+        }
+        _done = true;
+      }
+
+      void expand() {
+        auto& graph = *_paths->_graph;
+        _path.nodes.resize(_at.size() + 1);
+        _path.edges.resize(_at.size());
+        _path.nodes[0] = &graph._nodes[_paths->_source];
+        for(std::size_t i = 0; i < _at.size(); i++) {
+          const auto edge = _paths->_edges[_at[i]];
+          _path.nodes[i + 1] = &graph._nodes[graph._edge_ends[edge].to];
+          _path.edges[i] = &graph._edge_storage[edge];
+        }
+      }
+
+      const shortest_paths_c* _paths;
+      std::vector<std::uint32_t> _stack; //! Kept node at each depth
+      std::vector<std::uint32_t> _at;    //! Kept edge taken at each depth
+      traced_path_s _path;
+      bool _done{false};
+    };
+
+    //! \brief Hops on every one of the paths
+    std::size_t hops() const { return _hops; }
+
+    //! \brief Number of paths, saturating at the largest uint64_t
+    std::uint64_t count() const { return _count; }
+
+    iterator_c begin() const { return iterator_c(this); }
+    std::default_sentinel_t end() const { return {}; }
+
+  private:
+    friend class graph_c;
+
+    shortest_paths_c(graph_c* graph, const std::uint32_t& source, const std::uint32_t& hops)
+      : _graph(graph), _source(source), _hops(hops) {}
+
+    graph_c* _graph;
+    std::uint32_t _source;
+    std::uint32_t _hops;
+    std::uint32_t _root{0};
+    std::uint64_t _count{0};
+
+    // Kept nodes are numbered locally. The kept out edges of local node
+    // n are [_offsets[n], _offsets[n+1]) of _edges, leading to _next
+    std::vector<std::uint32_t> _offsets;
+    std::vector<std::uint32_t> _edges;
+    std::vector<std::uint32_t> _next;
+  };
+
+  //! \brief Up to k fewest-hop simple paths between two nodes, shortest
+  //!        first (ties broken by edge index), as produced by trace_k with
+  //!        Yen's algorithm. Each path is searched for when the iterator
+  //!        reaches it, using breadth-first searches from the nodes of the
+  //!        path before it, so stopping early skips the rest of the work.
+  //!        At most k candidate paths are held at once. The graph is read
+  //!        while iterating, so it must not change meanwhile, and the
+  //!        paths must not outlive it
+  class k_paths_c {
+  public:
+    //! \brief Walks the paths, once. The path it points at is reused
+    class iterator_c {
+    public:
+      using value_type = traced_path_s;
+      using difference_type = std::ptrdiff_t;
+
+      const traced_path_s& operator*() const { return _paths->_current; }
+      const traced_path_s* operator->() const { return &_paths->_current; }
+      iterator_c& operator++() {
+        _paths->next();
+        return *this;
+      }
+      void operator++(int) { _paths->next(); }
+      bool operator==(std::default_sentinel_t) const { return _paths->_done; }
+
+    private:
+      friend class k_paths_c;
+      explicit iterator_c(k_paths_c* paths) : _paths(paths) {}
+      k_paths_c* _paths;
+    };
+
+    //! \brief Paths produced so far, as edge indices
+    std::span<const std::vector<std::uint32_t>> found() const { return _found; }
+
+    //! \brief Iteration continues from wherever it stopped
+    iterator_c begin() { return iterator_c(this); }
+    std::default_sentinel_t end() const { return {}; }
+
+  private:
+    friend class graph_c;
+
+    k_paths_c(graph_c* graph, const std::uint32_t& from, const std::uint32_t& to, const std::size_t& k)
+      : _graph(graph), _from(from), _to(to), _k(k) {}
+
+    //! \brief Found path i of the same first j edges as the last path
+    //!        can not leave its j-th node by the same edge again.
+    //!        Every other node of that shared start is off limits too
+    void next() {
+      if (_found.size() >= _k) {
+        _done = true;
+        return;
+      }
+
+      const auto& previous = _found.back();
+      std::vector<std::uint32_t> nodes{_from};
+      for(auto edge : previous) {
+        nodes.push_back(_graph->_edge_ends[edge].to);
+      }
+
+      std::vector<std::uint32_t> blocked;
+      std::vector<std::uint32_t> spur;
+      for(std::size_t i = 0; i < previous.size(); i++) {
+        blocked.clear();
+        for(auto& path : _found) {
+          if (path.size() > i && std::equal(previous.begin(), previous.begin() + i, path.begin())) {
+            blocked.push_back(path[i]);
+          }
+        }
+        if (!_graph->find_avoiding(nodes[i], _to, {nodes.data(), i}, blocked, spur)) { continue; }
+
+        std::vector<std::uint32_t> candidate(previous.begin(), previous.begin() + i);
+        candidate.insert(candidate.end(), spur.begin(), spur.end());
+        _candidates.insert({candidate.size(), std::move(candidate)});
+
+        // Only the best k - found candidates can ever be produced
+        while (_candidates.size() > _k - _found.size()) {
+          _candidates.erase(std::prev(_candidates.end()));
+        }
+      }
+
+      if (_candidates.empty()) {
+        _done = true;
+        return;
+      }
+      _found.push_back(std::move(_candidates.begin()->second));
+      _candidates.erase(_candidates.begin());
+      _graph->expand(_from, _found.back(), _current);
     }
-  
-    clear_cache();
-    from_node->out.push_back(to_node);
-    _edge_storage[edge_hash] = edge_data;
-    _contains_cycles = false;
-    return true;
-  }
 
-  //! \brief Manually clear the cache
-  inline void clear_cache() {
-    _cache.clear();
-  }
+    graph_c* _graph;
+    std::uint32_t _from;
+    std::uint32_t _to;
+    std::size_t _k;
+    std::vector<std::vector<std::uint32_t>> _found;
+    std::set<std::pair<std::size_t, std::vector<std::uint32_t>>> _candidates;
+    traced_path_s _current;
+    bool _done{false};
+  };
 
-  //! \brief Enable/ disable the cache (clears when called)
-  void toggle_cache(const bool& is_enabled) {
-    _cache_enabled = is_enabled;
-    return clear_cache();
-  }
+  //! \brief Streams nodes and edges into a graph without collecting them
+  //!        in a source_s first. Nodes are added as they arrive. Edges are
+  //!        kept only as a pair of node indices next to their data, and
+  //!        may name nodes that arrive later in the stream. finish()
+  //!        resolves them, drops repeats (the first edge wins) and fills
+  //!        every adjacency list in one counting pass. The graph is in a
+  //!        bulk load until then and must not be used for anything else
+  class builder_c {
+  public:
+    builder_c(const builder_c&) = delete;
+    builder_c& operator=(const builder_c&) = delete;
 
-  //! \brief Attempt to optimize trace by calculating average
-  //!        path length in the cache for memory reservation
-  //!        on trace calls
-  bool optimize_trace() {
-    if (!_cache_enabled || _cache.empty()) { return false; }
-    std::size_t total_paths_len{0};
-    for(auto it = _cache.begin(); it != _cache.end(); ++it) {
-      total_paths_len += it->second.size();
+    //! \brief Streamed edges are discarded if finish() was never called
+    ~builder_c() {
+      if (_graph) { abandon(); }
     }
-    _average_path_len = std::ceil(total_paths_len / _cache.size());
-    return true;
-  }
 
-  //! \brief Attempt to find a path between two nodes.
-  //!        Will return the shortest path found 
-  std::optional<node_list_t> trace(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
-    if (!load_node(to)) { return std::nullopt; }
-    if (!load_node(from)) { return std::nullopt; }
-  
-    std::size_t merged_ids{0};
+    //! \brief Add a node (repeats are ignored)
+    void add_node(const NODE_ID_TYPE& id) {
+      _graph->add_node(id);
+    }
 
-    node_list_t result;
+    //! \brief Add a node, moving the identifier in (repeats are ignored)
+    void add_node(NODE_ID_TYPE&& id) {
+      _graph->add_node(std::move(id));
+    }
 
-    std::size_t reservation{DEFAULT_TRACE_RESERVATION};
+    //! \brief Add an edge. Its nodes need only exist by finish()
+    void add_edge(
+      const NODE_ID_TYPE& from,
+      const NODE_ID_TYPE& to,
+      const EDGE_DATA& edge_data) {
+      emplace_edge(from, to, edge_data);
+    }
 
-    if (_cache_enabled) {
-      merged_ids = merge_ids(from, to);
-      const auto it = _cache.find(merged_ids);
-      if (it != _cache.end()) { return {it->second}; }
-      reservation = _average_path_len;
-      result.reserve(reservation);
+    //! \brief Add an edge, moving its data in
+    void add_edge(
+      const NODE_ID_TYPE& from,
+      const NODE_ID_TYPE& to,
+      EDGE_DATA&& edge_data) {
+      emplace_edge(from, to, std::move(edge_data));
     }
 
-    const bool found = this->find(from, to, result, reservation);
+    //! \brief Add an edge whose data is constructed in place from args.
+    //!        A repeat is constructed too, and dropped by finish()
+    template<class... ARGS>
+    void emplace_edge(
+      const NODE_ID_TYPE& from,
+      const NODE_ID_TYPE& to,
+      ARGS&&... args) {
 
-    if (!found) {
-      return std::nullopt;
+      const auto from_ref = reference(from);
+      const auto to_ref = reference(to);
+      _graph->_edge_ends.push_back({from_ref, to_ref});
+      _graph->_edge_storage.emplace_back(std::forward<ARGS>(args)...);
     }
 
-    if (result.size() == 0 && (from == to)) {
-      auto& node = _node_storage[from];
-      result.push_back(&node);
+    //! \brief Link the streamed edges into the graph
+    //! \returns false, keeping none of the streamed edges, if an edge
+    //!          names a node that was never added. Streamed nodes are
+    //!          kept either way, as with build_from
+    bool finish() {
+      auto& graph = *_graph;
+      auto& ends = graph._edge_ends;
+      auto& storage = graph._edge_storage;
+
+      std::vector<std::uint32_t> resolved(_pending.size());
+      for(std::size_t i = 0; i < _pending.size(); i++) {
+        auto* node = graph.load_node(_pending[i]);
+        if (!node) {
+          GRAPH_DBG("Streamed edge names a node that was never added\n")
+          abandon();
+          return false;
+        }
+        resolved[i] = node->index;
+      }
+
+      // Indexed in stream order, so a repeated edge is caught here and
+      // the gap it leaves is closed by moving later edges down
+      graph._edge_index.reserve(graph._edge_index.size() + ends.size() - _first_edge);
+      std::vector<std::uint32_t> out_degree(graph._nodes.size(), 0);
+      std::vector<std::uint32_t> in_degree(graph._nodes.size(), 0);
+      std::size_t kept = _first_edge;
+      for(std::size_t i = _first_edge; i < ends.size(); i++) {
+        edge_ends_s edge = ends[i];
+        if (edge.from & PENDING) { edge.from = resolved[edge.from & ~PENDING]; }
+        if (edge.to & PENDING) { edge.to = resolved[edge.to & ~PENDING]; }
+
+        const auto key = edge_index_c::make_key(edge.from, edge.to);
+        if (!graph._edge_index.insert(key, static_cast<std::uint32_t>(kept))) { continue; }
+        ends[kept] = edge;
+        if (kept != i) {
+          storage[kept] = std::move(storage[i]);
+        }
+        out_degree[edge.from]++;
+        in_degree[edge.to]++;
+        kept++;
+      }
+      ends.resize(kept);
+      storage.erase(storage.begin() + static_cast<std::ptrdiff_t>(kept), storage.end());
+
+      // Every list grows once, to its final size
+      for(auto& node : graph._nodes) {
+        if (out_degree[node.index]) {
+          node.out.reserve(node.out.size() + out_degree[node.index]);
+          node.out_edges.reserve(node.out_edges.size() + out_degree[node.index]);
+        }
+        if (in_degree[node.index]) {
+          node.in.reserve(node.in.size() + in_degree[node.index]);
+          node.in_edges.reserve(node.in_edges.size() + in_degree[node.index]);
+        }
+      }
+      for(std::size_t i = _first_edge; i < kept; i++) {
+        auto& from = graph._nodes[ends[i].from];
+        auto& to = graph._nodes[ends[i].to];
+        graph.touch(from.index);
+        from.out.push_back(&to);
+        from.out_edges.push_back(static_cast<std::uint32_t>(i));
+        to.in.push_back(&from);
+        to.in_edges.push_back(static_cast<std::uint32_t>(i));
+      }
+
+      graph._components.reset();
+      graph._reach.reset();
+      graph._epoch++;
+      graph.end_bulk_load();
+      _graph = nullptr;
+      return true;
     }
 
-    if (_cache_enabled) {
-      _cache[merged_ids] = {result};
+  private:
+    friend class graph_c;
+
+    // Marks an edge end that refers to _pending rather than to a node
+    static constexpr std::uint32_t PENDING = std::uint32_t{1} << 31;
+
+    builder_c(
+      graph_c* graph,
+      const std::size_t& expected_nodes,
+      const std::size_t& expected_edges)
+      : _graph(graph),
+        _first_edge(graph->_edge_ends.size()) {
+      graph->begin_bulk_load();
+      graph->_node_index.reserve(graph->_nodes.size() + expected_nodes);
+      graph->_edge_ends.reserve(graph->_edge_ends.size() + expected_edges);
     }
 
-    return {result};
-  }
+    std::uint32_t reference(const NODE_ID_TYPE& id) {
+      if (auto* node = _graph->load_node(id)) { return node->index; }
 
-  //! \brief Given some result path from trace, load data from
-  //!        all edges that were crossed
-  std::optional<edge_list_t> load_edges(const node_list_t& path) {
-    if (path.empty()) { return std::nullopt; }
-    edge_list_t result;
-    if (path.size() == 1) {
-      auto* edge = get_edge(path[0]->data(), path[0]->data());
-      if (!edge) { return std::nullopt; }
-      result.push_back(edge);
-      return {result};
+      auto key_of = [this](const std::uint32_t& idx) -> const NODE_ID_TYPE& {
+        return _pending[idx];
+      };
+      if (auto* slot = _pending_index.find(id, key_of)) { return *slot | PENDING; }
+
+      const auto slot = static_cast<std::uint32_t>(_pending.size());
+      _pending.push_back(id);
+      _pending_index.insert(id, slot, key_of);
+      return slot | PENDING;
     }
-    result.reserve(path.size()-1);
-    for(std::size_t i = 0; i < path.size()-1; i++) {
-      auto* edge = get_edge(path[i]->data(), path[i+1]->data());
-      if (!edge) {return std::nullopt;}
-      result.push_back(edge);
+
+    void abandon() {
+      auto& storage = _graph->_edge_storage;
+      _graph->_edge_ends.resize(_first_edge);
+      storage.erase(storage.begin() + static_cast<std::ptrdiff_t>(_first_edge), storage.end());
+      _graph->end_bulk_load();
+      _graph = nullptr;
     }
-    return {result};
+
+    graph_c* _graph;
+    std::size_t _first_edge;
+
+    // Identifiers named by an edge before their node was added
+    std::vector<NODE_ID_TYPE> _pending;
+    typename STORAGE::template index_t<NODE_ID_TYPE> _pending_index;
+  };
+
+  //! \brief Algorithm used by trace to find the fewest-hop path
+  enum class search_strategy_e {
+    BREADTH_FIRST,  //! Expand outward from the source only
+    BIDIRECTIONAL   //! Expand from both ends, stop when the frontiers meet
+  };
+
+  graph_c() = default;
+  graph_c(const bool& cache_enabled)
+    : _cache_enabled{cache_enabled} {}
+
+  //! \brief Allocate nodes, adjacency lists and edges from a memory
+  //!        resource, which must outlive the graph. The identifier index,
+  //!        edge index and path cache keep their own storage
+  explicit graph_c(std::pmr::memory_resource* resource, const bool& cache_enabled = true)
+    : _resource{resource},
+      _nodes{resource},
+      _edge_storage{resource},
+      _edge_ends{resource},
+      _cache_enabled{cache_enabled} {}
+
+  graph_c(const graph_c&) = delete;
+  graph_c& operator=(const graph_c&) = delete;
+
+  //! \brief Take over another graph's nodes, edges, caches, statistics
+  //!        and memory resource. Nodes and cached paths stay where they
+  //!        are, so node_if pointers, path views and edge data pointers
+  //!        keep working. The other graph is left empty, on the same
+  //!        resource; ranges and builders over it must not be used again
+  graph_c(graph_c&& o)
+    : _components(std::exchange(o._components, std::nullopt)),
+      _reach(std::exchange(o._reach, std::nullopt)),
+      _epoch(o._epoch),
+      _search_strategy(o._search_strategy),
+      _resource(o._resource),
+      _nodes(std::move(o._nodes)),
+      _node_index(std::exchange(o._node_index, {})),
+      _edge_index(std::exchange(o._edge_index, {})),
+      _edge_storage(std::move(o._edge_storage)),
+      _edge_ends(std::move(o._edge_ends)),
+      _removed_nodes(std::exchange(o._removed_nodes, 0)),
+      _removed_edges(std::exchange(o._removed_edges, 0)),
+      _tracking(std::exchange(o._tracking, false)),
+      _changes(std::exchange(o._changes, {})),
+      _stats_base(std::exchange(o._stats_base, {})),
+#ifdef GRAPH_ENABLE_STATS
+      _counters(o._counters),
+      _trace_hook(o._trace_hook),
+#endif
+      _cache_enabled(o._cache_enabled),
+      _bulk_loads(std::exchange(o._bulk_loads, 0)),
+      _average_path_len(o._average_path_len.exchange(0, std::memory_order_relaxed)),
+      _cache(std::move(o._cache)),
+      _edge_cache(std::move(o._edge_cache)),
+      _weighted_cache(std::move(o._weighted_cache)),
+      _edge_cost(o._edge_cost) {
+    // Moved-from containers are only guaranteed valid; make them empty
+    o._nodes.clear();
+    o._edge_storage.clear();
+    o._edge_ends.clear();
+    GRAPH_STAT(o._counters.reset())
   }
 
-  //! \brief Check if the graph contains cycles
-  bool contains_cycles() {
-    if (_contains_cycles) { return true; }
-    for(auto&& [id, node] : _node_storage) {
-      for(auto* neighbor : node.out) {
-        auto result = trace(neighbor->id, id);
-        if (result.has_value()){
-          _contains_cycles = true;
-          return true;
-        }
-      }
+  //! \brief Replace this graph with another, as the move constructor
+  //!        does, adopting its memory resource. Pointers, views and
+  //!        ranges into this graph are invalidated as by destruction. The
+  //!        move constructor only allocates the other graph's empty
+  //!        caches, so running out of memory there ends the program
+  //!        rather than leaving this graph half destroyed
+  graph_c& operator=(graph_c&& o) noexcept {
+    if (this != &o) {
+      std::destroy_at(this);
+      std::construct_at(this, std::move(o));
     }
-    return _contains_cycles;
+    return *this;
   }
 
-private:
-  static constexpr std::size_t DEFAULT_TRACE_RESERVATION = 5;
+  //! \brief Resource nodes, adjacency lists and edges are allocated from
+  std::pmr::memory_resource* resource() const { return _resource; }
 
-  struct node_s : public node_if {
-    node_s() : node_if() {}
-    node_s(NODE_ID_TYPE id) : node_if(), id (id) {}
-    node_s(const NODE_ID_TYPE&& id) : node_if(), id (id) {}
-    node_s(const node_s&& o) : node_if(), id(o.id){}
+  //! \brief Attempt to laod the graph (runs as a bulk load)
+  bool build_from(const source_s& source) {
+    begin_bulk_load();
+    const bool result = load_from(source);
+    end_bulk_load();
+    return result;
+  }
 
-    const NODE_ID_TYPE* data() const override { return &id; }
-    NODE_ID_TYPE id;
-    std::vector<node_s*> out;
-    bool marked{false};
-  };
+  //! \brief Attempt to load the graph, moving identifiers and edge data
+  //!         out of the source rather than copying them
+  bool build_from(source_s&& source) {
+    begin_bulk_load();
+    const bool result = load_from(std::move(source));
+    end_bulk_load();
+    return result;
+  }
 
-  bool _contains_cycles{false};
-  std::map<NODE_ID_TYPE, node_s> _node_storage;
-  std::map<std::size_t, EDGE_DATA> _edge_storage;
+  //! \brief Attempt to load the graph, resolving, checking and linking
+  //!        the edges on a pool. Nodes are added on the calling thread.
+  //!        Fails on the same node or edge as build_from(source) and keeps
+  //!        the same nodes and edges when it does. Adjacency lists are
+  //!        allocated on the calling thread too, but edge data is copied
+  //!        on the pool, so data allocating from the graph's memory
+  //!        resource needs a thread-safe resource
+  bool build_from(const source_s& source, thread_pool_c& pool) {
+    begin_bulk_load();
+    const bool result = load_from(source, pool);
+    end_bulk_load();
+    return result;
+  }
 
-  bool _cache_enabled{true};
-  std::size_t _average_path_len{0};
-  std::map<std::size_t, node_list_t> _cache;
+  //! \brief As above, moving identifiers and edge data out of the source
+  bool build_from(source_s&& source, thread_pool_c& pool) {
+    begin_bulk_load();
+    const bool result = load_from(std::move(source), pool);
+    end_bulk_load();
+    return result;
+  }
 
-  static constexpr std::size_t merge_ids(
-      const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
-    return std::hash<NODE_ID_TYPE>{}(from) ^ 
-           (std::hash<NODE_ID_TYPE>{}(to) << 1);
+  //! \brief Start streaming nodes and edges in (see builder_c). The
+  //!        expected counts are only used to reserve space
+  builder_c stream(const std::size_t& expected_nodes = 0, const std::size_t& expected_edges = 0) {
+    return builder_c(this, expected_nodes, expected_edges);
   }
 
-  inline node_s* load_node(const NODE_ID_TYPE& x) {
-    const auto it = _node_storage.find(x);
-    if (it == _node_storage.end()) { return nullptr; }
-    return &it->second;
-  } 
+  //! \brief Load the graph from producer(builder), which may call
+  //!        add_node and add_edge on the builder in any order
+  template<class PRODUCER>
+  bool stream_from(
+    const std::size_t& expected_nodes,
+    const std::size_t& expected_edges,
+    PRODUCER&& producer) {
 
-  inline EDGE_DATA* get_edge(const NODE_ID_TYPE* from, const NODE_ID_TYPE* to) {
-    if (!from || !to) { return nullptr; }
-    const std::size_t id = merge_ids(*from, *to);
-    const auto it = _edge_storage.find(id);
-    if (it == _edge_storage.end()) { return nullptr; }
-    return &it->second;
+    auto builder = stream(expected_nodes, expected_edges);
+    producer(builder);
+    return builder.finish();
+  }
+
+  //! \brief Start a bulk load. Until the matching end_bulk_load, adding
+  //!        nodes and edges does no cache work at all and trace bypasses
+  //!        the cache. Calls may nest
+  void begin_bulk_load() {
+    _bulk_loads++;
+  }
+
+  //! \brief End a bulk load. The cache is cleared once, when the
+  //!        outermost bulk load ends
+  void end_bulk_load() {
+    if (_bulk_loads && --_bulk_loads == 0) {
+      clear_cache();
+    }
+  }
+
+  //! \brief Add a new node by copy (must have unique id). A node without
+  //!        edges changes no existing path, so the cache is kept
+  bool add_node(const NODE_ID_TYPE& id) {
+    return insert_node(id);
+  }
+
+  //! \brief Add a new node, moving the identifier in (must have unique id)
+  bool add_node(NODE_ID_TYPE&& id) {
+    return insert_node(std::move(id));
+  }
+
+  //! \brief Add an edge (must be a unique pair of nodes). Only cached
+  //!        paths the new edge could shorten are dropped from the cache
+  bool add_edge(
+    const NODE_ID_TYPE& from,
+    const NODE_ID_TYPE& to,
+    const EDGE_DATA& edge_data) {
+    return emplace_edge(from, to, edge_data);
+  }
+
+  //! \brief Add an edge, moving its data in (must be a unique pair of nodes)
+  bool add_edge(
+    const NODE_ID_TYPE& from,
+    const NODE_ID_TYPE& to,
+    EDGE_DATA&& edge_data) {
+    return emplace_edge(from, to, std::move(edge_data));
   }
 
-  inline bool find(
-    const NODE_ID_TYPE& from, 
+  //! \brief Add an edge whose data is constructed in place from args
+  //!        (must be a unique pair of nodes). Nothing is constructed if
+  //!        the edge cannot be added
+  template<class... ARGS>
+  bool emplace_edge(
+    const NODE_ID_TYPE& from,
     const NODE_ID_TYPE& to,
-    node_list_t& path,
-    const std::size_t& reservation) {
+    ARGS&&... args) {
+
+    auto* to_node = load_node(to);
+    if (!to_node) { return false; }
 
-    auto& node = _node_storage[from];
-    if (node.marked) {
+    auto* from_node = load_node(from);
+    if (!from_node) { return false; }
+
+    const auto key = edge_index_c::make_key(from_node->index, to_node->index);
+    if (!_edge_index.insert(key, static_cast<std::uint32_t>(_edge_storage.size()))) {
       return false;
     }
-    
-    path.push_back(&node);
-
-    if (node.id == to) {
-      return true;
+  
+    if (!_bulk_loads) {
+      invalidate_for_edge(from_node);
+      _weighted_cache.clear();
     }
-    
-    std::vector<node_list_t> traversed_path;
-    traversed_path.reserve(node.out.size());
+    const auto edge = static_cast<std::uint32_t>(_edge_storage.size());
+    touch(from_node->index);
+    from_node->out.push_back(to_node);
+    from_node->out_edges.push_back(edge);
+    to_node->in.push_back(from_node);
+    to_node->in_edges.push_back(edge);
+    _edge_ends.push_back({from_node->index, to_node->index});
+    _edge_storage.emplace_back(std::forward<ARGS>(args)...);
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+    return true;
+  }
 
-    node.marked = true;
+  //! \brief Remove an edge in O(out degree of from + in degree of to).
+  //!        Its slot is left empty until compact(), so pointers to the
+  //!        data of other edges stay valid. Removing an edge lengthens no
+  //!        path that avoids it, so only cached paths crossing it are
+  //!        dropped from the cache
+  bool remove_edge(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    auto* to_node = load_node(to);
+    if (!to_node) { return false; }
 
-    for(auto* neighbor : node.out) {
-      GRAPH_DBG(fmt::format("{} scanning {}\n", node.id, neighbor->id))
+    auto* from_node = load_node(from);
+    if (!from_node) { return false; }
 
-      node_list_t current_path;
-      current_path.reserve(path.capacity());
-      if (find(neighbor->id, to, current_path, reservation)) {
-        traversed_path.push_back({current_path});
-        GRAPH_DBG("\n-FOUND-\n")
-      }
+    const auto* slot = _edge_index.find(edge_index_c::make_key(from_node->index, to_node->index));
+    if (!slot) { return false; }
+    const auto edge = *slot;
+    unlink_edge(edge);
 
-      GRAPH_DBG((current_path.size()) ? "\nPATH:" : "")
-      for(auto*x : current_path) {
-        reinterpret_cast<node_s*>(x)->marked = false;
-        GRAPH_DBG(fmt::format(" {}", *x->data()))
+    if (!_bulk_loads) {
+      _cache.erase_if([from_node, to_node](const auto&, const auto& path) {
+        for(std::size_t i = 1; i < path.size(); i++) {
+          if (path[i - 1] == from_node && path[i] == to_node) { return true; }
+        }
+        return false;
+      });
+      auto crosses = [edge](const auto&, const auto& edges) {
+        return std::find(edges.begin(), edges.end(), edge) != edges.end();
       };
-      GRAPH_DBG((current_path.size()) ? "\n\n" : "")
+      _edge_cache.erase_if(crosses);
+      _weighted_cache.erase_if(crosses);
     }
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+    return true;
+  }
 
-    node.marked = false;
+  //! \brief Remove a node and every edge into or out of it, in O(degree)
+  //!        plus the degree of each neighbor. Its slot is left empty until
+  //!        compact(), so other node_if pointers stay valid and the id may
+  //!        be added again as a new node. Only cached paths through the
+  //!        node are dropped from the cache
+  bool remove_node(const NODE_ID_TYPE& id) {
+    auto* node = load_node(id);
+    if (!node) { return false; }
 
-    if (traversed_path.empty()){
-      path.pop_back();
-      return false;
+    while (!node->out_edges.empty()) {
+      unlink_edge(node->out_edges.back());
     }
-
-    std::size_t idx{0};
-    std::size_t smallest = std::numeric_limits<std::size_t>::max();
-    for(std::size_t i = 0; i < traversed_path.size(); i++) {
-      if (traversed_path[i].size() < smallest) {
-        smallest = traversed_path[i].size();
-        idx = i;
-      }
+    while (!node->in_edges.empty()) {
+      unlink_edge(node->in_edges.back());
     }
+    _node_index.erase(node->id, key_of());
+    node->removed = true;
+    _removed_nodes++;
+    touch(node->index);
 
-    path.insert(
-      path.end(),
-      traversed_path[idx].begin(),
-      traversed_path[idx].end());
+    if (!_bulk_loads) {
+      _cache.erase_if([node](const auto&, const auto& path) {
+        return std::find(path.begin(), path.end(), node) != path.end();
+      });
+      // Every edge of such a path, except one just removed, is live
+      auto touches = [this, node](const auto& key, const auto& edges) {
+        if (edge_index_c::key_from(key) == node->index) { return true; }
+        return std::any_of(edges.begin(), edges.end(), [this](const std::uint32_t& edge) {
+          return _edge_ends[edge].from == REMOVED;
+        });
+      };
+      _edge_cache.erase_if(touches);
+      _weighted_cache.erase_if(touches);
+    }
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+    return true;
+  }
+
+  //! \brief Number of nodes in the graph
+  std::size_t node_count() const { return _nodes.size() - _removed_nodes; }
+
+  //! \brief Number of edges in the graph
+  std::size_t edge_count() const { return _edge_storage.size() - _removed_edges; }
+
+  //! \brief Reclaim the slots left by removed nodes and edges. Every node
+  //!        and edge is renumbered and moved, so this invalidates node_if
+  //!        and edge data pointers, indices (and indexed paths) and path
+  //!        views, and clears the cache. freeze() never includes removed
+  //!        slots, so there is no need to compact before it
+  void compact() {
+    if (!_removed_nodes && !_removed_edges) { return; }
+
+    std::vector<std::uint32_t> node_map(_nodes.size(), REMOVED);
+    std::pmr::deque<node_s> nodes{_resource};
+    for(auto& node : _nodes) {
+      if (node.removed) { continue; }
+      node_map[node.index] = static_cast<std::uint32_t>(nodes.size());
+      auto& moved = nodes.emplace_back(std::move(node.id), _resource);
+      moved.index = node_map[node.index];
+    }
+
+    std::vector<std::uint32_t> edge_map(_edge_storage.size(), REMOVED);
+    std::pmr::deque<EDGE_DATA> storage{_resource};
+    std::pmr::vector<edge_ends_s> ends{_resource};
+    ends.reserve(edge_count());
+    for(std::size_t edge = 0; edge < _edge_ends.size(); edge++) {
+      if (_edge_ends[edge].from == REMOVED) { continue; }
+      edge_map[edge] = static_cast<std::uint32_t>(ends.size());
+      ends.push_back({node_map[_edge_ends[edge].from], node_map[_edge_ends[edge].to]});
+      storage.push_back(std::move(_edge_storage[edge]));
+    }
+
+    for(auto& node : _nodes) {
+      if (node.removed) { continue; }
+      auto& moved = nodes[node_map[node.index]];
+      moved.out.reserve(node.out.size());
+      moved.out_edges.reserve(node.out.size());
+      for(std::size_t i = 0; i < node.out.size(); i++) {
+        moved.out.push_back(&nodes[node_map[node.out[i]->index]]);
+        moved.out_edges.push_back(edge_map[node.out_edges[i]]);
+      }
+      moved.in.reserve(node.in.size());
+      moved.in_edges.reserve(node.in.size());
+      for(std::size_t i = 0; i < node.in.size(); i++) {
+        moved.in.push_back(&nodes[node_map[node.in[i]->index]]);
+        moved.in_edges.push_back(edge_map[node.in_edges[i]]);
+      }
+    }
+
+    clear_cache();
+    _nodes.swap(nodes);
+    _edge_storage.swap(storage);
+    _edge_ends.swap(ends);
+
+    _node_index.clear();
+    _node_index.reserve(_nodes.size());
+    for(auto& node : _nodes) {
+      _node_index.insert(node.id, node.index, key_of());
+    }
+    _edge_index.clear();
+    _edge_index.reserve(_edge_ends.size());
+    for(std::size_t edge = 0; edge < _edge_ends.size(); edge++) {
+      _edge_index.insert(
+        edge_index_c::make_key(_edge_ends[edge].from, _edge_ends[edge].to),
+        static_cast<std::uint32_t>(edge));
+    }
+
+    _removed_nodes = 0;
+    _removed_edges = 0;
+    if (_tracking) {
+      _changes.nodes.clear();
+      _changes.renumbered = true;
+    }
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+  }
+
+  //! \brief Manually clear the cache
+  inline void clear_cache() {
+    _cache.clear();
+    _edge_cache.clear();
+    _weighted_cache.clear();
+  }
+
+  //! \brief Bound the cache by entry count and/or bytes, evicting the
+  //!        least recently used paths (CLOCK) to stay within them.
+  //!        Zero limits mean unbounded. The limits apply separately to
+  //!        the paths cached by trace, trace_with_edges and the cached
+  //!        trace_weighted. Clears the cache
+  void set_cache_limits(const path_cache_limits_s& limits) {
+    _cache.set_limits(limits);
+    _edge_cache.set_limits(limits);
+    _weighted_cache.set_limits(limits);
+  }
+
+  //! \brief Retrieve hit, miss and eviction counters and the memory
+  //!        held by the cache
+  path_cache_stats_s cache_stats() const {
+    auto stats = _cache.stats();
+    stats += _edge_cache.stats();
+    stats += _weighted_cache.stats();
+    return stats;
+  }
+
+  //! \brief Enable/ disable the cache (clears when called)
+  void toggle_cache(const bool& is_enabled) {
+    _cache_enabled = is_enabled;
+    return clear_cache();
+  }
+
+  //! \brief Totals over every trace since the graph was created or
+  //!        reset_stats was called. Search counters and times are only
+  //!        kept when built with GRAPH_ENABLE_STATS (see GraphStats.hpp);
+  //!        the cache counters always are
+  graph_stats_s stats() const {
+    graph_stats_s result;
+    GRAPH_STAT(_counters.read(result))
+    const auto cache = cache_stats();
+    result.cache_hits = cache.hits - _stats_base.hits;
+    result.cache_misses = cache.misses - _stats_base.misses;
+    result.invalidations = cache.invalidations - _stats_base.invalidations;
+    return result;
+  }
+
+  //! \brief Start the totals reported by stats() over from zero
+  void reset_stats() {
+    GRAPH_STAT(_counters.reset())
+    _stats_base = cache_stats();
+  }
+
+  //! \brief Called after every trace, on the thread that ran it, with
+  //!        what the trace did. It may run on several threads at once.
+  //!        Only called when built with GRAPH_ENABLE_STATS
+  using trace_hook_t = std::function<void(const trace_stats_s&)>;
+  void set_trace_hook(trace_hook_t hook) {
+    GRAPH_STAT(_trace_hook = std::move(hook))
+    static_cast<void>(hook);
+  }
+
+  //! \brief Select the algorithm trace uses. Both return a
+  //!        fewest-hop path, but may choose different routes
+  //!        when several paths tie for the shortest
+  void set_search_strategy(const search_strategy_e& strategy) {
+    _search_strategy = strategy;
+    return clear_cache();
+  }
+
+  //! \brief Retrieve the algorithm trace is currently using
+  search_strategy_e search_strategy() const {
+    return _search_strategy;
+  }
+
+  //! \brief Attempt to optimize trace by calculating average
+  //!        path length in the cache for memory reservation
+  //!        on trace calls
+  bool optimize_trace() {
+    if (!_cache_enabled) { return false; }
+    std::size_t total_paths_len{0};
+    std::size_t total_paths{0};
+    _cache.for_each([&](const auto&, const auto& path) {
+      total_paths_len += path.size();
+      total_paths++;
+    });
+    if (!total_paths) { return false; }
+    _average_path_len.store(
+      std::ceil(total_paths_len / total_paths), std::memory_order_relaxed);
+    return true;
+  }
+
+  //! \brief Hash of the nodes and edges, by identifier. It does not
+  //!        depend on the order they were added in, on storage policy or
+  //!        on edge data, so graphs loaded from the same nodes and edges
+  //!        hash the same. Needs std::string or trivially copyable
+  //!        identifiers
+  std::uint64_t content_hash() const {
+    using id_bytes_t = detail::id_bytes_s<NODE_ID_TYPE>;
+    scratch_arena_c::scope_c arena;
+    std::pmr::vector<std::uint64_t> hashes(_nodes.size(), 0, arena.resource());
+
+    // Sums of mixed terms, so the order of nodes and edges does not matter
+    std::uint64_t nodes{0};
+    for(auto& node : _nodes) {
+      if (node.removed) { continue; }
+      hashes[node.index] = id_bytes_t::hash(node.id);
+      nodes += mix64(hashes[node.index]);
+    }
+    std::uint64_t edges{0};
+    for(auto& ends : _edge_ends) {
+      if (ends.from == REMOVED) { continue; }
+      edges += mix64(hashes[ends.from] ^ mix64(hashes[ends.to] + 0x9e3779b97f4a7c15ULL));
+    }
+    return mix64(nodes ^ mix64(edges + node_count()) ^ edge_count());
+  }
+
+  //! \brief Write the path cache to a file that load_cache can restore
+  //!        into this graph after a restart, or into any graph with the
+  //!        same content_hash(). Paths used since the eviction hand last
+  //!        passed them are written first; max_paths (zero for all)
+  //!        bounds how many are written. Safe to call while other threads
+  //!        trace. Needs std::string or trivially copyable identifiers
+  //! \returns false if the cache is disabled or the file could not be written
+  bool save_cache(const std::string& path, const std::size_t& max_paths = 0) const {
+    using id_bytes_t = detail::id_bytes_s<NODE_ID_TYPE>;
+    using header_t = cache_file_header_s;
+    static constexpr std::uint32_t UNLISTED = std::numeric_limits<std::uint32_t>::max();
+    if (!_cache_enabled) { return false; }
+
+    // Paths are copied out under the shard locks, as positions in the id
+    // list, so nothing written refers to the cache once its lock is let go
+    scratch_arena_c::scope_c arena;
+    std::pmr::vector<std::uint32_t> listed(_nodes.size(), UNLISTED, arena.resource());
+    std::vector<const node_s*> ids;
+    std::vector<char> paths;
+    std::uint64_t path_count{0};
+
+    for(const bool hot : {true, false}) {
+      _cache.for_each_with_use([&](const auto&, const auto& nodes, const bool& referenced) {
+        if (referenced != hot || (max_paths && path_count == max_paths)) { return; }
+        const auto length = static_cast<std::uint32_t>(nodes.size());
+        id_bytes_t::append(paths, &length, sizeof(length));
+        for(auto* node_ptr : nodes) {
+          auto* node = static_cast<const node_s*>(node_ptr);
+          if (listed[node->index] == UNLISTED) {
+            listed[node->index] = static_cast<std::uint32_t>(ids.size());
+            ids.push_back(node);
+          }
+          id_bytes_t::append(paths, &listed[node->index], sizeof(std::uint32_t));
+        }
+        path_count++;
+      });
+    }
+
+    std::vector<char> body;
+    for(auto* node : ids) {
+      id_bytes_t::write(body, node->id);
+    }
+    body.insert(body.end(), paths.begin(), paths.end());
+
+    fnv1a_c checksum;
+    checksum.update(body.data(), body.size());
+
+    header_t header{};
+    std::memcpy(header.magic, header_t::MAGIC, sizeof(header.magic));
+    header.version = header_t::VERSION;
+    header.endian = header_t::ENDIAN_MARK;
+    header.id_kind = (id_bytes_t::STRING) ? 1 : 0;
+    header.id_size = (id_bytes_t::STRING) ? 0 : static_cast<std::uint32_t>(sizeof(NODE_ID_TYPE));
+    header.content_hash = content_hash();
+    header.average_path_len = _average_path_len.load(std::memory_order_relaxed);
+    header.id_count = ids.size();
+    header.path_count = path_count;
+    header.body_size = body.size();
+    header.checksum = checksum.value();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) { return false; }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(body.data(), static_cast<std::streamsize>(body.size()));
+    return static_cast<bool>(file.flush());
+  }
+
+  //! \brief Fill the path cache from a file written by save_cache, and
+  //!        take back the reservation optimize_trace had computed. The
+  //!        file must have been written for a graph with the same
+  //!        content_hash(). Restored paths are fewest-hop paths, though
+  //!        not always the ones a search of this graph would pick between
+  //!        paths of equal length. Paths already cached are replaced
+  //! \returns false, restoring nothing, if the cache is disabled or the
+  //!          file is missing, corrupt, or was written for another graph
+  bool load_cache(const std::string& path) {
+    using id_bytes_t = detail::id_bytes_s<NODE_ID_TYPE>;
+    using header_t = cache_file_header_s;
+    if (!_cache_enabled || _bulk_loads) { return false; }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) { return false; }
+    header_t header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, header_t::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != header_t::VERSION ||
+        header.endian != header_t::ENDIAN_MARK ||
+        header.id_kind != ((id_bytes_t::STRING) ? 1u : 0u) ||
+        header.id_size != ((id_bytes_t::STRING) ? 0u : sizeof(NODE_ID_TYPE)) ||
+        header.content_hash != content_hash()) {
+      return false;
+    }
+
+    const auto body_at = file.tellg();
+    file.seekg(0, std::ios::end);
+    if (static_cast<std::uint64_t>(file.tellg() - body_at) != header.body_size) { return false; }
+    file.seekg(body_at);
+
+    std::vector<char> body(header.body_size);
+    if (!file.read(body.data(), static_cast<std::streamsize>(body.size()))) { return false; }
+    fnv1a_c checksum;
+    checksum.update(body.data(), body.size());
+    if (checksum.value() != header.checksum) { return false; }
+
+    // Everything is checked before the first path goes into the cache
+    const char* at = body.data();
+    const char* end = body.data() + body.size();
+    std::vector<node_s*> ids;
+    ids.reserve(header.id_count);
+    NODE_ID_TYPE id{};
+    for(std::uint64_t i = 0; i < header.id_count; i++) {
+      if (!id_bytes_t::read(at, end, id)) { return false; }
+      auto* node = load_node(id);
+      if (!node) { return false; }
+      ids.push_back(node);
+    }
+
+    std::vector<std::pair<std::uint64_t, node_list_t>> restored;
+    restored.reserve(header.path_count);
+    for(std::uint64_t p = 0; p < header.path_count; p++) {
+      std::uint32_t length;
+      if (!id_bytes_t::take(at, end, &length, sizeof(length)) || !length) { return false; }
+      node_list_t nodes;
+      nodes.reserve(length);
+      for(std::uint32_t i = 0; i < length; i++) {
+        std::uint32_t listed;
+        if (!id_bytes_t::take(at, end, &listed, sizeof(listed)) || listed >= ids.size()) { return false; }
+        if (!nodes.empty() && !_edge_index.find(edge_index_c::make_key(
+              static_cast<node_s*>(nodes.back())->index, ids[listed]->index))) {
+          return false;
+        }
+        nodes.push_back(ids[listed]);
+      }
+      const auto key = edge_index_c::make_key(
+        static_cast<node_s*>(nodes.front())->index, static_cast<node_s*>(nodes.back())->index);
+      restored.emplace_back(key, std::move(nodes));
+    }
+    if (at != end) { return false; }
+
+    for(auto& [key, nodes] : restored) {
+      _cache.insert(key, nodes);
+    }
+    if (header.average_path_len) {
+      _average_path_len.store(header.average_path_len, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  //! \brief Attempt to find a path between two nodes.
+  //!        Will return the shortest path found. Any number of threads
+  //!        may trace (and load_edges) at once, provided none of them
+  //!        changes the graph or its settings meanwhile
+  std::optional<node_list_t> trace(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::TRACE))
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+  
+    const auto merged_ids = edge_index_c::make_key(from_node->index, to_node->index);
+
+    node_list_t result;
+
+    std::size_t reservation{DEFAULT_TRACE_RESERVATION};
+
+    const bool use_cache = _cache_enabled && !_bulk_loads;
+
+    if (use_cache) {
+      if (_cache.find(merged_ids, result)) {
+        GRAPH_STAT(probe.hit())
+        return {std::move(result)};
+      }
+      reservation = _average_path_len.load(std::memory_order_relaxed);
+      result.reserve(reservation);
+    }
+
+    if (!this->find(from_node, to_node, result)) {
+      return std::nullopt;
+    }
+
+    if (use_cache) {
+      _cache.insert(merged_ids, result);
+    }
+
+    GRAPH_STAT(probe.found())
+    return {std::move(result)};
+  }
+
+  //! \brief Copy the cached path between two nodes, if there is one,
+  //!        without searching on a miss
+  std::optional<node_list_t> trace_cached(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) const {
+    if (!_cache_enabled || _bulk_loads) { return std::nullopt; }
+    const auto from_index = index_of(from);
+    if (!from_index) { return std::nullopt; }
+    const auto to_index = index_of(to);
+    if (!to_index) { return std::nullopt; }
+
+    node_list_t result;
+    if (!_cache.find(edge_index_c::make_key(*from_index, *to_index), result)) { return std::nullopt; }
+    return {std::move(result)};
+  }
+
+  //! \brief Like trace, but a cache hit hands back a view of the cached
+  //!        path instead of a copy, so it does not allocate. The view
+  //!        stays readable until it is destroyed, even if the graph
+  //!        changes meanwhile; compare its epoch() with the graph's to
+  //!        tell if it may be stale. Views must not outlive the graph
+  std::optional<path_view_t> trace_view(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::TRACE))
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+
+    const auto key = edge_index_c::make_key(from_node->index, to_node->index);
+
+    if (!_cache_enabled || _bulk_loads) {
+      node_list_t result;
+      if (!this->find(from_node, to_node, result)) { return std::nullopt; }
+      GRAPH_STAT(probe.found())
+      return {path_view_t(std::move(result), _epoch)};
+    }
+
+    if (auto view = _cache.find_view(key, _epoch)) {
+      GRAPH_STAT(probe.hit())
+      return view;
+    }
+
+    // Misses search into a per-thread buffer that is copied into the cache
+    thread_local node_list_t buffer;
+    buffer.clear();
+    if (!this->find(from_node, to_node, buffer)) { return std::nullopt; }
+    GRAPH_STAT(probe.found())
+    return {_cache.insert_view(key, buffer, _epoch)};
+  }
+
+  //! \brief Attempt to find a path between two nodes, returning the
+  //!        nodes and the crossed edges from one traversal, so no
+  //!        load_edges lookups are needed. A path of one node crosses no
+  //!        edges. Cached separately from trace, as edge indices, so a
+  //!        hit is a gather of nodes and edge data
+  std::optional<traced_path_s> trace_with_edges(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::WITH_EDGES))
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+
+    const auto key = edge_index_c::make_key(from_node->index, to_node->index);
+    const bool use_cache = _cache_enabled && !_bulk_loads;
+
+    traced_path_s result;
+    if (use_cache) {
+      if (auto hit = _edge_cache.find_view(key, _epoch)) {
+        GRAPH_STAT(probe.hit())
+        expand(from_node->index, hit->span(), result);
+        return {std::move(result)};
+      }
+    }
+
+    auto& route = route_buffer();
+    if (!this->find(from_node, to_node, route)) { return std::nullopt; }
+
+    if (use_cache) {
+      _edge_cache.insert(key, route.edges);
+    }
+    GRAPH_STAT(probe.found())
+    expand(route.source, route.edges, result);
+    return {std::move(result)};
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes, where
+  //!        crossing an edge costs cost_fn(edge_data) (never negative).
+  //!        Uses Dijkstra's algorithm on a 4-ary heap; not cached
+  template<class COST_FN>
+  auto trace_weighted(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to, COST_FN&& cost_fn) {
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    return trace_weighted(from, to, cost_fn, [](const NODE_ID_TYPE&) { return cost_t{}; });
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes with A*.
+  //!        heuristic(node_id) estimates the remaining cost to `to` and
+  //!        must never overestimate it
+  template<class COST_FN, class HEURISTIC>
+  auto trace_weighted(
+    const NODE_ID_TYPE& from,
+    const NODE_ID_TYPE& to,
+    COST_FN&& cost_fn,
+    HEURISTIC&& heuristic) -> std::optional<weighted_path_s<
+      std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>>> {
+
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::WEIGHTED))
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+
+    auto& route = route_buffer();
+    auto cost = find_weighted<cost_t>(from_node, to_node, cost_fn,
+      [&](const std::uint32_t& node) -> cost_t { return heuristic(_nodes[node].id); },
+      route);
+    if (!cost) { return std::nullopt; }
+    GRAPH_STAT(probe.found())
+
+    weighted_path_s<cost_t> result;
+    expand(route.source, route.edges, result);
+    result.cost = *cost;
+    return {std::move(result)};
+  }
+
+  //! \brief Set the edge cost used by the cached trace_weighted. Clears
+  //!        the paths cached under the previous cost
+  void set_edge_cost(edge_cost_t cost_fn) {
+    _edge_cost = std::move(cost_fn);
+    _weighted_cache.clear();
+  }
+
+  //! \brief Attempt to find the cheapest path under the cost given to
+  //!        set_edge_cost, through the cache. Without a cost set, every
+  //!        edge costs 1
+  std::optional<weighted_path_s<double>> trace_weighted(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::WEIGHTED))
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+
+    const auto key = edge_index_c::make_key(from_node->index, to_node->index);
+    const bool use_cache = _cache_enabled && !_bulk_loads;
+
+    weighted_path_s<double> result;
+    if (use_cache) {
+      if (auto hit = _weighted_cache.find_view(key, _epoch)) {
+        GRAPH_STAT(probe.hit())
+        expand(from_node->index, hit->span(), result);
+        for(auto* edge : result.edges) {
+          result.cost += edge_cost(*edge);
+        }
+        return {std::move(result)};
+      }
+    }
+
+    auto& route = route_buffer();
+    auto cost = find_weighted<double>(from_node, to_node,
+      [this](const EDGE_DATA& edge) { return edge_cost(edge); },
+      [](const std::uint32_t&) { return 0.0; },
+      route);
+    if (!cost) { return std::nullopt; }
+
+    if (use_cache) {
+      _weighted_cache.insert(key, route.edges);
+    }
+    GRAPH_STAT(probe.found())
+    expand(route.source, route.edges, result);
+    result.cost = *cost;
+    return {std::move(result)};
+  }
+
+  //! \brief Count of changes made to the graph so far. Paths traced at
+  //!        different epochs may differ
+  std::uint64_t epoch() const {
+    return _epoch;
+  }
+
+  //! \brief Find fewest-hop paths from one node to every other node in
+  //!        a single breadth-first traversal. Any number of paths can
+  //!        then be pulled from the tree without searching again
+  std::optional<path_tree_c> trace_all_from(const NODE_ID_TYPE& from) {
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+
+    path_tree_c tree(this, from_node->index);
+    tree._parent[from_node->index] = from_node->index;
+    tree._distance[from_node->index] = 0;
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+    breadth_first_from(from_node->index, scratch,
+      [&tree](const std::uint32_t& node, const std::uint32_t& parent) {
+        tree._parent[node] = parent;
+        tree._distance[node] = tree._distance[parent] + 1;
+        return true;
+      });
+    return {std::move(tree)};
+  }
+
+  //! \brief Find every fewest-hop path between two nodes. One
+  //!        breadth-first search, stopped at the target, and one walk back
+  //!        from the target keep just the edges on such paths, so the
+  //!        result is at most the size of the graph however many paths
+  //!        there are
+  std::optional<shortest_paths_c> trace_all_shortest(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+    scratch.depth[from_node->index] = 0;
+
+    bool found = (from_node == to_node);
+    std::uint32_t hops{0};
+    if (!found) {
+      breadth_first_from(from_node->index, scratch,
+        [&](const std::uint32_t& node, const std::uint32_t& parent) {
+          scratch.depth[node] = scratch.depth[parent] + 1;
+          found = (node == to_node->index);
+          hops = scratch.depth[node];
+          return !found;
+        });
+    }
+    if (!found) { return std::nullopt; }
+
+    // Walk back from the target over in edges that come from one level
+    // up, which reaches exactly the nodes on some fewest-hop path, deepest
+    // first. Numbering them in that order means a node's next nodes are
+    // numbered before it
+    auto& kept = scratch.frontier_in;
+    kept.push_back(to_node->index);
+    scratch.visit_in(to_node->index);
+    for(std::size_t head = 0; head < kept.size(); head++) {
+      auto& node = _nodes[kept[head]];
+      if (scratch.depth[node.index] == 0) { continue; }
+      for(auto* previous : node.in) {
+        const auto p = previous->index;
+        if (!scratch.visited(p) || scratch.visited_in(p) ||
+            scratch.depth[p] + 1 != scratch.depth[node.index]) { continue; }
+        scratch.visit_in(p);
+        kept.push_back(p);
+      }
+    }
+
+    shortest_paths_c paths(this, from_node->index, hops);
+    auto& local = scratch.next;
+    std::vector<std::uint64_t> counts(kept.size(), 0);
+    counts[0] = 1;
+    for(std::size_t i = 0; i < kept.size(); i++) {
+      auto& node = _nodes[kept[i]];
+      local[node.index] = static_cast<std::uint32_t>(i);
+      paths._offsets.push_back(static_cast<std::uint32_t>(paths._edges.size()));
+      if (i == 0) { continue; }
+
+      // Out edges rather than the in edges above, for insertion order
+      for(std::size_t j = 0; j < node.out.size(); j++) {
+        const auto next = node.out[j]->index;
+        if (!scratch.visited_in(next) || scratch.depth[next] != scratch.depth[node.index] + 1) { continue; }
+        paths._edges.push_back(node.out_edges[j]);
+        paths._next.push_back(local[next]);
+        counts[i] = (counts[i] > std::numeric_limits<std::uint64_t>::max() - counts[local[next]]) ?
+          std::numeric_limits<std::uint64_t>::max() : counts[i] + counts[local[next]];
+      }
+    }
+    paths._offsets.push_back(static_cast<std::uint32_t>(paths._edges.size()));
+    paths._root = local[from_node->index];
+    paths._count = counts[paths._root];
+    return {std::move(paths)};
+  }
+
+  //! \brief Find up to k fewest-hop simple paths between two nodes,
+  //!        shortest first. The first is found here and the rest as the
+  //!        result is iterated (see k_paths_c)
+  //! \returns nullopt if there is no path at all
+  std::optional<k_paths_c> trace_k(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to, const std::size_t& k) {
+    auto* to_node = load_node(to);
+    if (!to_node) { return std::nullopt; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return std::nullopt; }
+
+    k_paths_c paths(this, from_node->index, to_node->index, k);
+    std::vector<std::uint32_t> first;
+    if (!find_avoiding(from_node->index, to_node->index, {}, {}, first)) { return std::nullopt; }
+    if (k == 0) {
+      paths._done = true;
+      return {std::move(paths)};
+    }
+    paths._found.push_back(std::move(first));
+    expand(from_node->index, paths._found.back(), paths._current);
+    return {std::move(paths)};
+  }
+
+  //! \brief Trace many (from, to) pairs in one call. Queries sharing a
+  //!        source are answered by a single breadth-first search that
+  //!        stops once all of their targets are reached. The cache is
+  //!        neither read nor filled. Routes follow breadth-first tie
+  //!        breaking whatever the selected search strategy
+  batch_result_s trace_batch(std::span<const query_t> queries) {
+    return trace_batch(queries, nullptr);
+  }
+
+  //! \brief Trace many (from, to) pairs, spreading the distinct sources
+  //!        over the workers of a thread pool
+  batch_result_s trace_batch(std::span<const query_t> queries, thread_pool_c& pool) {
+    return trace_batch(queries, &pool);
+  }
+
+  //! \brief Given some result path from trace (or a view of one), load data from
+  //!        all edges that were crossed
+  std::optional<edge_list_t> load_edges(std::span<node_if* const> path) {
+    if (path.empty()) { return std::nullopt; }
+    edge_list_t result;
+    if (path.size() == 1) {
+      auto* edge = get_edge(path[0], path[0]);
+      if (!edge) { return std::nullopt; }
+      result.push_back(edge);
+      return {result};
+    }
+    result.reserve(path.size()-1);
+    for(std::size_t i = 0; i < path.size()-1; i++) {
+      auto* edge = get_edge(path[i], path[i+1]);
+      if (!edge) {return std::nullopt;}
+      result.push_back(edge);
+    }
+    return {result};
+  }
+
+  //! \brief Attempt to find a path between two nodes as plain indices.
+  //!        The path is overwritten; it does not go through the cache
+  //!        and, once it and the search scratch have grown to fit, does
+  //!        not allocate
+  bool trace_indexed(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to, indexed_path_s& path) {
+    GRAPH_STAT(trace_probe_c probe(this, trace_kind_e::INDEXED))
+    auto* to_node = load_node(to);
+    if (!to_node) { return false; }
+
+    auto* from_node = load_node(from);
+    if (!from_node) { return false; }
+    GRAPH_STAT(probe.ends(from_node, to_node))
+
+    if (!this->find(from_node, to_node, path)) { return false; }
+    GRAPH_STAT(probe.found())
+    return true;
+  }
+
+  //! \brief Load the data of every edge crossed by an indexed path
+  //!        (none for a path of one node). The edge list is overwritten
+  bool load_edges(const indexed_path_s& path, edge_list_t& edges) {
+    edges.resize(path.edges.size());
+    for(std::size_t i = 0; i < path.edges.size(); i++) {
+      if (path.edges[i] >= _edge_storage.size() || _edge_ends[path.edges[i]].from == REMOVED) {
+        return false;
+      }
+      edges[i] = &_edge_storage[path.edges[i]];
+    }
+    return true;
+  }
+
+  //! \brief Expand an indexed path to the dense index of each of its
+  //!        nodes. The node list is overwritten
+  void path_nodes(const indexed_path_s& path, std::vector<std::uint32_t>& nodes) const {
+    nodes.resize(path.size());
+    nodes[0] = path.source;
+    for(std::size_t i = 0; i < path.edges.size(); i++) {
+      nodes[i + 1] = _edge_ends[path.edges[i]].to;
+    }
+  }
+
+  //! \brief Find the dense index of a node
+  std::optional<std::uint32_t> index_of(const NODE_ID_TYPE& id) const {
+    const auto* idx = _node_index.find(id, key_of());
+    if (!idx) { return std::nullopt; }
+    return {*idx};
+  }
+
+  //! \brief Retrieve the identifier of a node by dense index
+  const NODE_ID_TYPE& id_of(const std::uint32_t& node) const {
+    return _nodes[node].id;
+  }
+
+  //! \brief Retrieve the dense index of the node an edge leaves (the
+  //!        maximum index for an edge removed since the path was traced)
+  std::uint32_t edge_source(const std::uint32_t& edge) const {
+    return _edge_ends[edge].from;
+  }
+
+  //! \brief Retrieve the dense index of the node an edge enters
+  std::uint32_t edge_target(const std::uint32_t& edge) const {
+    return _edge_ends[edge].to;
+  }
+
+  //! \brief Retrieve the data of an edge by index
+  EDGE_DATA& edge_data(const std::uint32_t& edge) {
+    return _edge_storage[edge];
+  }
+
+  //! \brief Retrieve the data of an edge by index
+  const EDGE_DATA& edge_data(const std::uint32_t& edge) const {
+    return _edge_storage[edge];
+  }
+
+  //! \brief One past the highest dense index, counting the slots left by
+  //!        removed nodes
+  std::size_t index_limit() const { return _nodes.size(); }
+
+  //! \brief Check if a dense index names a node that was not removed
+  bool contains_index(const std::uint32_t& node) const {
+    return node < _nodes.size() && !_nodes[node].removed;
+  }
+
+  //! \brief Call fn(target, edge) with the dense index of the target and
+  //!        the index of the edge, for every out edge of a node in the
+  //!        order they were added
+  template<class FN>
+  void for_each_out(const std::uint32_t& node, FN&& fn) const {
+    const auto& from = _nodes[node];
+    for(std::size_t i = 0; i < from.out.size(); i++) {
+      fn(from.out[i]->index, from.out_edges[i]);
+    }
+  }
+
+  //! \brief Nodes changed since changes were last taken (see
+  //!        track_changes)
+  struct changes_s {
+    std::vector<std::uint32_t> nodes; //! Dense indices, unordered and maybe repeated
+    bool renumbered{false};           //! compact() ran, so every index changed
+  };
+
+  //! \brief Start or stop recording which nodes change: every node added
+  //!        or removed, and every node an edge is added to or removed from
+  //!        the out list of. Snapshots kept up to date incrementally (see
+  //!        versioned_graph_c) rebuild only what was recorded. Stopping
+  //!        drops what was recorded
+  void track_changes(const bool& enabled) {
+    _tracking = enabled;
+    _changes = {};
+  }
+
+  //! \brief Record that the out edges of a node changed where the graph
+  //!        cannot see it, through edge data edited in place
+  void mark_changed(const std::uint32_t& node) {
+    touch(node);
+  }
+
+  //! \brief Hand over what was recorded since the last call, and start
+  //!        recording afresh
+  changes_s take_changes() {
+    return std::exchange(_changes, {});
+  }
+
+  //! \brief Create a read-only compressed sparse row snapshot of the
+  //!        graph for read-heavy use. Edge data is copied, so later
+  //!        changes to this graph are not reflected in the snapshot
+  frozen_t freeze() const {
+    using index_t = typename frozen_t::index_t;
+
+    // Frozen indices follow identifier order so lookup is a binary search
+    std::vector<const node_s*> sorted;
+    sorted.reserve(node_count());
+    for(auto& node : _nodes) {
+      if (!node.removed) { sorted.push_back(&node); }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const node_s* a, const node_s* b) {
+      return a->id < b->id;
+    });
+
+    std::vector<NODE_ID_TYPE> ids;
+    std::vector<index_t> interned(_nodes.size(), 0);
+    ids.reserve(_nodes.size());
+    for(auto* node : sorted) {
+      interned[node->index] = static_cast<index_t>(ids.size());
+      ids.push_back(node->id);
+    }
+
+    std::vector<index_t> offsets;
+    std::vector<index_t> targets;
+    std::vector<EDGE_DATA> edges;
+    offsets.reserve(ids.size() + 1);
+    targets.reserve(edge_count());
+    edges.reserve(edge_count());
+    offsets.push_back(0);
+
+    // Removed nodes and edges are in no adjacency list, so they are left out
+    std::vector<std::pair<index_t, std::uint32_t>> row;
+    for(auto* node : sorted) {
+      row.clear();
+      for(std::size_t i = 0; i < node->out.size(); i++) {
+        row.push_back({interned[node->out[i]->index], node->out_edges[i]});
+      }
+      std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      });
+      for(auto&& [idx, edge] : row) {
+        targets.push_back(idx);
+        edges.push_back(_edge_storage[edge]);
+      }
+      offsets.push_back(static_cast<index_t>(targets.size()));
+    }
+
+    return frozen_t(
+      std::move(ids), std::move(offsets), std::move(targets), std::move(edges));
+  }
+
+  //! \brief Check if the graph contains cycles (a self loop counts)
+  bool contains_cycles() {
+    const auto& cyclic = strongly_connected_components().cyclic;
+    return std::find(cyclic.begin(), cyclic.end(), true) != cyclic.end();
+  }
+
+  //! \brief Find the strongly connected components in O(V+E), without
+  //!        recursion. The result is kept until the graph next changes
+  const components_s& strongly_connected_components() {
+    if (!_components) {
+      _components = find_components();
+    }
+    return *_components;
+  }
+
+  //! \brief Retrieve the strongly connected component a node belongs to
+  std::optional<std::size_t> component_of(const NODE_ID_TYPE& id) {
+    auto* node = load_node(id);
+    if (!node) { return std::nullopt; }
+    return {strongly_connected_components().component[node->index]};
+  }
+
+  //! \brief Build the reachability index over the strongly connected
+  //!        components, in O(V+E). It is kept until the graph next
+  //!        changes; meanwhile every trace between nodes the index rules
+  //!        out returns nothing without searching. Like changing the
+  //!        graph, this must not run while other threads trace
+  void index_reachability() {
+    if (!_reach) {
+      _reach = build_reach_index();
+    }
+  }
+
+  //! \brief Check whether a path leads from one node to another, building
+  //!        the reachability index first if needed. Most unreachable
+  //!        pairs are answered from the index labels alone; other pairs
+  //!        search the condensed graph, skipping what the labels rule out
+  bool reachable(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to) {
+    auto* from_node = load_node(from);
+    if (!from_node) { return false; }
+    auto* to_node = load_node(to);
+    if (!to_node) { return false; }
+    index_reachability();
+    return _reach->reachable(from_node->index, to_node->index);
+  }
+
+private:
+  static constexpr std::size_t DEFAULT_TRACE_RESERVATION = 5;
+
+  struct node_s : public node_if {
+    node_s(NODE_ID_TYPE id, std::pmr::memory_resource* resource)
+      : node_if(),
+        id(std::move(id)),
+        out(resource),
+        in(resource),
+        out_edges(resource),
+        in_edges(resource) {}
+
+    // Nodes never move: node_if pointers and adjacency lists refer to them
+    node_s(const node_s&) = delete;
+    node_s& operator=(const node_s&) = delete;
+
+    NODE_ID_TYPE id;
+    std::uint32_t index{0};
+    std::pmr::vector<node_s*> out;
+    std::pmr::vector<node_s*> in;
+    std::pmr::vector<std::uint32_t> out_edges; //! Edge index of each out neighbor
+    std::pmr::vector<std::uint32_t> in_edges;  //! Edge index of each in neighbor
+    bool removed{false};                       //! Slot left behind by remove_node
+  };
+
+  struct edge_ends_s {
+    std::uint32_t from;
+    std::uint32_t to;
+  };
+
+  // Both ends of an edge slot left behind by remove_edge
+  static constexpr std::uint32_t REMOVED = std::numeric_limits<std::uint32_t>::max();
+
+  std::optional<components_s> _components;
+  std::optional<reach_index_c> _reach;
+  std::uint64_t _epoch{0};
+  search_strategy_e _search_strategy{search_strategy_e::BREADTH_FIRST};
+
+  std::pmr::memory_resource* _resource{std::pmr::get_default_resource()};
+
+  // Nodes live in a deque, positioned by their index, so node_if pointers
+  // stay valid as nodes are added. The storage policy maps identifiers
+  // to indices
+  std::pmr::deque<node_s> _nodes{_resource};
+  typename STORAGE::template index_t<NODE_ID_TYPE> _node_index;
+
+  // Edge data lives in a deque so pointers handed out by load_edges
+  // stay valid as edges are added. The index maps a pair of node
+  // indices to a position in the deque
+  edge_index_c _edge_index;
+  std::pmr::deque<EDGE_DATA> _edge_storage{_resource};
+  std::pmr::vector<edge_ends_s> _edge_ends{_resource};
+  std::size_t _removed_nodes{0};
+  std::size_t _removed_edges{0};
+
+  // What changed since take_changes, while tracking (see track_changes)
+  bool _tracking{false};
+  changes_s _changes;
+
+  path_cache_stats_s _stats_base;
+#ifdef GRAPH_ENABLE_STATS
+  graph_counters_c _counters;
+  trace_hook_t _trace_hook;
+
+  //! \brief Times one query and, when it ends, adds what the searches
+  //!        on this thread did meanwhile to the totals and the hook
+  class trace_probe_c {
+  public:
+    trace_probe_c(graph_c* graph, const trace_kind_e& kind)
+      : _graph(graph),
+        _start(std::chrono::steady_clock::now()) {
+      auto& scratch = search_scratch_c::local();
+      scratch.nodes_visited = 0;
+      scratch.edges_scanned = 0;
+      _query.kind = kind;
+    }
+
+    ~trace_probe_c() {
+      const auto& scratch = search_scratch_c::local();
+      _query.nodes_visited = scratch.nodes_visited;
+      _query.edges_scanned = scratch.edges_scanned;
+      _query.nanoseconds = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - _start).count());
+      _graph->_counters.add(_query);
+      if (_graph->_trace_hook) { _graph->_trace_hook(_query); }
+    }
+
+    trace_probe_c(const trace_probe_c&) = delete;
+    trace_probe_c& operator=(const trace_probe_c&) = delete;
+
+    void ends(const node_s* from, const node_s* to) {
+      _query.from = from->index;
+      _query.to = to->index;
+    }
+    void found() { _query.found = true; }
+    void hit() { _query.found = _query.cache_hit = true; }
+
+  private:
+    graph_c* _graph;
+    std::chrono::steady_clock::time_point _start;
+    trace_stats_s _query;
+  };
+#endif
+
+  bool _cache_enabled{true};
+  std::size_t _bulk_loads{0};
+  std::atomic<std::size_t> _average_path_len{0};
+  path_cache_c<node_if*> _cache;
+
+  // Paths cached by trace_with_edges, as the edge index of each hop (the
+  // source is part of the key)
+  path_cache_c<std::uint32_t> _edge_cache;
+
+  // Cheapest paths under _edge_cost, also as edge indices. Any new edge
+  // can make any of them cheaper, so adding one clears them all
+  path_cache_c<std::uint32_t> _weighted_cache;
+  edge_cost_t _edge_cost;
+
+  //! \brief Record a changed node, when tracking changes
+  void touch(const std::uint32_t& node) {
+    if (_tracking) { _changes.nodes.push_back(node); }
+  }
+
+  //! \brief Shared body of both add_node overloads
+  template<class ID>
+  bool insert_node(ID&& id) {
+    if (load_node(id)) { return false; }
+
+    auto& node = _nodes.emplace_back(std::forward<ID>(id), _resource);
+    node.index = static_cast<std::uint32_t>(_nodes.size() - 1);
+    _node_index.insert(node.id, node.index, key_of());
+    touch(node.index);
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+    return true;
+  }
+
+  //! \brief Add every node then every edge of a source, moving them out
+  //!        of it when it is an rvalue
+  template<class SOURCE>
+  inline bool load_from(SOURCE&& source) {
+    _edge_index.reserve(_edge_storage.size() + source.edges.size());
+    _edge_ends.reserve(_edge_storage.size() + source.edges.size());
+    if (!load_nodes<SOURCE>(source.nodes)) { return false; }
+    for(auto& edge : source.edges) {
+      if (!emplace_edge(edge.from, edge.to, pass<SOURCE>(edge.data))) {
+        GRAPH_DBG("Failed to add edge\n")
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! \brief A member of a source, as a copy or a move depending on
+  //!        whether the source itself was an lvalue
+  template<class SOURCE, class T>
+  static decltype(auto) pass(T& value) {
+    if constexpr (std::is_lvalue_reference_v<SOURCE>) {
+      return std::as_const(value);
+    } else {
+      return std::move(value);
+    }
+  }
+
+  template<class SOURCE, class NODES>
+  bool load_nodes(NODES& nodes) {
+    _node_index.reserve(_nodes.size() + nodes.size());
+    for(auto& node : nodes) {
+      if (!add_node(pass<SOURCE>(node))) {
+        GRAPH_DBG("Failed to add node\n")
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! \brief load_from on a pool. Edges are resolved in chunks, then
+  //!        partitioned by source node range, where each range is sorted
+  //!        to find repeated pairs and owns the out lists of its nodes,
+  //!        and again by target range for the in lists. The first bad
+  //!        edge (missing node or repeated pair) is found as the lowest
+  //!        failing position, so exactly the edges build_from would have
+  //!        kept before it are linked
+  template<class SOURCE>
+  bool load_from(SOURCE&& source, thread_pool_c& pool) {
+    if (!load_nodes<SOURCE>(source.nodes)) { return false; }
+
+    const std::size_t count = source.edges.size();
+    if (count == 0) { return true; }
+
+    const std::size_t base = _edge_storage.size();
+    const std::size_t tasks = std::min(count, pool.size() * 4 + 1);
+    const std::size_t chunk = (count + tasks - 1) / tasks;
+    const std::size_t nodes = _nodes.size();
+    auto chunk_range = [&](const std::size_t& c) {
+      return std::pair{c * chunk, std::min(count, (c + 1) * chunk)};
+    };
+
+    std::atomic<std::size_t> first_bad{count};
+    auto fail = [&first_bad](const std::size_t& position) {
+      auto seen = first_bad.load(std::memory_order_relaxed);
+      while (position < seen && !first_bad.compare_exchange_weak(seen, position)) {}
+    };
+
+    // The node index is only read from here on
+    std::vector<edge_ends_s> ends(count);
+    pool.parallel_for(tasks, [&](const std::size_t& c) {
+      const auto [begin, end] = chunk_range(c);
+      for(std::size_t i = begin; i < end; i++) {
+        auto* to_node = load_node(source.edges[i].to);
+        auto* from_node = (to_node) ? load_node(source.edges[i].from) : nullptr;
+        if (!from_node) {
+          ends[i] = {REMOVED, REMOVED};
+          fail(i);
+          continue;
+        }
+        ends[i] = {from_node->index, to_node->index};
+      }
+    });
+
+    // Stable counting partition of the valid edge positions into node
+    // ranges, by one end. Range r spans [starts[r], starts[r+1])
+    auto partition = [&](auto end_of, std::vector<std::uint32_t>& positions, std::vector<std::size_t>& starts) {
+      auto range_of = [&](const edge_ends_s& edge) {
+        return static_cast<std::size_t>(static_cast<std::uint64_t>(end_of(edge)) * tasks / nodes);
+      };
+      std::vector<std::size_t> counts(tasks * tasks, 0);
+      pool.parallel_for(tasks, [&](const std::size_t& c) {
+        const auto [begin, end] = chunk_range(c);
+        for(std::size_t i = begin; i < end; i++) {
+          if (ends[i].from != REMOVED) { counts[range_of(ends[i]) * tasks + c]++; }
+        }
+      });
+      starts.assign(tasks + 1, 0);
+      std::size_t total{0};
+      for(std::size_t r = 0; r < tasks; r++) {
+        starts[r] = total;
+        for(std::size_t c = 0; c < tasks; c++) {
+          const auto n = counts[r * tasks + c];
+          counts[r * tasks + c] = total;
+          total += n;
+        }
+      }
+      starts[tasks] = total;
+      positions.resize(total);
+      pool.parallel_for(tasks, [&](const std::size_t& c) {
+        const auto [begin, end] = chunk_range(c);
+        for(std::size_t i = begin; i < end; i++) {
+          if (ends[i].from == REMOVED) { continue; }
+          positions[counts[range_of(ends[i]) * tasks + c]++] = static_cast<std::uint32_t>(i);
+        }
+      });
+    };
+
+    std::vector<std::uint32_t> by_source;
+    std::vector<std::size_t> source_starts;
+    partition([](const edge_ends_s& edge) { return edge.from; }, by_source, source_starts);
+
+    // A pair is repeated by every position after its first, and by its
+    // first too when the graph already had the edge
+    pool.parallel_for(tasks, [&](const std::size_t& r) {
+      std::vector<std::pair<edge_index_c::key_t, std::uint32_t>> keyed;
+      keyed.reserve(source_starts[r + 1] - source_starts[r]);
+      for(auto k = source_starts[r]; k < source_starts[r + 1]; k++) {
+        const auto& edge = ends[by_source[k]];
+        keyed.push_back({edge_index_c::make_key(edge.from, edge.to), by_source[k]});
+      }
+      std::sort(keyed.begin(), keyed.end());
+      for(std::size_t k = 0; k < keyed.size(); k++) {
+        if ((k && keyed[k - 1].first == keyed[k].first) || _edge_index.find(keyed[k].first)) {
+          fail(keyed[k].second);
+        }
+      }
+    });
+
+    const std::size_t kept = first_bad.load();
+    if (kept < count) {
+      GRAPH_DBG("Failed to add edge\n")
+    }
+
+    _edge_storage.resize(base + kept);
+    _edge_ends.resize(base + kept);
+    _edge_index.reserve(base + kept);
+    pool.parallel_for(tasks, [&](const std::size_t& c) {
+      const auto [begin, end] = chunk_range(c);
+      for(std::size_t i = begin; i < std::min(end, kept); i++) {
+        _edge_storage[base + i] = pass<SOURCE>(source.edges[i].data);
+        _edge_ends[base + i] = ends[i];
+        _edge_index.insert_concurrent(
+          edge_index_c::make_key(ends[i].from, ends[i].to), static_cast<std::uint32_t>(base + i));
+      }
+    });
+
+    std::vector<std::uint32_t> by_target;
+    std::vector<std::size_t> target_starts;
+    partition([](const edge_ends_s& edge) { return edge.to; }, by_target, target_starts);
+
+    // Every list grows once, here, so the pool only fills reserved space
+    std::vector<std::uint32_t> out_degree(nodes, 0);
+    std::vector<std::uint32_t> in_degree(nodes, 0);
+    for(std::size_t i = 0; i < kept; i++) {
+      out_degree[ends[i].from]++;
+      in_degree[ends[i].to]++;
+    }
+    for(auto& node : _nodes) {
+      if (out_degree[node.index]) {
+        touch(node.index);
+        node.out.reserve(node.out.size() + out_degree[node.index]);
+        node.out_edges.reserve(node.out_edges.size() + out_degree[node.index]);
+      }
+      if (in_degree[node.index]) {
+        node.in.reserve(node.in.size() + in_degree[node.index]);
+        node.in_edges.reserve(node.in_edges.size() + in_degree[node.index]);
+      }
+    }
+
+    // Positions within a range are in source order, so every list ends
+    // up ordered as if the edges were added one by one
+    pool.parallel_for(tasks, [&](const std::size_t& r) {
+      for(auto k = source_starts[r]; k < source_starts[r + 1]; k++) {
+        const auto i = by_source[k];
+        if (i >= kept) { continue; }
+        auto& from = _nodes[ends[i].from];
+        from.out.push_back(&_nodes[ends[i].to]);
+        from.out_edges.push_back(static_cast<std::uint32_t>(base + i));
+      }
+      for(auto k = target_starts[r]; k < target_starts[r + 1]; k++) {
+        const auto i = by_target[k];
+        if (i >= kept) { continue; }
+        auto& to = _nodes[ends[i].to];
+        to.in.push_back(&_nodes[ends[i].from]);
+        to.in_edges.push_back(static_cast<std::uint32_t>(base + i));
+      }
+    });
+
+    _components.reset();
+    _reach.reset();
+    _epoch++;
+    return kept == count;
+  }
+
+  //! \brief Take an edge out of both adjacency lists and the index and
+  //!        leave its slot empty. Cache work is up to the caller
+  void unlink_edge(const std::uint32_t& edge) {
+    const auto ends = _edge_ends[edge];
+    auto& from = _nodes[ends.from];
+    auto& to = _nodes[ends.to];
+    touch(ends.from);
+
+    const auto out = std::find(from.out_edges.begin(), from.out_edges.end(), edge) - from.out_edges.begin();
+    from.out_edges.erase(from.out_edges.begin() + out);
+    from.out.erase(from.out.begin() + out);
+
+    const auto in = std::find(to.in_edges.begin(), to.in_edges.end(), edge) - to.in_edges.begin();
+    to.in_edges.erase(to.in_edges.begin() + in);
+    to.in.erase(to.in.begin() + in);
+
+    _edge_index.erase(edge_index_c::make_key(ends.from, ends.to));
+    _edge_storage[edge] = EDGE_DATA{};
+    _edge_ends[edge] = {REMOVED, REMOVED};
+    _removed_edges++;
+  }
+
+  //! \brief Drop cached paths that a new edge out of `from` could
+  //!        shorten. A cached path s->t of L hops can only improve if s
+  //!        reaches `from` in fewer than L-1 hops, so a backward search
+  //!        from `from`, bounded by the longest cached path, finds every
+  //!        affected source
+  void invalidate_for_edge(node_s* from) {
+    // Hops on the longest cached path, from the bounds the caches keep
+    const std::size_t longest = std::max(
+      std::max<std::size_t>(_cache.longest(), 1) - 1, _edge_cache.longest());
+    if (longest < 2) { return; }
+    const std::size_t limit = longest - 2;
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+
+    auto& frontier = scratch.frontier_in;
+    frontier.push_back(from->index);
+    scratch.visit_in(from->index);
+    scratch.depth[from->index] = 0;
+
+    for(std::size_t head = 0; head < frontier.size(); head++) {
+      auto& node = _nodes[frontier[head]];
+      if (scratch.depth[node.index] == limit) { continue; }
+      for(auto* neighbor : node.in) {
+        if (scratch.visited_in(neighbor->index)) { continue; }
+        scratch.visit_in(neighbor->index);
+        scratch.depth[neighbor->index] = scratch.depth[node.index] + 1;
+        frontier.push_back(neighbor->index);
+      }
+    }
+
+    _cache.erase_if([&scratch](const auto& key, const auto& path) {
+      const auto source = edge_index_c::key_from(key);
+      return scratch.visited_in(source) && scratch.depth[source] + 1 < path.size() - 1;
+    });
+    _edge_cache.erase_if([&scratch](const auto& key, const auto& edges) {
+      const auto source = edge_index_c::key_from(key);
+      return scratch.visited_in(source) && scratch.depth[source] + 1 < edges.size();
+    });
+  }
+
+  //! \brief Tarjan's algorithm with an explicit call stack. Each call
+  //!        frame holds a node and the position of the next out edge to
+  //!        explore; a node is on the Tarjan stack while it has been
+  //!        ordered but not yet assigned a component
+  components_s find_components() const {
+    static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+    const std::size_t count = _nodes.size();
+
+    components_s result;
+    result.component.assign(count, NONE);
+    result.offsets.push_back(0);
+    result.nodes.reserve(count);
+
+    scratch_arena_c::scope_c arena;
+    std::pmr::vector<std::uint32_t> order(count, NONE, arena.resource());
+    std::pmr::vector<std::uint32_t> low(count, 0, arena.resource());
+    std::pmr::vector<std::uint32_t> stack(arena.resource());
+    std::pmr::vector<std::pair<std::uint32_t, std::uint32_t>> calls(arena.resource());
+    std::uint32_t counter{0};
+
+    auto enter = [&](const std::uint32_t& node) {
+      order[node] = low[node] = counter++;
+      stack.push_back(node);
+      calls.push_back({node, 0});
+    };
+
+    for(std::uint32_t root = 0; root < count; root++) {
+      if (order[root] != NONE || _nodes[root].removed) { continue; }
+      enter(root);
+
+      while (!calls.empty()) {
+        auto& [node, edge] = calls.back();
+        const auto& out = _nodes[node].out;
+        if (edge < out.size()) {
+          const auto neighbor = out[edge++]->index;
+          if (order[neighbor] == NONE) {
+            enter(neighbor);
+          } else if (result.component[neighbor] == NONE) {
+            low[node] = std::min(low[node], order[neighbor]);
+          }
+          continue;
+        }
+
+        const auto done = node;
+        calls.pop_back();
+        if (!calls.empty()) {
+          auto& caller = calls.back().first;
+          low[caller] = std::min(low[caller], low[done]);
+        }
+        if (low[done] != order[done]) { continue; }
+
+        const auto id = static_cast<std::uint32_t>(result.size());
+        std::uint32_t member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          result.component[member] = id;
+          result.nodes.push_back(const_cast<node_s*>(&_nodes[member]));
+        } while (member != done);
+        result.offsets.push_back(result.nodes.size());
+        result.cyclic.push_back(
+          result.members(id).size() > 1 ||
+          _edge_index.find(edge_index_c::make_key(done, done)) != nullptr);
+      }
+    }
+    return result;
+  }
+
+  //! \brief Collapse each component to one node and label the result.
+  //!        Edges between the same two components are kept once
+  reach_index_c build_reach_index() {
+    using index_t = reach_index_c::index_t;
+    const auto& components = strongly_connected_components();
+    const auto count = components.size();
+
+    std::vector<index_t> offsets;
+    std::vector<index_t> targets;
+    offsets.reserve(count + 1);
+    offsets.push_back(0);
+
+    scratch_arena_c::scope_c arena;
+    std::pmr::vector<index_t> seen(count, std::numeric_limits<index_t>::max(), arena.resource());
+    for(std::size_t c = 0; c < count; c++) {
+      const auto self = static_cast<index_t>(c);
+      for(auto* member : components.members(c)) {
+        for(auto* next : static_cast<node_s*>(member)->out) {
+          const auto target = components.component[next->index];
+          if (target == self || seen[target] == self) { continue; }
+          seen[target] = self;
+          targets.push_back(target);
+        }
+      }
+      offsets.push_back(static_cast<index_t>(targets.size()));
+    }
+    return reach_index_c(components.component, std::move(offsets), std::move(targets));
+  }
+
+  //! \brief Identifier lookup for the node index policy
+  inline auto key_of() const {
+    return [this](const std::uint32_t& idx) -> const NODE_ID_TYPE& {
+      return _nodes[idx].id;
+    };
+  }
+
+  inline node_s* load_node(const NODE_ID_TYPE& x) {
+    const auto* idx = _node_index.find(x, key_of());
+    if (!idx) { return nullptr; }
+    return &_nodes[*idx];
+  } 
+
+  inline EDGE_DATA* get_edge(const node_if* from, const node_if* to) {
+    if (!from || !to) { return nullptr; }
+    const auto key = edge_index_c::make_key(
+      static_cast<const node_s*>(from)->index,
+      static_cast<const node_s*>(to)->index);
+    const auto* slot = _edge_index.find(key);
+    if (!slot) { return nullptr; }
+    return &_edge_storage[*slot];
+  }
+
+  struct batch_job_s {
+    std::uint32_t from;
+    std::uint32_t to;
+    std::size_t query;
+  };
+
+  batch_result_s trace_batch(std::span<const query_t> queries, thread_pool_c* pool) {
+    // Workers only read the arena's arrays, they never allocate from it
+    scratch_arena_c::scope_c arena;
+    std::pmr::vector<batch_job_s> jobs(arena.resource());
+    jobs.reserve(queries.size());
+    for(std::size_t i = 0; i < queries.size(); i++) {
+      auto* from_node = load_node(queries[i].first);
+      auto* to_node = load_node(queries[i].second);
+      if (from_node && to_node) {
+        jobs.push_back({from_node->index, to_node->index, i});
+      }
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const batch_job_s& a, const batch_job_s& b) {
+      return (a.from == b.from) ? a.query < b.query : a.from < b.from;
+    });
+
+    // Group g is jobs[groups[g], groups[g+1])
+    std::pmr::vector<std::size_t> groups(arena.resource());
+    for(std::size_t i = 0; i < jobs.size(); i++) {
+      if (i == 0 || jobs[i].from != jobs[i - 1].from) {
+        groups.push_back(i);
+      }
+    }
+    groups.push_back(jobs.size());
+    const std::size_t group_count = groups.size() - 1;
+
+    std::pmr::vector<std::size_t> lengths(queries.size(), 0, arena.resource());
+    std::vector<node_list_t> group_paths(group_count);
+
+    auto for_each_group = [&](auto&& fn) {
+      if (pool) {
+        pool->parallel_for(group_count, fn);
+        return;
+      }
+      for(std::size_t g = 0; g < group_count; g++) {
+        fn(g);
+      }
+    };
+
+    for_each_group([&](const std::size_t& g) {
+      trace_group(
+        std::span<const batch_job_s>(jobs.data() + groups[g], jobs.data() + groups[g + 1]),
+        lengths, group_paths[g]);
+    });
+
+    batch_result_s result;
+    result.offsets.resize(queries.size() + 1, 0);
+    for(std::size_t i = 0; i < queries.size(); i++) {
+      result.offsets[i + 1] = result.offsets[i] + lengths[i];
+    }
+    result.nodes.resize(result.offsets.back());
+
+    for_each_group([&](const std::size_t& g) {
+      auto source = group_paths[g].begin();
+      for(auto i = groups[g]; i < groups[g + 1]; i++) {
+        const auto query = jobs[i].query;
+        std::copy(source, source + lengths[query], result.nodes.begin() + result.offsets[query]);
+        source += lengths[query];
+      }
+    });
+    return result;
+  }
+
+  //! \brief One breadth-first search for a group of jobs sharing a source.
+  //!        Paths are appended to `paths` in job order
+  void trace_group(
+    std::span<const batch_job_s> jobs,
+    std::pmr::vector<std::size_t>& lengths,
+    node_list_t& paths) {
+
+    const auto source = jobs.front().from;
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+
+    // Targets are tagged with the backward mark so the search can tell
+    // when it reaches one
+    std::size_t remaining{0};
+    for(auto& job : jobs) {
+      if (job.to != source && !scratch.visited_in(job.to)) {
+        scratch.visit_in(job.to);
+        remaining++;
+      }
+    }
+
+    if (remaining) {
+      breadth_first_from(source, scratch,
+        [&](const std::uint32_t& node, const std::uint32_t& parent) {
+          scratch.parent[node] = parent;
+          return !scratch.visited_in(node) || --remaining > 0;
+        });
+    }
+
+    for(auto& job : jobs) {
+      if (job.to != source && !scratch.visited(job.to)) { continue; }
+
+      const std::size_t start = paths.size();
+      for(auto x = job.to; x != source; x = scratch.parent[x]) {
+        paths.push_back(&_nodes[x]);
+      }
+      paths.push_back(&_nodes[source]);
+      std::reverse(paths.begin() + start, paths.end());
+      lengths[job.query] = paths.size() - start;
+    }
+  }
+
+  //! \brief Find the fewest-hop path between two nodes using the
+  //!        selected strategy. On success path holds the route,
+  //!        including both endpoints
+  inline bool find(node_s* from, node_s* to, node_list_t& path) {
+    auto& route = route_buffer();
+    if (!find(from, to, route)) { return false; }
+
+    path.reserve(path.size() + route.size());
+    path.push_back(&_nodes[route.source]);
+    for(auto edge : route.edges) {
+      path.push_back(&_nodes[_edge_ends[edge].to]);
+    }
+    return true;
+  }
+
+  //! \brief Find the fewest-hop path as edge indices. The path is
+  //!        overwritten
+  inline bool find(node_s* from, node_s* to, indexed_path_s& path) {
+    path.source = from->index;
+    path.edges.clear();
+    if (from == to) { return true; }
+    if (_reach && _reach->excludes(from->index, to->index)) { return false; }
+
+    switch(_search_strategy) {
+      case search_strategy_e::BIDIRECTIONAL:
+        return find_bidirectional(from, to, path);
+      case search_strategy_e::BREADTH_FIRST:
+      default:
+        return find_breadth_first(from, to, path);
+    }
+  }
+
+  inline double edge_cost(const EDGE_DATA& edge) const {
+    return (_edge_cost) ? _edge_cost(edge) : 1.0;
+  }
+
+  //! \brief Cheapest path search over the node adjacency. The route is
+  //!        overwritten
+  template<class COST, class COST_FN, class HEURISTIC>
+  inline std::optional<COST> find_weighted(
+    node_s* from,
+    node_s* to,
+    COST_FN&& cost_fn,
+    HEURISTIC&& heuristic,
+    indexed_path_s& route) {
+
+    route.source = from->index;
+    route.edges.clear();
+    if (_reach && _reach->excludes(from->index, to->index)) { return std::nullopt; }
+
+    auto cost = weighted_search<COST>(from->index, to->index, _nodes.size(),
+      [&](const std::uint32_t& idx, auto&& relax) {
+        auto& node = _nodes[idx];
+        for(std::size_t i = 0; i < node.out.size(); i++) {
+          const auto edge = node.out_edges[i];
+          relax(node.out[i]->index, edge, static_cast<COST>(cost_fn(_edge_storage[edge])));
+        }
+      },
+      heuristic);
+    if (!cost) { return std::nullopt; }
+
+    auto& scratch = search_scratch_c::local();
+    for(auto x = to->index; x != from->index; x = scratch.parent[x]) {
+      route.edges.push_back(scratch.via[x]);
+    }
+    std::reverse(route.edges.begin(), route.edges.end());
+    return cost;
+  }
+
+  //! \brief Fill nodes and edge data for a path given as edge indices
+  inline void expand(
+    const std::uint32_t& source,
+    std::span<const std::uint32_t> edges,
+    traced_path_s& path) {
+
+    path.nodes.resize(edges.size() + 1);
+    path.edges.resize(edges.size());
+    path.nodes[0] = &_nodes[source];
+    for(std::size_t i = 0; i < edges.size(); i++) {
+      path.nodes[i + 1] = &_nodes[_edge_ends[edges[i]].to];
+      path.edges[i] = &_edge_storage[edges[i]];
+    }
+  }
+
+  //! \brief Per-thread route buffer for searches whose result is
+  //!        returned as nodes
+  static indexed_path_s& route_buffer() {
+    thread_local indexed_path_s route;
+    return route;
+  }
+
+  //! \brief Breadth-first search from one node to another.
+  //!        Ties are broken by edge insertion order
+  inline bool find_breadth_first(node_s* from, node_s* to, indexed_path_s& path) {
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+
+    bool found{false};
+    breadth_first_from(from->index, scratch,
+      [&](const std::uint32_t& node, const std::uint32_t& parent) {
+        scratch.parent[node] = parent;
+        found = (node == to->index);
+        return !found;
+      });
+
+    if (!found) {
+      return false;
+    }
+
+    GRAPH_DBG("\n-FOUND-\n")
+    for(auto x = to->index; x != from->index; x = scratch.parent[x]) {
+      path.edges.push_back(scratch.via[x]);
+    }
+    std::reverse(path.edges.begin(), path.edges.end());
+    return true;
+  }
+
+  //! \brief Breadth-first search that may not enter `blocked_nodes` or
+  //!        leave `from` by any of `blocked_edges`. The edges of the path
+  //!        found overwrite `edges`
+  inline bool find_avoiding(
+    const std::uint32_t& from,
+    const std::uint32_t& to,
+    std::span<const std::uint32_t> blocked_nodes,
+    std::span<const std::uint32_t> blocked_edges,
+    std::vector<std::uint32_t>& edges) {
+
+    edges.clear();
+    if (from == to) { return true; }
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+    for(auto node : blocked_nodes) {
+      scratch.visit(node);
+    }
+
+    auto& frontier = scratch.frontier;
+    frontier.push_back(from);
+    scratch.visit(from);
+    for(std::size_t head = 0; head < frontier.size(); head++) {
+      auto& node = _nodes[frontier[head]];
+      for(std::size_t i = 0; i < node.out.size(); i++) {
+        const auto n = node.out[i]->index;
+        if (scratch.visited(n)) { continue; }
+        if (node.index == from && std::find(blocked_edges.begin(), blocked_edges.end(), node.out_edges[i]) != blocked_edges.end()) {
+          continue;
+        }
+
+        scratch.visit(n);
+        scratch.via[n] = node.out_edges[i];
+        scratch.parent[n] = node.index;
+        if (n == to) {
+          for(auto x = to; x != from; x = scratch.parent[x]) {
+            edges.push_back(scratch.via[x]);
+          }
+          std::reverse(edges.begin(), edges.end());
+          return true;
+        }
+        frontier.push_back(n);
+      }
+    }
+    return false;
+  }
+
+  //! \brief Breadth-first traversal over out edges, using the frontier
+  //!        and forward marks of a scratch that has already been begun.
+  //!        visit(node, parent) is called once for each newly reached
+  //!        node, in breadth-first order, after the edge it was reached
+  //!        by is stored in scratch.via; returning false ends the search
+  template<class VISIT>
+  inline void breadth_first_from(
+    const std::uint32_t& source,
+    search_scratch_c& scratch,
+    VISIT&& visit) {
+
+    // Every visited node is pushed, so the frontier is a plain queue
+    auto& frontier = scratch.frontier;
+    frontier.push_back(source);
+    scratch.visit(source);
+
+    for(std::size_t head = 0; head < frontier.size(); head++) {
+      auto& node = _nodes[frontier[head]];
+      GRAPH_STAT(scratch.nodes_visited++)
+      for(std::size_t i = 0; i < node.out.size(); i++) {
+        GRAPH_DBG(fmt::format("{} scanning {}\n", node.id, node.out[i]->id))
+        GRAPH_STAT(scratch.edges_scanned++)
+
+        const auto n = node.out[i]->index;
+        if (scratch.visited(n)) { continue; }
+
+        scratch.visit(n);
+        scratch.via[n] = node.out_edges[i];
+        frontier.push_back(n);
+        if (!visit(n, node.index)) { return; }
+      }
+    }
+  }
+
+  //! \brief Breadth-first search run forward from `from` over out edges
+  //!        and backward from `to` over in edges, one whole level at a
+  //!        time, always growing the smaller frontier. Finishing the level
+  //!        in which the frontiers first meet (rather than stopping at the
+  //!        first meeting) keeps the result a fewest-hop path
+  inline bool find_bidirectional(node_s* from, node_s* to, indexed_path_s& path) {
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_nodes.size());
+
+    auto& forward = scratch.frontier;
+    auto& backward = scratch.frontier_in;
+    auto& next_level = scratch.next_level;
+
+    // A node is only ever visited by one side, so one depth array serves both
+    scratch.visit(from->index);
+    scratch.depth[from->index] = 0;
+    forward.push_back(from->index);
+
+    scratch.visit_in(to->index);
+    scratch.depth[to->index] = 0;
+    backward.push_back(to->index);
+
+    std::uint32_t forward_depth{0};
+    std::uint32_t backward_depth{0};
+
+    // The halves of the path are joined by the edge meet_tail->meet_head
+    node_s* meet_tail{nullptr};
+    node_s* meet_head{nullptr};
+    std::uint32_t meet_edge{0};
+    std::size_t best = std::numeric_limits<std::size_t>::max();
+
+    while (!meet_tail && !forward.empty() && !backward.empty()) {
+      next_level.clear();
+
+      if (forward.size() <= backward.size()) {
+        for(auto idx : forward) {
+          auto& node = _nodes[idx];
+          GRAPH_STAT(scratch.nodes_visited++)
+          for(std::size_t i = 0; i < node.out.size(); i++) {
+            auto* neighbor = node.out[i];
+            GRAPH_DBG(fmt::format("{} scanning {}\n", node.id, neighbor->id))
+            GRAPH_STAT(scratch.edges_scanned++)
+
+            const auto n = neighbor->index;
+            if (scratch.visited_in(n)) {
+              const std::size_t hops = forward_depth + 1 + scratch.depth[n];
+              if (hops < best) {
+                best = hops;
+                meet_tail = &node;
+                meet_head = neighbor;
+                meet_edge = node.out_edges[i];
+              }
+              continue;
+            }
+            if (scratch.visited(n)) { continue; }
+
+            scratch.visit(n);
+            scratch.parent[n] = node.index;
+            scratch.via[n] = node.out_edges[i];
+            scratch.depth[n] = forward_depth + 1;
+            next_level.push_back(n);
+          }
+        }
+        forward.swap(next_level);
+        forward_depth++;
+        continue;
+      }
+
+      for(auto idx : backward) {
+        auto& node = _nodes[idx];
+        GRAPH_STAT(scratch.nodes_visited++)
+        for(std::size_t i = 0; i < node.in.size(); i++) {
+          auto* neighbor = node.in[i];
+          GRAPH_DBG(fmt::format("{} scanning {} (in)\n", node.id, neighbor->id))
+          GRAPH_STAT(scratch.edges_scanned++)
+
+          const auto n = neighbor->index;
+          if (scratch.visited(n)) {
+            const std::size_t hops = scratch.depth[n] + 1 + backward_depth;
+            if (hops < best) {
+              best = hops;
+              meet_tail = neighbor;
+              meet_head = &node;
+              meet_edge = node.in_edges[i];
+            }
+            continue;
+          }
+          if (scratch.visited_in(n)) { continue; }
+
+          scratch.visit_in(n);
+          scratch.next[n] = node.index;
+          scratch.via[n] = node.in_edges[i];
+          scratch.depth[n] = backward_depth + 1;
+          next_level.push_back(n);
+        }
+      }
+      backward.swap(next_level);
+      backward_depth++;
+    }
+
+    if (!meet_tail) {
+      return false;
+    }
+
+    GRAPH_DBG("\n-FOUND-\n")
+
+    for(auto x = meet_tail->index; x != from->index; x = scratch.parent[x]) {
+      path.edges.push_back(scratch.via[x]);
+    }
+    std::reverse(path.edges.begin(), path.edges.end());
+    path.edges.push_back(meet_edge);
+    for(auto x = meet_head->index; x != to->index; x = scratch.next[x]) {
+      path.edges.push_back(scratch.via[x]);
+    }
     return true;
   }
 };
@@ -0,0 +1,133 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_GRAPH_STATS_HPP
+#define YOKEL_GRAPH_STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/*
+  Building with GRAPH_ENABLE_STATS counts what every trace does: nodes
+  visited, edges scanned, cache hits and misses, and time taken. Counters
+  are gathered per thread while a query runs and added to the graph's
+  totals once at its end, and a per-query hook may be set to see each one.
+
+  Without it, GRAPH_STAT statements compile to nothing, graph_c carries no
+  counters, stats() reports only what the path cache counts anyway, and a
+  trace hook is never called.
+*/
+#ifdef GRAPH_ENABLE_STATS
+#define GRAPH_STAT(stmt_) \
+  stmt_;
+#else
+#define GRAPH_STAT(stmt_)
+#endif
+
+namespace yokel {
+
+//! \brief Search kinds a trace_stats_s can describe
+enum class trace_kind_e {
+  TRACE,        //! trace and trace_view
+  WITH_EDGES,   //! trace_with_edges
+  INDEXED,      //! trace_indexed
+  WEIGHTED      //! trace_weighted, either form
+};
+
+//! \brief What one query did, as handed to the trace hook
+struct trace_stats_s {
+  trace_kind_e kind{trace_kind_e::TRACE};
+  std::uint32_t from{0};          //! Dense index of the source
+  std::uint32_t to{0};            //! Dense index of the target
+  bool found{false};
+  bool cache_hit{false};
+  std::uint64_t nodes_visited{0}; //! Nodes the search marked
+  std::uint64_t edges_scanned{0}; //! Out (or in) edges the search looked at
+  std::uint64_t nanoseconds{0};
+};
+
+//! \brief Totals over every query since the graph was created (or the
+//!        stats were reset), as returned by graph_c::stats()
+struct graph_stats_s {
+  std::uint64_t traces{0};
+  std::uint64_t found{0};
+  std::uint64_t nodes_visited{0};
+  std::uint64_t edges_scanned{0};
+  std::uint64_t cache_hits{0};
+  std::uint64_t cache_misses{0};
+  std::uint64_t invalidations{0}; //! Cached paths dropped because the graph changed
+  std::uint64_t nanoseconds{0};   //! Time spent in traces, summed over threads
+};
+
+//! \brief Thread-safe running totals. Each query adds to them once
+class graph_counters_c {
+public:
+  graph_counters_c() = default;
+
+  //! \brief Start from the totals of another set of counters
+  graph_counters_c(const graph_counters_c& o)
+    : _traces(o._traces.load(std::memory_order_relaxed)),
+      _found(o._found.load(std::memory_order_relaxed)),
+      _nodes_visited(o._nodes_visited.load(std::memory_order_relaxed)),
+      _edges_scanned(o._edges_scanned.load(std::memory_order_relaxed)),
+      _nanoseconds(o._nanoseconds.load(std::memory_order_relaxed)) {}
+
+  graph_counters_c& operator=(const graph_counters_c&) = delete;
+
+  void add(const trace_stats_s& query) {
+    _traces.fetch_add(1, std::memory_order_relaxed);
+    _found.fetch_add(query.found, std::memory_order_relaxed);
+    _nodes_visited.fetch_add(query.nodes_visited, std::memory_order_relaxed);
+    _edges_scanned.fetch_add(query.edges_scanned, std::memory_order_relaxed);
+    _nanoseconds.fetch_add(query.nanoseconds, std::memory_order_relaxed);
+  }
+
+  //! \brief Copy the totals into a snapshot (cache counters are left alone)
+  void read(graph_stats_s& stats) const {
+    stats.traces = _traces.load(std::memory_order_relaxed);
+    stats.found = _found.load(std::memory_order_relaxed);
+    stats.nodes_visited = _nodes_visited.load(std::memory_order_relaxed);
+    stats.edges_scanned = _edges_scanned.load(std::memory_order_relaxed);
+    stats.nanoseconds = _nanoseconds.load(std::memory_order_relaxed);
+  }
+
+  void reset() {
+    _traces.store(0, std::memory_order_relaxed);
+    _found.store(0, std::memory_order_relaxed);
+    _nodes_visited.store(0, std::memory_order_relaxed);
+    _edges_scanned.store(0, std::memory_order_relaxed);
+    _nanoseconds.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::uint64_t> _traces{0};
+  std::atomic<std::uint64_t> _found{0};
+  std::atomic<std::uint64_t> _nodes_visited{0};
+  std::atomic<std::uint64_t> _edges_scanned{0};
+  std::atomic<std::uint64_t> _nanoseconds{0};
+};
+
+} // namespace
+
+#endif
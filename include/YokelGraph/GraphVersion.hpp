@@ -0,0 +1,424 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_GRAPH_VERSION_HPP
+#define YOKEL_GRAPH_VERSION_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "SearchScratch.hpp"
+#include "WeightedSearch.hpp"
+
+namespace yokel {
+
+//! \brief An immutable version of a graph_c that shares everything a
+//!        change did not touch with the version it was made from.
+//!
+//!        Nodes keep the graph's dense indices, the slots of removed
+//!        nodes included, and are grouped into pages of PAGE_NODES. A
+//!        page holds the identifiers of its nodes and their out edges in
+//!        compressed sparse row form, sorted by target, with the edge
+//!        data. Pages are reached through blocks of BLOCK_PAGES page
+//!        pointers. next() rebuilds only the pages holding nodes the
+//!        graph recorded as changed and copies only the blocks above
+//!        them; every other page and block is shared by pointer.
+//!
+//!        Identifiers are found in two sorted runs: a base, and the
+//!        nodes added since it was built. The second run is copied when
+//!        nodes are added and folded into a new base once it outgrows
+//!        the square root of the base, so adding a node costs amortized
+//!        O(sqrt V) and a version that adds none shares both.
+//!
+//!        Any number of threads may query a version at once.
+//! \param NODE_ID_TYPE Data type nodes are identified by (must be ordered)
+//! \param EDGE_DATA Data type encoded into the edges
+template<class NODE_ID_TYPE, class EDGE_DATA>
+class graph_version_c {
+public:
+  using index_t = std::uint32_t;
+  using path_t = std::vector<index_t>;
+  using edge_list_t = std::vector<const EDGE_DATA*>;
+
+  static constexpr std::size_t PAGE_NODES = 64;
+  static constexpr std::size_t BLOCK_PAGES = 64;
+
+  //! \brief An empty version
+  graph_version_c() = default;
+
+  //! \brief Build the version after `last` from a graph tracking its
+  //!        changes (graph_c::track_changes). Only the pages of the nodes
+  //!        in `changes`, which must cover every change since `last` was
+  //!        built from the same graph, are read from the graph
+  template<class GRAPH>
+  static graph_version_c next(
+    const graph_version_c& last,
+    const GRAPH& graph,
+    const typename GRAPH::changes_s& changes) {
+
+    graph_version_c version;
+    version._slots = graph.index_limit();
+    version._node_count = graph.node_count();
+    version._edge_count = graph.edge_count();
+    const std::size_t pages = (version._slots + PAGE_NODES - 1) / PAGE_NODES;
+    const bool rebuild = changes.renumbered || version._slots < last._slots;
+
+    std::vector<std::size_t> dirty;
+    if (rebuild) {
+      dirty.resize(pages);
+      for(std::size_t p = 0; p < pages; p++) {
+        dirty[p] = p;
+      }
+    } else {
+      dirty.reserve(changes.nodes.size());
+      for(auto node : changes.nodes) {
+        dirty.push_back(node / PAGE_NODES);
+      }
+      // Pages holding new slots are rebuilt even if no node in them was
+      // recorded
+      for(std::size_t p = last._slots / PAGE_NODES; version._slots > last._slots && p < pages; p++) {
+        dirty.push_back(p);
+      }
+      std::sort(dirty.begin(), dirty.end());
+      dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+      version._blocks = last._blocks;
+    }
+
+    // A block over a rebuilt page is copied once, then filled in place
+    version._blocks.resize((pages + BLOCK_PAGES - 1) / BLOCK_PAGES);
+    std::shared_ptr<block_s> block;
+    std::size_t block_at = version._blocks.size();
+    for(auto p : dirty) {
+      if (p / BLOCK_PAGES != block_at) {
+        block_at = p / BLOCK_PAGES;
+        auto& shared = version._blocks[block_at];
+        block = (shared) ? std::make_shared<block_s>(*shared) : std::make_shared<block_s>();
+        shared = block;
+      }
+      block->pages[p % BLOCK_PAGES] = build_page(graph, p, version._slots);
+    }
+
+    if (rebuild) {
+      version.index_ids(nullptr, 0);
+    } else {
+      version._base_ids = last._base_ids;
+      version._added_ids = last._added_ids;
+      if (version._slots > last._slots) {
+        version.index_ids(last._added_ids.get(), last._slots);
+      }
+    }
+    return version;
+  }
+
+  //! \brief Number of nodes in the version
+  std::size_t node_count() const { return _node_count; }
+
+  //! \brief Number of edges in the version
+  std::size_t edge_count() const { return _edge_count; }
+
+  //! \brief One past the highest index, counting removed slots
+  std::size_t index_limit() const { return _slots; }
+
+  //! \brief Find the index of a node, which is its dense index in the
+  //!        graph the version was built from
+  std::optional<index_t> index_of(const NODE_ID_TYPE& id) const {
+    for(auto* run : {_added_ids.get(), _base_ids.get()}) {
+      if (!run) { continue; }
+      auto it = std::lower_bound(run->begin(), run->end(), id, [](const auto& entry, const NODE_ID_TYPE& id) {
+        return entry.first < id;
+      });
+      // A removed node's id may be listed again for the node that reused it
+      for(; it != run->end() && !(id < it->first); it++) {
+        if (contains_index(it->second)) { return {it->second}; }
+      }
+    }
+    return std::nullopt;
+  }
+
+  //! \brief Check if an index names a node of this version
+  bool contains_index(const index_t& node) const {
+    return node < _slots && ((page_of(node).live >> (node % PAGE_NODES)) & 1) != 0;
+  }
+
+  //! \brief Retrieve the identifier of a node by index
+  const NODE_ID_TYPE& id_of(const index_t& node) const {
+    const auto& page = page_of(node);
+    const auto below = page.live & ((std::uint64_t{1} << (node % PAGE_NODES)) - 1);
+    return page.ids[static_cast<std::size_t>(std::popcount(below))];
+  }
+
+  //! \brief Retrieve the out neighbors of a node by index, sorted
+  std::span<const index_t> out(const index_t& node) const {
+    const auto& page = page_of(node);
+    const auto slot = node % PAGE_NODES;
+    return {page.targets.data() + page.offsets[slot], page.offsets[slot + 1] - page.offsets[slot]};
+  }
+
+  //! \brief Attempt to find a path between two nodes. On success the
+  //!        path is overwritten with the node indices of the fewest-hop
+  //!        route, including both endpoints
+  bool trace(const NODE_ID_TYPE& from, const NODE_ID_TYPE& to, path_t& path) const {
+    const auto to_idx = index_of(to);
+    if (!to_idx) { return false; }
+
+    const auto from_idx = index_of(from);
+    if (!from_idx) { return false; }
+
+    return trace_index(*from_idx, *to_idx, path);
+  }
+
+  //! \brief trace between nodes given by index
+  bool trace_index(const index_t& from, const index_t& to, path_t& path) const {
+    path.clear();
+
+    if (from == to) {
+      path.push_back(from);
+      return true;
+    }
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(_slots);
+
+    auto& queue = scratch.frontier;
+    scratch.visit(from);
+    queue.push_back(from);
+
+    for(std::size_t head = 0; head < queue.size(); head++) {
+      const index_t node = queue[head];
+      GRAPH_STAT(scratch.nodes_visited++)
+      for(auto neighbor : out(node)) {
+        GRAPH_STAT(scratch.edges_scanned++)
+        if (scratch.visited(neighbor)) { continue; }
+
+        scratch.visit(neighbor);
+        scratch.parent[neighbor] = node;
+
+        if (neighbor == to) {
+          unwind(from, to, scratch, path);
+          return true;
+        }
+        queue.push_back(neighbor);
+      }
+    }
+    return false;
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes, where
+  //!        crossing an edge costs cost_fn(edge_data) (never negative),
+  //!        optionally guided by an A* heuristic(index). On success the
+  //!        path is overwritten with node indices and the cost returned
+  template<class COST_FN, class HEURISTIC>
+  auto trace_weighted(
+    const index_t& from,
+    const index_t& to,
+    COST_FN&& cost_fn,
+    path_t& path,
+    HEURISTIC&& heuristic) const {
+
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    path.clear();
+
+    auto cost = weighted_search<cost_t>(from, to, _slots,
+      [&](const index_t& node, auto&& relax) {
+        const auto& page = page_of(node);
+        const auto slot = node % PAGE_NODES;
+        for(auto idx = page.offsets[slot]; idx < page.offsets[slot + 1]; idx++) {
+          relax(page.targets[idx], idx, static_cast<cost_t>(cost_fn(page.edges[idx])));
+        }
+      },
+      heuristic);
+    if (cost) {
+      unwind(from, to, search_scratch_c::local(), path);
+    }
+    return cost;
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes with
+  //!        Dijkstra's algorithm
+  template<class COST_FN>
+  auto trace_weighted(const index_t& from, const index_t& to, COST_FN&& cost_fn, path_t& path) const {
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    return trace_weighted(from, to, cost_fn, path, [](const index_t&) { return cost_t{}; });
+  }
+
+  //! \brief Given some result path from trace, load data from all
+  //!        edges that were crossed. The edge list is overwritten
+  bool load_edges(const path_t& path, edge_list_t& list) const {
+    list.clear();
+    if (path.empty()) { return false; }
+    if (path.size() == 1) {
+      auto* edge = get_edge(path[0], path[0]);
+      if (!edge) { return false; }
+      list.push_back(edge);
+      return true;
+    }
+    for(std::size_t i = 0; i < path.size() - 1; i++) {
+      auto* edge = get_edge(path[i], path[i + 1]);
+      if (!edge) { return false; }
+      list.push_back(edge);
+    }
+    return true;
+  }
+
+  //! \brief Retrieve the data of the edge from->to, if it exists
+  const EDGE_DATA* get_edge(const index_t& from, const index_t& to) const {
+    if (!contains_index(from)) { return nullptr; }
+    const auto& page = page_of(from);
+    const auto slot = from % PAGE_NODES;
+    const auto begin = page.targets.begin() + page.offsets[slot];
+    const auto end = page.targets.begin() + page.offsets[slot + 1];
+    const auto it = std::lower_bound(begin, end, to);
+    if (it == end || *it != to) { return nullptr; }
+    return &page.edges[static_cast<std::size_t>(it - page.targets.begin())];
+  }
+
+  //! \brief Count the pages this version shares with another
+  std::size_t shared_pages(const graph_version_c& o) const {
+    std::size_t shared{0};
+    for(std::size_t b = 0; b < std::min(_blocks.size(), o._blocks.size()); b++) {
+      if (!_blocks[b] || !o._blocks[b]) { continue; }
+      for(std::size_t p = 0; p < BLOCK_PAGES; p++) {
+        const auto& page = _blocks[b]->pages[p];
+        shared += (page && page == o._blocks[b]->pages[p]);
+      }
+    }
+    return shared;
+  }
+
+private:
+  static_assert(PAGE_NODES <= 64, "Each page keeps a 64 bit mask of its live nodes");
+
+  using ids_t = std::vector<std::pair<NODE_ID_TYPE, index_t>>;
+
+  //! \brief The nodes [n * PAGE_NODES, (n + 1) * PAGE_NODES). ids holds
+  //!        the identifiers of the live slots only, in slot order
+  struct page_s {
+    std::array<index_t, PAGE_NODES + 1> offsets{};
+    std::vector<index_t> targets;
+    std::vector<EDGE_DATA> edges;
+    std::vector<NODE_ID_TYPE> ids;
+    std::uint64_t live{0};
+  };
+
+  struct block_s {
+    std::array<std::shared_ptr<const page_s>, BLOCK_PAGES> pages;
+  };
+
+  // The added run is only folded into the base once longer than this,
+  // so a small graph does not rebuild its base on every publish
+  static constexpr std::size_t MIN_ADDED_IDS = 256;
+
+  std::vector<std::shared_ptr<const block_s>> _blocks;
+  std::shared_ptr<const ids_t> _base_ids;
+  std::shared_ptr<const ids_t> _added_ids;
+  std::size_t _slots{0};
+  std::size_t _node_count{0};
+  std::size_t _edge_count{0};
+
+  const page_s& page_of(const index_t& node) const {
+    return *_blocks[node / (PAGE_NODES * BLOCK_PAGES)]->pages[(node / PAGE_NODES) % BLOCK_PAGES];
+  }
+
+  template<class GRAPH>
+  static std::shared_ptr<const page_s> build_page(const GRAPH& graph, const std::size_t& p, const std::size_t& slots) {
+    auto page = std::make_shared<page_s>();
+    const std::size_t first = p * PAGE_NODES;
+    const std::size_t count = std::min(PAGE_NODES, slots - first);
+
+    std::vector<std::pair<index_t, std::uint32_t>> row;
+    for(std::size_t slot = 0; slot < count; slot++) {
+      const auto node = static_cast<std::uint32_t>(first + slot);
+      page->offsets[slot] = static_cast<index_t>(page->targets.size());
+      if (!graph.contains_index(node)) { continue; }
+      page->live |= std::uint64_t{1} << slot;
+      page->ids.push_back(graph.id_of(node));
+
+      row.clear();
+      graph.for_each_out(node, [&row](const std::uint32_t& target, const std::uint32_t& edge) {
+        row.push_back({target, edge});
+      });
+      std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+      for(auto&& [target, edge] : row) {
+        page->targets.push_back(target);
+        page->edges.push_back(graph.edge_data(edge));
+      }
+    }
+    for(std::size_t slot = count; slot <= PAGE_NODES; slot++) {
+      page->offsets[slot] = static_cast<index_t>(page->targets.size());
+    }
+    return page;
+  }
+
+  //! \brief List the ids of the live nodes at `first` and after, on top
+  //!        of `added`, folding them into a new base when they outgrow it
+  void index_ids(const ids_t* added, const std::size_t& first) {
+    ids_t ids = (added) ? *added : ids_t{};
+    for(auto node = static_cast<index_t>(first); node < _slots; node++) {
+      if (contains_index(node)) { ids.push_back({id_of(node), node}); }
+    }
+    const std::size_t base = (_base_ids) ? _base_ids->size() : 0;
+    if (first == 0 || (ids.size() > MIN_ADDED_IDS && ids.size() * ids.size() > base)) {
+      // Dropping the ids of removed nodes along the way
+      if (_base_ids) {
+        for(auto& entry : *_base_ids) {
+          if (contains_index(entry.second)) { ids.push_back(entry); }
+        }
+      }
+      ids.erase(std::remove_if(ids.begin(), ids.end(), [this](const auto& entry) {
+        return !contains_index(entry.second);
+      }), ids.end());
+      std::sort(ids.begin(), ids.end());
+      _base_ids = std::make_shared<const ids_t>(std::move(ids));
+      _added_ids.reset();
+      return;
+    }
+    std::sort(ids.begin(), ids.end());
+    _added_ids = std::make_shared<const ids_t>(std::move(ids));
+  }
+
+  static void unwind(
+    const index_t& from,
+    const index_t& to,
+    const search_scratch_c& scratch,
+    path_t& path) {
+
+    for(index_t x = to; x != from; x = scratch.parent[x]) {
+      path.push_back(x);
+    }
+    path.push_back(from);
+    std::reverse(path.begin(), path.end());
+  }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,66 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_HASH_HPP
+#define YOKEL_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace yokel {
+
+//! \brief 64 bit FNV-1a, fed in pieces
+class fnv1a_c {
+public:
+  void update(const void* data, const std::size_t& size) {
+    auto* bytes = static_cast<const unsigned char*>(data);
+    for(std::size_t i = 0; i < size; i++) {
+      _hash ^= bytes[i];
+      _hash *= PRIME;
+    }
+  }
+
+  std::uint64_t value() const { return _hash; }
+
+private:
+  static constexpr std::uint64_t BASIS = 0xcbf29ce484222325ULL;
+  static constexpr std::uint64_t PRIME = 0x100000001b3ULL;
+  std::uint64_t _hash{BASIS};
+};
+
+//! \brief Finalizer of splitmix64: spreads every input bit over the
+//!        whole result, so sums of mixed values make order-independent
+//!        hashes of sets
+inline std::uint64_t mix64(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+} // namespace
+
+#endif
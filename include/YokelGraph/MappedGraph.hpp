@@ -0,0 +1,503 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_MAPPED_GRAPH_HPP
+#define YOKEL_MAPPED_GRAPH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CsrView.hpp"
+#include "FrozenGraph.hpp"
+#include "Hash.hpp"
+
+/*
+  Graph file layout (version 1). Every integer is in host byte order; the
+  endian mark lets a reader on another host refuse the file. Each section
+  starts on a 64 byte boundary and the header records where.
+
+    header             graph_file_header_s
+    offsets            uint32 x (node_count + 1)
+    targets            uint32 x edge_count
+    edges              EDGE_DATA x edge_count (trivially copyable)
+    ids                fixed size ids:  NODE_ID_TYPE x node_count
+                       std::string ids: uint64 x (node_count + 1) offsets
+    id characters      std::string ids only: the characters of every id
+
+  Ids are stored in sorted order; position is the node index, as in
+  frozen_graph_c. The checksum is 64 bit FNV-1a over every byte after the
+  header and is only checked on request (verify). Opening reads every
+  section but edge data, enough to know that no search or lookup can index
+  past the file and that the orderings lookups rely on hold: targets
+  sorted within each node, ids sorted and unique.
+*/
+
+namespace yokel {
+
+struct graph_file_header_s {
+  static constexpr char MAGIC[8] = {'Y', 'O', 'K', 'E', 'L', 'G', 'R', 'F'};
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::uint32_t ENDIAN_MARK = 0x01020304;
+  static constexpr std::uint64_t ALIGNMENT = 64;
+
+  enum id_kind_e : std::uint32_t {
+    FIXED_SIZE = 0,
+    STRING = 1
+  };
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t endian;
+  std::uint32_t index_size;
+  std::uint32_t id_kind;
+  std::uint64_t id_size;
+  std::uint64_t edge_size;
+  std::uint64_t edge_align;
+  std::uint64_t node_count;
+  std::uint64_t edge_count;
+  std::uint64_t offsets_at;
+  std::uint64_t targets_at;
+  std::uint64_t edges_at;
+  std::uint64_t ids_at;
+  std::uint64_t id_chars_at;
+  std::uint64_t id_chars_size;
+  std::uint64_t file_size;
+  std::uint64_t checksum;
+};
+
+namespace detail {
+
+template<class NODE_ID_TYPE>
+constexpr bool is_string_id_v = std::is_same_v<NODE_ID_TYPE, std::string>;
+
+template<class NODE_ID_TYPE, class EDGE_DATA>
+constexpr void check_file_types() {
+  static_assert(is_string_id_v<NODE_ID_TYPE> || std::is_trivially_copyable_v<NODE_ID_TYPE>,
+    "Graph files store std::string or trivially copyable node ids");
+  static_assert(std::is_trivially_copyable_v<EDGE_DATA>,
+    "Graph files store trivially copyable edge data");
+  static_assert(alignof(EDGE_DATA) <= graph_file_header_s::ALIGNMENT &&
+                alignof(NODE_ID_TYPE) <= graph_file_header_s::ALIGNMENT,
+    "Graph file sections are 64 byte aligned");
+}
+
+inline std::uint64_t align_up(const std::uint64_t& at) {
+  constexpr auto A = graph_file_header_s::ALIGNMENT;
+  return (at + A - 1) / A * A;
+}
+
+} // namespace detail
+
+//! \brief Write a frozen graph to a file that mapped_graph_c can open
+//! \returns false if the file could not be written
+template<class NODE_ID_TYPE, class EDGE_DATA>
+bool write_graph_file(const frozen_graph_c<NODE_ID_TYPE, EDGE_DATA>& graph, const std::string& path) {
+  detail::check_file_types<NODE_ID_TYPE, EDGE_DATA>();
+  using header_t = graph_file_header_s;
+  using index_t = typename frozen_graph_c<NODE_ID_TYPE, EDGE_DATA>::index_t;
+  constexpr bool STRING_IDS = detail::is_string_id_v<NODE_ID_TYPE>;
+
+  auto view = graph.view();
+  const auto ids = graph.ids();
+
+  // A default constructed snapshot has no offsets at all
+  static constexpr index_t NO_EDGES[1] = {0};
+  if (view.offsets.empty()) {
+    view.offsets = NO_EDGES;
+  }
+
+  std::vector<std::uint64_t> id_offsets;
+  if constexpr (STRING_IDS) {
+    id_offsets.reserve(ids.size() + 1);
+    id_offsets.push_back(0);
+    for(auto& id : ids) {
+      id_offsets.push_back(id_offsets.back() + id.size());
+    }
+  }
+
+  header_t header{};
+  std::memcpy(header.magic, header_t::MAGIC, sizeof(header.magic));
+  header.version = header_t::VERSION;
+  header.endian = header_t::ENDIAN_MARK;
+  header.index_size = sizeof(index_t);
+  header.id_kind = (STRING_IDS) ? header_t::STRING : header_t::FIXED_SIZE;
+  header.id_size = (STRING_IDS) ? 0 : sizeof(NODE_ID_TYPE);
+  header.edge_size = sizeof(EDGE_DATA);
+  header.edge_align = alignof(EDGE_DATA);
+  header.node_count = ids.size();
+  header.edge_count = view.targets.size();
+
+  header.offsets_at = detail::align_up(sizeof(header_t));
+  header.targets_at = detail::align_up(header.offsets_at + view.offsets.size_bytes());
+  header.edges_at = detail::align_up(header.targets_at + view.targets.size_bytes());
+  header.ids_at = detail::align_up(header.edges_at + view.edges.size_bytes());
+  if constexpr (STRING_IDS) {
+    header.id_chars_at = detail::align_up(header.ids_at + id_offsets.size() * sizeof(std::uint64_t));
+    header.id_chars_size = id_offsets.back();
+    header.file_size = header.id_chars_at + header.id_chars_size;
+  } else {
+    header.file_size = header.ids_at + ids.size_bytes();
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) { return false; }
+
+  // The header is written again at the end, once the checksum is known
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  fnv1a_c checksum;
+  std::uint64_t at = sizeof(header_t);
+  const char zeros[header_t::ALIGNMENT] = {};
+
+  auto emit = [&](const std::uint64_t& section_at, const void* data, const std::size_t& size) {
+    checksum.update(zeros, section_at - at);
+    file.write(zeros, static_cast<std::streamsize>(section_at - at));
+    checksum.update(data, size);
+    file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    at = section_at + size;
+  };
+
+  emit(header.offsets_at, view.offsets.data(), view.offsets.size_bytes());
+  emit(header.targets_at, view.targets.data(), view.targets.size_bytes());
+  emit(header.edges_at, view.edges.data(), view.edges.size_bytes());
+  if constexpr (STRING_IDS) {
+    emit(header.ids_at, id_offsets.data(), id_offsets.size() * sizeof(std::uint64_t));
+    emit(header.id_chars_at, nullptr, 0);
+    for(auto& id : ids) {
+      checksum.update(id.data(), id.size());
+      file.write(id.data(), static_cast<std::streamsize>(id.size()));
+    }
+  } else {
+    emit(header.ids_at, ids.data(), ids.size_bytes());
+  }
+
+  header.checksum = checksum.value();
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  return static_cast<bool>(file.flush());
+}
+
+//! \brief Write any graph that can be frozen (graph_c) to a graph file
+template<class GRAPH>
+bool write_graph_file(const GRAPH& graph, const std::string& path) {
+  return write_graph_file(graph.freeze(), path);
+}
+
+//! \brief Read-only graph searched straight out of a memory mapped graph
+//!        file. Opening checks the header, the section bounds, that every
+//!        offset and target stays in bounds, that targets are sorted within
+//!        each node and that ids are sorted and unique, reading each section
+//!        but edge data once; edge data is read in as queries touch it.
+//!        Any number of threads may search at once.
+//!        Offers the queries of frozen_graph_c, by identifier and by index.
+//! \param NODE_ID_TYPE std::string or a trivially copyable type
+//! \param EDGE_DATA Trivially copyable data type encoded into the edges
+template<class NODE_ID_TYPE, class EDGE_DATA>
+class mapped_graph_c {
+public:
+  using view_t = csr_view_s<EDGE_DATA>;
+  using index_t = typename view_t::index_t;
+  using path_t = typename view_t::path_t;
+  using edge_list_t = typename view_t::edge_list_t;
+  using id_ref_t = std::conditional_t<detail::is_string_id_v<NODE_ID_TYPE>,
+    std::string_view, const NODE_ID_TYPE&>;
+
+  //! \brief Map a graph file
+  //! \returns nullopt if the file is missing, was written for other types
+  //!          or another host, is truncated, holds offsets or targets
+  //!          that would index past their sections, or holds targets or
+  //!          ids out of order
+  static std::optional<mapped_graph_c> open(const std::string& path) {
+    detail::check_file_types<NODE_ID_TYPE, EDGE_DATA>();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return std::nullopt; }
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(graph_file_header_s)) {
+      ::close(fd);
+      return std::nullopt;
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) { return std::nullopt; }
+
+    mapped_graph_c graph(static_cast<const std::byte*>(data), size);
+    if (!graph.bind()) { return std::nullopt; }
+    return {std::move(graph)};
+  }
+
+  mapped_graph_c(const mapped_graph_c&) = delete;
+  mapped_graph_c& operator=(const mapped_graph_c&) = delete;
+
+  mapped_graph_c(mapped_graph_c&& o) noexcept
+    : _data(std::exchange(o._data, nullptr)),
+      _size(std::exchange(o._size, 0)),
+      _view(o._view),
+      _ids(o._ids),
+      _id_offsets(o._id_offsets),
+      _id_chars(o._id_chars) {}
+
+  mapped_graph_c& operator=(mapped_graph_c&& o) noexcept {
+    std::swap(_data, o._data);
+    std::swap(_size, o._size);
+    std::swap(_view, o._view);
+    std::swap(_ids, o._ids);
+    std::swap(_id_offsets, o._id_offsets);
+    std::swap(_id_chars, o._id_chars);
+    return *this;
+  }
+
+  ~mapped_graph_c() {
+    if (_data) {
+      ::munmap(const_cast<std::byte*>(_data), _size);
+    }
+  }
+
+  //! \brief Check every byte after the header against the checksum.
+  //!        Reads the whole file
+  bool verify() const {
+    fnv1a_c checksum;
+    checksum.update(_data + sizeof(graph_file_header_s), _size - sizeof(graph_file_header_s));
+    return checksum.value() == header().checksum;
+  }
+
+  //! \brief Number of nodes in the file
+  std::size_t node_count() const { return _view.node_count(); }
+
+  //! \brief Number of edges in the file
+  std::size_t edge_count() const { return _view.edge_count(); }
+
+  //! \brief Find the dense index of a node
+  std::optional<index_t> index_of(const id_ref_t id) const {
+    std::size_t low{0};
+    std::size_t high = node_count();
+    while (low < high) {
+      const std::size_t mid = low + (high - low) / 2;
+      if (id_of(static_cast<index_t>(mid)) < id) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == node_count() || !(id_of(static_cast<index_t>(low)) == id)) { return std::nullopt; }
+    return {static_cast<index_t>(low)};
+  }
+
+  //! \brief Retrieve the identifier of a node by index. String ids are
+  //!        views into the mapping
+  id_ref_t id_of(const index_t& node) const {
+    if constexpr (detail::is_string_id_v<NODE_ID_TYPE>) {
+      const auto begin = _id_offsets[node];
+      return {_id_chars.data() + begin, _id_offsets[node + 1] - begin};
+    } else {
+      return _ids[node];
+    }
+  }
+
+  //! \brief Retrieve the out neighbors of a node by index
+  std::span<const index_t> out(const index_t& node) const {
+    return _view.out(node);
+  }
+
+  //! \brief Attempt to find a fewest-hop path between two nodes
+  bool trace(const id_ref_t from, const id_ref_t to, path_t& path) const {
+    const auto to_idx = index_of(to);
+    if (!to_idx) { return false; }
+
+    const auto from_idx = index_of(from);
+    if (!from_idx) { return false; }
+
+    return trace_index(*from_idx, *to_idx, path);
+  }
+
+  //! \brief Attempt to find a fewest-hop path between two nodes by index
+  bool trace_index(const index_t& from, const index_t& to, path_t& path) const {
+    return _view.trace(from, to, path);
+  }
+
+  //! \brief Attempt to find a fewest-hop path between two nodes by index
+  //!        with a bitmap visited set. Files hold no in edges, so every
+  //!        level is expanded top-down
+  bool trace_wide(const index_t& from, const index_t& to, path_t& path) const {
+    return _view.trace_wide(from, to, path);
+  }
+
+  //! \brief Mark every node reachable from a node in `reached`
+  //! \returns the number of nodes reached, the node itself included
+  std::size_t reach(const index_t& from, visit_bitmap_c& reached) const {
+    return _view.reach(from, reached);
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes, with an
+  //!        A* heuristic(index)
+  template<class COST_FN, class HEURISTIC>
+  auto trace_weighted(
+    const index_t& from,
+    const index_t& to,
+    COST_FN&& cost_fn,
+    path_t& path,
+    HEURISTIC&& heuristic) const {
+    return _view.trace_weighted(from, to, cost_fn, path, heuristic);
+  }
+
+  //! \brief Attempt to find the cheapest path between two nodes
+  template<class COST_FN>
+  auto trace_weighted(const index_t& from, const index_t& to, COST_FN&& cost_fn, path_t& path) const {
+    using cost_t = std::decay_t<std::invoke_result_t<COST_FN&, const EDGE_DATA&>>;
+    return trace_weighted(from, to, cost_fn, path, [](const index_t&) { return cost_t{}; });
+  }
+
+  //! \brief Load data from all edges crossed by a path
+  bool load_edges(const path_t& path, edge_list_t& edges) const {
+    return _view.load_edges(path, edges);
+  }
+
+  //! \brief Retrieve the data of the edge from->to, if it exists
+  const EDGE_DATA* get_edge(const index_t& from, const index_t& to) const {
+    return _view.get_edge(from, to);
+  }
+
+  //! \brief The arrays of the file, for searching
+  const view_t& view() const { return _view; }
+
+private:
+  mapped_graph_c(const std::byte* data, const std::size_t& size)
+    : _data(data), _size(size) {}
+
+  const graph_file_header_s& header() const {
+    return *reinterpret_cast<const graph_file_header_s*>(_data);
+  }
+
+  template<class T>
+  const T* at(const std::uint64_t& offset) const {
+    return reinterpret_cast<const T*>(_data + offset);
+  }
+
+  //! \brief Validate the header against this build and point the views
+  //!        into the mapping
+  bool bind() {
+    using header_t = graph_file_header_s;
+    constexpr bool STRING_IDS = detail::is_string_id_v<NODE_ID_TYPE>;
+    const auto& h = header();
+
+    if (std::memcmp(h.magic, header_t::MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != header_t::VERSION ||
+        h.endian != header_t::ENDIAN_MARK ||
+        h.index_size != sizeof(index_t) ||
+        h.id_kind != ((STRING_IDS) ? header_t::STRING : header_t::FIXED_SIZE) ||
+        h.id_size != ((STRING_IDS) ? 0 : sizeof(NODE_ID_TYPE)) ||
+        h.edge_size != sizeof(EDGE_DATA) ||
+        h.edge_align != alignof(EDGE_DATA) ||
+        h.file_size != _size) {
+      return false;
+    }
+
+    // Counts are bounded first, so no size below can wrap
+    auto fits = [&](const std::uint64_t& offset, const std::uint64_t& count, const std::uint64_t& width) {
+      return offset % header_t::ALIGNMENT == 0 && offset <= _size && count <= (_size - offset) / width;
+    };
+    constexpr std::uint64_t MAX_COUNT = std::numeric_limits<index_t>::max();
+    if (h.node_count >= MAX_COUNT || h.edge_count > MAX_COUNT ||
+        !fits(h.offsets_at, h.node_count + 1, sizeof(index_t)) ||
+        !fits(h.targets_at, h.edge_count, sizeof(index_t)) ||
+        !fits(h.edges_at, h.edge_count, sizeof(EDGE_DATA)) ||
+        !fits(h.ids_at, (STRING_IDS) ? h.node_count + 1 : h.node_count,
+              (STRING_IDS) ? sizeof(std::uint64_t) : sizeof(NODE_ID_TYPE)) ||
+        (STRING_IDS && !fits(h.id_chars_at, h.id_chars_size, 1))) {
+      return false;
+    }
+
+    _view.offsets = {at<index_t>(h.offsets_at), h.node_count + 1};
+    _view.targets = {at<index_t>(h.targets_at), h.edge_count};
+    _view.edges = {at<EDGE_DATA>(h.edges_at), h.edge_count};
+    if constexpr (STRING_IDS) {
+      _id_offsets = {at<std::uint64_t>(h.ids_at), h.node_count + 1};
+      _id_chars = {at<char>(h.id_chars_at), h.id_chars_size};
+    } else {
+      _ids = {at<NODE_ID_TYPE>(h.ids_at), h.node_count};
+    }
+    return contents_consistent();
+  }
+
+  //! \brief Check everything searches and lookups index with: offsets
+  //!        and id offsets rise from zero to the end of their sections,
+  //!        every target is a node, targets are sorted within each node
+  //!        (edge lookups bisect them) and ids are sorted and unique
+  //!        (index_of bisects them). O(V+E), reading those sections once
+  bool contents_consistent() const {
+    auto rising = [](const auto& offsets, const std::uint64_t& end) {
+      if (offsets.front() != 0 || offsets.back() != end) { return false; }
+      for(std::size_t i = 1; i < offsets.size(); i++) {
+        if (offsets[i] < offsets[i - 1]) { return false; }
+      }
+      return true;
+    };
+    if (!rising(_view.offsets, _view.targets.size())) { return false; }
+    const auto nodes = node_count();
+    for(std::size_t n = 0; n < nodes; n++) {
+      const auto begin = _view.offsets[n];
+      const auto end = _view.offsets[n + 1];
+      for(auto e = begin; e < end; e++) {
+        if (_view.targets[e] >= nodes ||
+            (e > begin && _view.targets[e] < _view.targets[e - 1])) { return false; }
+      }
+    }
+    if constexpr (detail::is_string_id_v<NODE_ID_TYPE>) {
+      if (!rising(_id_offsets, _id_chars.size())) { return false; }
+    }
+    for(std::size_t n = 1; n < nodes; n++) {
+      if (!(id_of(static_cast<index_t>(n - 1)) < id_of(static_cast<index_t>(n)))) { return false; }
+    }
+    return true;
+  }
+
+  const std::byte* _data{nullptr};
+  std::size_t _size{0};
+  view_t _view;
+  std::span<const NODE_ID_TYPE> _ids;
+  std::span<const std::uint64_t> _id_offsets;
+  std::string_view _id_chars;
+};
+
+} // namespace
+
+#endif
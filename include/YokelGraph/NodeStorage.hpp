@@ -0,0 +1,300 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_NODE_STORAGE_HPP
+#define YOKEL_NODE_STORAGE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+/*
+  Storage policies decide how graph_c maps a node identifier to the dense
+  index of the node. The nodes themselves always live in a deque owned by
+  the graph, so their addresses do not depend on the policy.
+
+  A policy is a type with a nested template `index_t<NODE_ID_TYPE>`
+  offering:
+
+    const std::uint32_t* find(const NODE_ID_TYPE& id, const KEY_OF& key_of) const;
+    void insert(const NODE_ID_TYPE& id, std::uint32_t index, const KEY_OF& key_of);
+    void erase(const NODE_ID_TYPE& id, const KEY_OF& key_of);
+    void reserve(std::size_t count);
+    void clear();
+    std::size_t size() const;
+
+  where key_of(index) returns the identifier of the node at that index,
+  which lets an index avoid storing its own copy of every identifier.
+  insert is only called for identifiers that are not yet present, and
+  erase only for identifiers that are (while key_of still resolves them).
+
+  graph_c picks default_storage_t: direct_storage_s for integral
+  identifiers, ordered_storage_s for everything else.
+*/
+
+namespace yokel {
+
+//! \brief Identifier lookup through std::map (O(log n) comparisons)
+template<class NODE_ID_TYPE>
+class ordered_node_index_c {
+public:
+  template<class KEY_OF>
+  const std::uint32_t* find(const NODE_ID_TYPE& id, const KEY_OF&) const {
+    const auto it = _map.find(id);
+    if (it == _map.end()) { return nullptr; }
+    return &it->second;
+  }
+
+  template<class KEY_OF>
+  void insert(const NODE_ID_TYPE& id, const std::uint32_t& index, const KEY_OF&) {
+    _map.emplace(id, index);
+  }
+
+  template<class KEY_OF>
+  void erase(const NODE_ID_TYPE& id, const KEY_OF&) {
+    _map.erase(id);
+  }
+
+  void reserve(const std::size_t&) {}
+  void clear() { _map.clear(); }
+  std::size_t size() const { return _map.size(); }
+
+private:
+  std::map<NODE_ID_TYPE, std::uint32_t> _map;
+};
+
+//! \brief Identifier lookup through a flat open-addressing (linear probing)
+//!        hash table. Slots hold the identifier hash and the node index
+//!        only; identifiers are compared against the graph's own copy
+//!        when hashes match, so growing the table never moves them
+template<class NODE_ID_TYPE, class HASH = std::hash<NODE_ID_TYPE>>
+class flat_node_index_c {
+public:
+  template<class KEY_OF>
+  const std::uint32_t* find(const NODE_ID_TYPE& id, const KEY_OF& key_of) const {
+    if (_slots.empty()) { return nullptr; }
+    const std::uint64_t hash = hash_of(id);
+    const std::size_t mask = _slots.size() - 1;
+    for(std::size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const slot_s& slot = _slots[i];
+      if (slot.hash == EMPTY) { return nullptr; }
+      if (slot.hash == hash && key_of(slot.index) == id) { return &slot.index; }
+    }
+  }
+
+  template<class KEY_OF>
+  void insert(const NODE_ID_TYPE& id, const std::uint32_t& index, const KEY_OF&) {
+    reserve(_size + 1);
+    place({hash_of(id), index}, _slots);
+    _size++;
+  }
+
+  //! \brief Slots later in the same probe run move back into the gap,
+  //!        so the table never needs tombstones
+  template<class KEY_OF>
+  void erase(const NODE_ID_TYPE& id, const KEY_OF& key_of) {
+    if (_slots.empty()) { return; }
+    const std::uint64_t hash = hash_of(id);
+    const std::size_t mask = _slots.size() - 1;
+    std::size_t hole = hash & mask;
+    while (!(_slots[hole].hash == hash && key_of(_slots[hole].index) == id)) {
+      if (_slots[hole].hash == EMPTY) { return; }
+      hole = (hole + 1) & mask;
+    }
+    for(std::size_t i = (hole + 1) & mask; _slots[i].hash != EMPTY; i = (i + 1) & mask) {
+      const std::size_t home = _slots[i].hash & mask;
+      if (((i - home) & mask) < ((i - hole) & mask)) { continue; }
+      _slots[hole] = _slots[i];
+      hole = i;
+    }
+    _slots[hole] = slot_s{};
+    _size--;
+  }
+
+  void reserve(const std::size_t& count) {
+    std::size_t capacity{MIN_CAPACITY};
+    while (capacity * MAX_LOAD_NUM < count * MAX_LOAD_DEN) {
+      capacity <<= 1;
+    }
+    if (capacity <= _slots.size()) { return; }
+
+    std::vector<slot_s> slots(capacity);
+    for(auto& slot : _slots) {
+      if (slot.hash != EMPTY) { place(slot, slots); }
+    }
+    _slots.swap(slots);
+  }
+
+  void clear() {
+    _slots.clear();
+    _size = 0;
+  }
+
+  std::size_t size() const { return _size; }
+
+private:
+  static constexpr std::uint64_t EMPTY = 0;
+  static constexpr std::size_t MIN_CAPACITY = 16;
+  static constexpr std::size_t MAX_LOAD_NUM = 3;
+  static constexpr std::size_t MAX_LOAD_DEN = 4;
+
+  struct slot_s {
+    std::uint64_t hash{EMPTY};
+    std::uint32_t index{0};
+  };
+
+  std::vector<slot_s> _slots;
+  std::size_t _size{0};
+
+  //! \brief Identifier hash, remixed since std::hash of integers is
+  //!        often the identity, and kept non-zero to leave EMPTY free
+  static std::uint64_t hash_of(const NODE_ID_TYPE& id) {
+    std::uint64_t x = static_cast<std::uint64_t>(HASH{}(id));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (x == EMPTY) ? 1 : x;
+  }
+
+  static void place(const slot_s& slot, std::vector<slot_s>& slots) {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = slot.hash & mask;
+    while (slots[i].hash != EMPTY) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+};
+
+//! \brief Identifier lookup for integral identifiers that are mostly small
+//!        and dense: the identifier itself indexes a table of node
+//!        indices. Identifiers too large (or negative) to fit without
+//!        leaving the table mostly empty go to a flat hash table instead
+template<class NODE_ID_TYPE>
+class direct_node_index_c {
+public:
+  static_assert(std::is_integral_v<NODE_ID_TYPE>, "direct_node_index_c requires an integral identifier");
+
+  template<class KEY_OF>
+  const std::uint32_t* find(const NODE_ID_TYPE& id, const KEY_OF& key_of) const {
+    const std::uint64_t at = slot_of(id);
+    if (at < _table.size() && _table[at] != EMPTY) { return &_table[at]; }
+    if (_spilled.size() == 0) { return nullptr; }
+    return _spilled.find(id, key_of);
+  }
+
+  //! \brief The table grows to take an identifier as long as it would
+  //!        stay at least half full for the nodes stored or reserved
+  template<class KEY_OF>
+  void insert(const NODE_ID_TYPE& id, const std::uint32_t& index, const KEY_OF& key_of) {
+    const std::uint64_t at = slot_of(id);
+    if (at >= _table.size() && at < MIN_DIRECT + 2 * std::max(_size + 1, _expected)) {
+      _table.resize(std::max<std::uint64_t>(at + 1, _table.size() * 2), EMPTY);
+    }
+    if (at < _table.size()) {
+      _table[at] = index;
+    } else {
+      _spilled.insert(id, index, key_of);
+    }
+    _size++;
+  }
+
+  //! \brief An identifier may sit in the hash table even when the table
+  //!        has since grown past it, so both are checked
+  template<class KEY_OF>
+  void erase(const NODE_ID_TYPE& id, const KEY_OF& key_of) {
+    const std::uint64_t at = slot_of(id);
+    if (at < _table.size() && _table[at] != EMPTY) {
+      _table[at] = EMPTY;
+      _size--;
+      return;
+    }
+    if (_spilled.find(id, key_of)) {
+      _spilled.erase(id, key_of);
+      _size--;
+    }
+  }
+
+  //! \brief Only raises how far the table may grow; it is allocated as
+  //!        identifiers arrive
+  void reserve(const std::size_t& count) {
+    _expected = std::max(_expected, count);
+  }
+
+  void clear() {
+    _table.clear();
+    _spilled.clear();
+    _size = 0;
+  }
+
+  std::size_t size() const { return _size; }
+
+private:
+  static constexpr std::uint32_t EMPTY = ~std::uint32_t{0};
+  static constexpr std::uint64_t MIN_DIRECT = 1024;
+
+  std::vector<std::uint32_t> _table;
+  flat_node_index_c<NODE_ID_TYPE> _spilled;
+  std::size_t _size{0};
+  std::size_t _expected{0};
+
+  //! \brief Negative identifiers wrap to huge slots and are spilled
+  static std::uint64_t slot_of(const NODE_ID_TYPE& id) {
+    return static_cast<std::uint64_t>(static_cast<std::make_unsigned_t<NODE_ID_TYPE>>(id));
+  }
+};
+
+//! \brief Nodes are found through std::map. The default for identifiers
+//!        that are not integral (see default_storage_t)
+struct ordered_storage_s {
+  template<class NODE_ID_TYPE>
+  using index_t = ordered_node_index_c<NODE_ID_TYPE>;
+};
+
+//! \brief Nodes are found through a flat hash table (requires std::hash)
+struct flat_storage_s {
+  template<class NODE_ID_TYPE>
+  using index_t = flat_node_index_c<NODE_ID_TYPE>;
+};
+
+//! \brief Nodes with integral identifiers are found by table lookup.
+//!        The default for integral identifiers other than bool
+struct direct_storage_s {
+  template<class NODE_ID_TYPE>
+  using index_t = direct_node_index_c<NODE_ID_TYPE>;
+};
+
+//! \brief Storage graph_c uses when none is given
+template<class NODE_ID_TYPE>
+using default_storage_t = std::conditional_t<
+  std::is_integral_v<NODE_ID_TYPE> && !std::is_same_v<NODE_ID_TYPE, bool>,
+  direct_storage_s,
+  ordered_storage_s>;
+
+} // namespace
+
+#endif
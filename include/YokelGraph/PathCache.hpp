@@ -0,0 +1,629 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_PATH_CACHE_HPP
+#define YOKEL_PATH_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yokel {
+
+//! \brief Bounds on what a path cache may hold. Zero means unbounded
+struct path_cache_limits_s {
+  std::size_t max_entries{0};
+  std::size_t max_bytes{0};
+};
+
+//! \brief Counters and sizes reported by a path cache. Counters are
+//!        cumulative over the life of the cache
+struct path_cache_stats_s {
+  std::uint64_t hits{0};
+  std::uint64_t misses{0};
+  std::uint64_t insertions{0};
+  std::uint64_t evictions{0};      //! Dropped to stay within the limits
+  std::uint64_t invalidations{0};  //! Dropped because the graph changed
+  std::size_t entries{0};
+  std::size_t bytes{0};            //! Accounted against max_bytes
+  std::size_t reserved_bytes{0};   //! Held by the arenas, used or not
+
+  path_cache_stats_s& operator+=(const path_cache_stats_s& o) {
+    hits += o.hits;
+    misses += o.misses;
+    insertions += o.insertions;
+    evictions += o.evictions;
+    invalidations += o.invalidations;
+    entries += o.entries;
+    bytes += o.bytes;
+    reserved_bytes += o.reserved_bytes;
+    return *this;
+  }
+};
+
+template<class ELEMENT>
+class path_cache_c;
+
+template<class ELEMENT>
+struct path_block_s;
+
+//! \brief Whoever returns a block to its arena once the last reference
+//!        to it is dropped
+template<class ELEMENT>
+class path_block_owner_if {
+public:
+  virtual void release(path_block_s<ELEMENT>* block) = 0;
+};
+
+//! \brief Header of one arena block, followed in memory by the elements
+//!        of a path. The cache holds one reference to every block it
+//!        stores and each view of the block holds another
+template<class ELEMENT>
+struct path_block_s {
+  std::atomic<std::uint32_t> refs{0};
+  std::uint32_t length{0};
+  std::uint8_t size_class{0};
+  path_block_owner_if<ELEMENT>* owner{nullptr};
+
+  ELEMENT* data() {
+    return reinterpret_cast<ELEMENT*>(reinterpret_cast<std::byte*>(this) + sizeof(path_block_s));
+  }
+
+  //! \brief Drop a reference, handing the block back to its owner if
+  //!        it was the last one
+  void unpin() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      owner->release(this);
+    }
+  }
+};
+
+//! \brief Pool of blocks in power-of-two size classes carved out of
+//!        larger slabs. Released blocks go on a free list for their size
+//!        class and are reused before any new slab is allocated.
+template<class ELEMENT>
+class path_arena_c {
+public:
+  using block_t = path_block_s<ELEMENT>;
+
+  static_assert(std::is_trivially_copyable_v<ELEMENT>, "Paths are copied as raw memory");
+  static_assert(alignof(ELEMENT) <= alignof(block_t), "Elements follow the block header");
+
+  //! \brief Elements a block of some size class holds
+  static constexpr std::size_t capacity_of(const std::uint8_t& size_class) {
+    return std::size_t{1} << size_class;
+  }
+
+  //! \brief Size class of the smallest block holding `count` elements
+  static constexpr std::uint8_t class_for(const std::size_t& count) {
+    return (count <= 1) ? 0 : static_cast<std::uint8_t>(std::bit_width(count - 1));
+  }
+
+  //! \brief Bytes one block of some size class occupies, header included
+  static constexpr std::size_t stride_of(const std::uint8_t& size_class) {
+    const std::size_t bytes = sizeof(block_t) + capacity_of(size_class) * sizeof(ELEMENT);
+    return (bytes + alignof(block_t) - 1) / alignof(block_t) * alignof(block_t);
+  }
+
+  block_t* allocate(const std::size_t& count, path_block_owner_if<ELEMENT>* owner) {
+    const auto size_class = class_for(count);
+    auto& free = _free[size_class];
+    if (free.empty()) {
+      const std::size_t stride = stride_of(size_class);
+      const std::size_t per_slab = std::max<std::size_t>(1, SLAB_BYTES / stride);
+      auto& slab = _slabs.emplace_back(std::make_unique_for_overwrite<std::byte[]>(per_slab * stride));
+      for(std::size_t i = per_slab; i > 0; i--) {
+        auto* block = std::construct_at(reinterpret_cast<block_t*>(slab.get() + (i - 1) * stride));
+        block->size_class = size_class;
+        free.push_back(block);
+      }
+      _reserved += per_slab * stride;
+    }
+    auto* block = free.back();
+    free.pop_back();
+    block->owner = owner;
+    block->length = static_cast<std::uint32_t>(count);
+    return block;
+  }
+
+  void release(block_t* block) {
+    _free[block->size_class].push_back(block);
+  }
+
+  //! \brief Free every slab. Outstanding blocks become invalid
+  void clear() {
+    _slabs.clear();
+    for(auto& free : _free) {
+      free.clear();
+    }
+    _reserved = 0;
+  }
+
+  std::size_t reserved_bytes() const { return _reserved; }
+
+private:
+  static constexpr std::size_t SLAB_BYTES = 16384;
+  static constexpr std::size_t SIZE_CLASSES = 33;
+
+  std::vector<std::unique_ptr<std::byte[]>> _slabs;
+  std::array<std::vector<block_t*>, SIZE_CLASSES> _free;
+  std::size_t _reserved{0};
+};
+
+//! \brief A path handed out by a cache without copying it. A view of a
+//!        cached path pins the cache's copy, which then stays readable
+//!        (even if it is evicted or invalidated meanwhile) until the last
+//!        view of it is destroyed; views must not outlive the cache. A
+//!        view can also own a path that was never cached. Either way the
+//!        path describes the graph as of epoch(), the mutation count of
+//!        the graph when it was traced
+template<class ELEMENT>
+class cached_path_c {
+public:
+  cached_path_c() = default;
+
+  //! \brief View owning a path of its own
+  cached_path_c(std::vector<ELEMENT> path, const std::uint64_t& epoch)
+    : _owned(std::move(path)), _data(_owned.data()), _size(_owned.size()), _epoch(epoch) {}
+
+  cached_path_c(const cached_path_c& o)
+    : _block(o._block), _owned(o._owned), _size(o._size), _epoch(o._epoch) {
+    _data = (_block) ? o._data : _owned.data();
+    if (_block) { _block->refs.fetch_add(1, std::memory_order_relaxed); }
+  }
+
+  cached_path_c(cached_path_c&& o) noexcept
+    : _block(std::exchange(o._block, nullptr)),
+      _owned(std::move(o._owned)),
+      _data(std::exchange(o._data, nullptr)),
+      _size(std::exchange(o._size, 0)),
+      _epoch(o._epoch) {}
+
+  cached_path_c& operator=(cached_path_c o) noexcept {
+    std::swap(_block, o._block);
+    std::swap(_owned, o._owned);
+    std::swap(_data, o._data);
+    std::swap(_size, o._size);
+    std::swap(_epoch, o._epoch);
+    return *this;
+  }
+
+  ~cached_path_c() {
+    if (_block) { _block->unpin(); }
+  }
+
+  const ELEMENT* data() const { return _data; }
+  const ELEMENT* begin() const { return _data; }
+  const ELEMENT* end() const { return _data + _size; }
+  std::size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  const ELEMENT& operator[](const std::size_t& i) const { return _data[i]; }
+  const ELEMENT& front() const { return _data[0]; }
+  const ELEMENT& back() const { return _data[_size - 1]; }
+  std::span<const ELEMENT> span() const { return {_data, _size}; }
+
+  //! \brief Check if the view points into cache storage
+  bool cached() const { return _block != nullptr; }
+
+  //! \brief Mutation count of the graph the path was traced in
+  std::uint64_t epoch() const { return _epoch; }
+
+private:
+  friend class path_cache_c<ELEMENT>;
+
+  //! \brief View of a block the caller has already pinned
+  cached_path_c(path_block_s<ELEMENT>* block, const std::uint64_t& epoch)
+    : _block(block), _data(block->data()), _size(block->length), _epoch(epoch) {}
+
+  path_block_s<ELEMENT>* _block{nullptr};
+  std::vector<ELEMENT> _owned;
+  const ELEMENT* _data{nullptr};
+  std::size_t _size{0};
+  std::uint64_t _epoch{0};
+};
+
+//! \brief Cache of traced paths keyed by a packed node index pair.
+//!        Keys are spread over independently locked shards so that
+//!        concurrent lookups (which take a shared lock) and inserts
+//!        (which take an exclusive lock on one shard) rarely contend.
+//!        Paths are stored in a per-shard arena. When limits are set,
+//!        each shard holds its share of them and evicts with the CLOCK
+//!        algorithm: a hit sets an entry's reference bit (an atomic store,
+//!        so hits stay under the shared lock) and the clock hand evicts
+//!        the first entry it finds with the bit clear, clearing bits as
+//!        it passes. A block dropped from the cache while a view still
+//!        pins it returns to the arena when the last view goes away.
+//! \param ELEMENT Element type of the stored paths
+template<class ELEMENT>
+class path_cache_c {
+public:
+  using key_t = std::uint64_t;
+  using path_t = std::vector<ELEMENT>;
+  using view_t = cached_path_c<ELEMENT>;
+
+  //! \brief Create a cache with `shards` shards, rounded up to a power
+  //!        of two. Zero picks one shard per hardware thread
+  explicit path_cache_c(std::size_t shards = 0) {
+    if (shards == 0) {
+      shards = std::thread::hardware_concurrency();
+    }
+    _shard_count = 1;
+    while (_shard_count < shards && _shard_count < MAX_SHARDS) {
+      _shard_count <<= 1;
+    }
+    _shards = std::make_unique<shard_s[]>(_shard_count);
+  }
+
+  path_cache_c(const path_cache_c&) = delete;
+  path_cache_c& operator=(const path_cache_c&) = delete;
+
+  //! \brief Take over another cache's shards, with their paths, views,
+  //!        limits and counters. Shards stay where they are, so views of
+  //!        the other cache stay valid. The other cache is left empty on
+  //!        fresh shards, with the same shard count and limits
+  path_cache_c(path_cache_c&& o)
+    : _shard_count(o._shard_count),
+      _shards(std::exchange(o._shards, std::make_unique<shard_s[]>(o._shard_count))),
+      _limits(o._limits),
+      _shard_entries(o._shard_entries),
+      _shard_bytes(o._shard_bytes) {}
+
+  path_cache_c& operator=(path_cache_c&&) = delete;
+
+  //! \brief Change the limits. Clears the cache
+  void set_limits(const path_cache_limits_s& limits) {
+    clear();
+    _limits = limits;
+    _shard_entries = share_of(limits.max_entries);
+    _shard_bytes = share_of(limits.max_bytes);
+  }
+
+  const path_cache_limits_s& limits() const { return _limits; }
+
+  //! \brief Copy the path cached for key into result
+  //! \returns false if the key is not cached
+  bool find(const key_t& key, path_t& result) const {
+    auto& shard = shard_for(key);
+    std::shared_lock lock(shard.mutex);
+    auto* block = hit(shard, key);
+    if (!block) { return false; }
+    result.assign(block->data(), block->data() + block->length);
+    return true;
+  }
+
+  //! \brief View the path cached for key without copying it
+  std::optional<view_t> find_view(const key_t& key, const std::uint64_t& epoch) const {
+    auto& shard = shard_for(key);
+    std::shared_lock lock(shard.mutex);
+    auto* block = hit(shard, key);
+    if (!block) { return std::nullopt; }
+    block->refs.fetch_add(1, std::memory_order_relaxed);
+    return {view_t(block, epoch)};
+  }
+
+  //! \brief Cache a path, replacing any path already cached for key.
+  //!        Evicts as needed to respect the limits; a path too large
+  //!        for a shard on its own is not cached
+  void insert(const key_t& key, std::span<const ELEMENT> path) {
+    auto& shard = shard_for(key);
+    std::unique_lock lock(shard.mutex);
+    store(shard, key, path);
+  }
+
+  //! \brief Cache a path and return a view of the cached copy. When the
+  //!        path is too large to cache the view owns a copy instead
+  view_t insert_view(const key_t& key, std::span<const ELEMENT> path, const std::uint64_t& epoch) {
+    auto& shard = shard_for(key);
+    std::unique_lock lock(shard.mutex);
+    auto* block = store(shard, key, path);
+    if (!block) { return view_t(path_t(path.begin(), path.end()), epoch); }
+    block->refs.fetch_add(1, std::memory_order_relaxed);
+    return view_t(block, epoch);
+  }
+
+  //! \brief Drop every cached path. The arenas are released unless a
+  //!        view still pins one of their blocks
+  void clear() {
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      auto& shard = _shards[i];
+      std::unique_lock lock(shard.mutex);
+      for(std::size_t slot = 0; slot < shard.entries.size(); slot++) {
+        if (shard.entries[slot].block) { remove(shard, static_cast<std::uint32_t>(slot)); }
+      }
+      shard.index.clear();
+      shard.entries.clear();
+      shard.free_entries.clear();
+      shard.hand = 0;
+      shard.longest = 0;
+      if (!shard.pinned) { shard.arena.clear(); }
+    }
+  }
+
+  //! \brief Drop every path for which pred(key, path) is true, one
+  //!        shard locked at a time. Counted as invalidations. Since every
+  //!        path is visited, longest() is made exact again on the way
+  //! \returns the number of paths dropped
+  template<class PRED>
+  std::size_t erase_if(PRED&& pred) {
+    std::size_t erased{0};
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      auto& shard = _shards[i];
+      std::unique_lock lock(shard.mutex);
+      shard.longest = 0;
+      for(std::size_t slot = 0; slot < shard.entries.size(); slot++) {
+        auto& entry = shard.entries[slot];
+        if (!entry.block) { continue; }
+        if (!pred(entry.key, view(entry))) {
+          shard.longest = std::max<std::size_t>(shard.longest, entry.block->length);
+          continue;
+        }
+        remove(shard, static_cast<std::uint32_t>(slot));
+        shard.invalidations++;
+        erased++;
+      }
+    }
+    return erased;
+  }
+
+  //! \brief At least the length of the longest cached path, in O(shards).
+  //!        Raised as paths are stored; evictions leave it as it is until
+  //!        the next clear or erase_if
+  std::size_t longest() const {
+    std::size_t longest{0};
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      std::shared_lock lock(_shards[i].mutex);
+      longest = std::max(longest, _shards[i].longest);
+    }
+    return longest;
+  }
+
+  //! \brief Visit every cached path as fn(key, span), one shard locked
+  //!        at a time
+  template<class FN>
+  void for_each(FN&& fn) const {
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      auto& shard = _shards[i];
+      std::shared_lock lock(shard.mutex);
+      for(auto& entry : shard.entries) {
+        if (entry.block) { fn(entry.key, view(entry)); }
+      }
+    }
+  }
+
+  //! \brief Visit every cached path as fn(key, span, referenced), where
+  //!        referenced is true for paths found or inserted since the
+  //!        eviction hand last passed them (every path, in a cache that
+  //!        has never evicted anything)
+  template<class FN>
+  void for_each_with_use(FN&& fn) const {
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      auto& shard = _shards[i];
+      std::shared_lock lock(shard.mutex);
+      for(auto& entry : shard.entries) {
+        if (entry.block) { fn(entry.key, view(entry), entry.referenced.load(std::memory_order_relaxed)); }
+      }
+    }
+  }
+
+  //! \brief Number of cached paths
+  std::size_t size() const {
+    std::size_t total{0};
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      std::shared_lock lock(_shards[i].mutex);
+      total += _shards[i].live;
+    }
+    return total;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  //! \brief Sum the counters and sizes of every shard
+  path_cache_stats_s stats() const {
+    path_cache_stats_s stats;
+    for(std::size_t i = 0; i < _shard_count; i++) {
+      auto& shard = _shards[i];
+      std::shared_lock lock(shard.mutex);
+      stats.hits += shard.hits.load(std::memory_order_relaxed);
+      stats.misses += shard.misses.load(std::memory_order_relaxed);
+      stats.insertions += shard.insertions;
+      stats.evictions += shard.evictions;
+      stats.invalidations += shard.invalidations;
+      stats.entries += shard.live;
+      stats.bytes += shard.bytes;
+      stats.reserved_bytes += shard.arena.reserved_bytes();
+    }
+    return stats;
+  }
+
+private:
+  static constexpr std::size_t MAX_SHARDS = 256;
+
+  using arena_t = path_arena_c<ELEMENT>;
+  using block_t = path_block_s<ELEMENT>;
+
+  struct entry_s {
+    key_t key{0};
+    block_t* block{nullptr}; //! Null while the slot is free
+    mutable std::atomic<bool> referenced{false};
+  };
+
+  // Padded to a cache line so neighbouring shard locks do not share one
+  struct alignas(64) shard_s : public path_block_owner_if<ELEMENT> {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<key_t, std::uint32_t> index;
+    std::deque<entry_s> entries;
+    std::vector<std::uint32_t> free_entries;
+    arena_t arena;
+    std::size_t hand{0};
+    std::size_t live{0};
+    std::size_t bytes{0};
+    std::size_t longest{0}; //! Bound on the longest path held, see longest()
+    std::size_t pinned{0}; //! Blocks dropped from the cache but still viewed
+    mutable std::atomic<std::uint64_t> hits{0};
+    mutable std::atomic<std::uint64_t> misses{0};
+    std::uint64_t insertions{0};
+    std::uint64_t evictions{0};
+    std::uint64_t invalidations{0};
+
+    //! \brief The last view of a dropped block went away
+    void release(block_t* block) override {
+      std::unique_lock lock(mutex);
+      arena.release(block);
+      pinned--;
+    }
+  };
+
+  // Rough per-entry bookkeeping (slot plus hash node) counted with the path
+  static constexpr std::size_t ENTRY_OVERHEAD =
+    sizeof(entry_s) + sizeof(key_t) + sizeof(std::uint32_t) + 2 * sizeof(void*);
+
+  std::size_t _shard_count{1};
+  std::unique_ptr<shard_s[]> _shards;
+  path_cache_limits_s _limits;
+  std::size_t _shard_entries{0};
+  std::size_t _shard_bytes{0};
+
+  static std::span<const ELEMENT> view(const entry_s& entry) {
+    return {entry.block->data(), entry.block->length};
+  }
+
+  static std::size_t bytes_for(const std::size_t& length) {
+    return arena_t::stride_of(arena_t::class_for(length)) + ENTRY_OVERHEAD;
+  }
+
+  std::size_t share_of(const std::size_t& limit) const {
+    if (limit == 0) { return 0; }
+    return std::max<std::size_t>(1, (limit + _shard_count - 1) / _shard_count);
+  }
+
+  shard_s& shard_for(key_t key) const {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return _shards[key & (_shard_count - 1)];
+  }
+
+  //! \brief Look a key up under a shared lock, counting the hit or miss
+  static block_t* hit(shard_s& shard, const key_t& key) {
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      shard.misses.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto& entry = shard.entries[it->second];
+    entry.referenced.store(true, std::memory_order_relaxed);
+    shard.hits.fetch_add(1, std::memory_order_relaxed);
+    return entry.block;
+  }
+
+  //! \brief Insert under an exclusive lock
+  //! \returns the stored block, or null if the path was too large
+  block_t* store(shard_s& shard, const key_t& key, std::span<const ELEMENT> path) {
+    if (const auto it = shard.index.find(key); it != shard.index.end()) {
+      remove(shard, it->second);
+    }
+
+    const std::size_t bytes = bytes_for(path.size());
+    if (_shard_bytes && bytes > _shard_bytes) { return nullptr; }
+
+    while (shard.live && (
+           (_shard_entries && shard.live + 1 > _shard_entries) ||
+           (_shard_bytes && shard.bytes + bytes > _shard_bytes))) {
+      evict_one(shard);
+    }
+
+    std::uint32_t slot;
+    if (!shard.free_entries.empty()) {
+      slot = shard.free_entries.back();
+      shard.free_entries.pop_back();
+    } else {
+      slot = static_cast<std::uint32_t>(shard.entries.size());
+      shard.entries.emplace_back();
+    }
+
+    auto* block = shard.arena.allocate(path.size(), &shard);
+    block->refs.store(1, std::memory_order_relaxed);
+    std::copy(path.begin(), path.end(), block->data());
+
+    auto& entry = shard.entries[slot];
+    entry.key = key;
+    entry.block = block;
+    entry.referenced.store(true, std::memory_order_relaxed);
+
+    shard.index.emplace(key, slot);
+    shard.live++;
+    shard.bytes += bytes;
+    shard.longest = std::max(shard.longest, path.size());
+    shard.insertions++;
+    return block;
+  }
+
+  //! \brief Drop an entry under an exclusive lock. Its block goes back
+  //!        to the arena unless a view still pins it
+  static void remove(shard_s& shard, const std::uint32_t slot) {
+    auto& entry = shard.entries[slot];
+    shard.index.erase(entry.key);
+    shard.bytes -= bytes_for(entry.block->length);
+    shard.live--;
+    if (entry.block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      shard.arena.release(entry.block);
+    } else {
+      shard.pinned++;
+    }
+    entry.block = nullptr;
+    shard.free_entries.push_back(slot);
+  }
+
+  static void evict_one(shard_s& shard) {
+    while (true) {
+      const std::size_t slot = shard.hand;
+      shard.hand = (shard.hand + 1) % shard.entries.size();
+
+      auto& entry = shard.entries[slot];
+      if (!entry.block) { continue; }
+      if (entry.referenced.exchange(false, std::memory_order_relaxed)) { continue; }
+
+      remove(shard, static_cast<std::uint32_t>(slot));
+      shard.evictions++;
+      return;
+    }
+  }
+};
+
+} // namespace
+
+#endif
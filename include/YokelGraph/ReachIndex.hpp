@@ -0,0 +1,215 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_REACH_INDEX_HPP
+#define YOKEL_REACH_INDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "SearchScratch.hpp"
+
+namespace yokel {
+
+//! \brief Answers whether one node can reach another from labels on the
+//!        condensation of a graph (each strongly connected component
+//!        collapsed to one node), in the manner of GRAIL.
+//!
+//!        Each component gets DIMENSIONS intervals [low, post], one per
+//!        depth-first postorder of the condensation: post is the
+//!        component's place in that order and low the smallest place of
+//!        anything it reaches. If a reaches b, b's interval lies inside
+//!        a's in every dimension, so one interval that does not fit rules
+//!        the pair out in O(DIMENSIONS). The first order is the Tarjan
+//!        numbering itself; the others visit components and their
+//!        successors in randomly rotated orders.
+//!
+//!        Pairs the labels cannot rule out are settled by a depth-first
+//!        search of the condensation that skips every component whose
+//!        labels rule it out
+class reach_index_c {
+public:
+  using index_t = std::uint32_t;
+
+  static constexpr std::size_t DIMENSIONS = 3;
+
+  reach_index_c() = default;
+
+  //! \brief Build the labels. `component` holds the component of each
+  //!        node by dense index, numbered so every edge runs from a
+  //!        higher number to a lower one (as Tarjan's algorithm numbers
+  //!        them), and the condensation's edges out of component c are
+  //!        targets[offsets[c], offsets[c+1]). Runs in O(DIMENSIONS * (C + E))
+  reach_index_c(std::vector<index_t> component, std::vector<index_t> offsets, std::vector<index_t> targets)
+    : _component(std::move(component)),
+      _offsets(std::move(offsets)),
+      _targets(std::move(targets)) {
+    const auto count = components();
+    _labels.resize(count * DIMENSIONS);
+
+    // Successors have lower numbers, so they are labelled first
+    for(index_t c = 0; c < count; c++) {
+      auto low = c;
+      for(auto t : successors(c)) {
+        low = std::min(low, label(t, 0).low);
+      }
+      label(c, 0) = {low, c};
+    }
+
+    for(std::size_t d = 1; d < DIMENSIONS; d++) {
+      label_randomly(d);
+    }
+  }
+
+  //! \brief Number of components labelled
+  std::size_t components() const {
+    return (_offsets.empty()) ? 0 : _offsets.size() - 1;
+  }
+
+  //! \brief Check that the labels alone prove no path leads from node
+  //!        `from` to node `to`. False means a path may exist
+  bool excludes(const index_t& from, const index_t& to) const {
+    return excludes_components(_component[from], _component[to]);
+  }
+
+  //! \brief Check whether a path leads from node `from` to node `to`
+  bool reachable(const index_t& from, const index_t& to) const {
+    const auto source = _component[from];
+    const auto target = _component[to];
+    if (source == target) { return true; }
+    if (excludes_components(source, target)) { return false; }
+
+    auto& scratch = search_scratch_c::local();
+    scratch.begin(components());
+    auto& stack = scratch.frontier;
+    stack.push_back(source);
+    scratch.visit(source);
+
+    while (!stack.empty()) {
+      const auto c = stack.back();
+      stack.pop_back();
+      for(auto t : successors(c)) {
+        if (t == target) { return true; }
+        if (scratch.visited(t)) { continue; }
+        scratch.visit(t);
+        if (!excludes_components(t, target)) {
+          stack.push_back(t);
+        }
+      }
+    }
+    return false;
+  }
+
+private:
+  struct label_s {
+    index_t low{0};
+    index_t post{0};
+  };
+
+  label_s& label(const index_t& c, const std::size_t& d) { return _labels[c * DIMENSIONS + d]; }
+  const label_s& label(const index_t& c, const std::size_t& d) const { return _labels[c * DIMENSIONS + d]; }
+
+  std::span<const index_t> successors(const index_t& c) const {
+    return {_targets.data() + _offsets[c], _targets.data() + _offsets[c + 1]};
+  }
+
+  bool excludes_components(const index_t& from, const index_t& to) const {
+    if (from == to) { return false; }
+    if (from < to) { return true; }
+    for(std::size_t d = 0; d < DIMENSIONS; d++) {
+      const auto& a = label(from, d);
+      const auto& b = label(to, d);
+      if (b.low < a.low || b.post > a.post) { return true; }
+    }
+    return false;
+  }
+
+  //! \brief Label dimension d from an iterative depth-first postorder
+  //!        that starts at the roots, and at each component's
+  //!        successors, from a random rotation. The condensation is
+  //!        acyclic, so every successor is finished before its
+  //!        predecessor and low can be taken when a component finishes
+  void label_randomly(const std::size_t& d) {
+    static constexpr index_t NONE = std::numeric_limits<index_t>::max();
+    const auto count = static_cast<index_t>(components());
+    if (!count) { return; }
+
+    std::minstd_rand rng(static_cast<std::uint32_t>(d));
+    std::vector<index_t> post(count, NONE);
+
+    struct frame_s {
+      index_t component;
+      index_t start;
+      index_t taken;
+    };
+    std::vector<frame_s> calls;
+    index_t counter{0};
+
+    auto enter = [&](const index_t& c) {
+      post[c] = NONE - 1;
+      const auto degree = static_cast<index_t>(successors(c).size());
+      calls.push_back({c, (degree) ? static_cast<index_t>(rng() % degree) : 0, 0});
+    };
+
+    const auto first = static_cast<index_t>(rng() % count);
+    for(index_t i = 0; i < count; i++) {
+      // Higher numbers come first in topological order, so walk down
+      const auto root = (first + count - i) % count;
+      if (post[root] != NONE) { continue; }
+      enter(root);
+
+      while (!calls.empty()) {
+        auto& frame = calls.back();
+        const auto next = successors(frame.component);
+        if (frame.taken < next.size()) {
+          const auto t = next[(frame.start + frame.taken++) % next.size()];
+          if (post[t] == NONE) { enter(t); }
+          continue;
+        }
+
+        const auto c = frame.component;
+        calls.pop_back();
+        post[c] = counter++;
+        auto low = post[c];
+        for(auto t : next) {
+          low = std::min(low, label(t, d).low);
+        }
+        label(c, d) = {low, post[c]};
+      }
+    }
+  }
+
+  std::vector<index_t> _component;
+  std::vector<index_t> _offsets;
+  std::vector<index_t> _targets;
+  std::vector<label_s> _labels;
+};
+
+} // namespace
+
+#endif
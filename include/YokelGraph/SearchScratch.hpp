@@ -0,0 +1,198 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_SEARCH_SCRATCH_HPP
+#define YOKEL_SEARCH_SCRATCH_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+#include "GraphStats.hpp"
+
+namespace yokel {
+
+//! \brief Per-search working memory indexed by dense node index.
+//!        Visited marks are epoch stamps: a node is visited in the
+//!        current search when its stamp equals the current epoch, so
+//!        starting a new search is O(1) rather than a clear of every mark.
+//!        One instance lives on each thread (see local()), which is what
+//!        lets any number of threads search the same graph at once
+//!        without the graph itself holding search state.
+class search_scratch_c {
+public:
+  using index_t = std::uint32_t;
+
+  //! \brief Scratch for the calling thread. Buffers only grow, so after
+  //!        the first search of a graph no further allocation happens
+  static search_scratch_c& local() {
+    thread_local search_scratch_c scratch;
+    return scratch;
+  }
+
+  //! \brief Per-thread instance of any other working state a search
+  //!        needs beyond indices (costs, heaps). Like the scratch itself
+  //!        it lives as long as the thread and is reused between searches
+  template<class T>
+  static T& typed() {
+    thread_local T value;
+    return value;
+  }
+
+  //! \brief Prepare for a search over `nodes` nodes. Invalidates all
+  //!        marks and frontiers of the previous search on this thread
+  void begin(const std::size_t& nodes) {
+    if (_stamp.size() < nodes) {
+      _stamp.resize(nodes, 0);
+      _stamp_in.resize(nodes, 0);
+      parent.resize(nodes, 0);
+      next.resize(nodes, 0);
+      depth.resize(nodes, 0);
+      via.resize(nodes, 0);
+    }
+    if (_epoch == std::numeric_limits<index_t>::max()) {
+      std::fill(_stamp.begin(), _stamp.end(), 0);
+      std::fill(_stamp_in.begin(), _stamp_in.end(), 0);
+      _epoch = 0;
+    }
+    _epoch++;
+    frontier.clear();
+    frontier_in.clear();
+    next_level.clear();
+  }
+
+  //! \brief Forward (from the source) visited marks
+  bool visited(const index_t& node) const { return _stamp[node] == _epoch; }
+  void visit(const index_t& node) { _stamp[node] = _epoch; }
+
+  //! \brief Backward (from the target) visited marks
+  bool visited_in(const index_t& node) const { return _stamp_in[node] == _epoch; }
+  void visit_in(const index_t& node) { _stamp_in[node] = _epoch; }
+
+  std::vector<index_t> parent;      //! Predecessor on the forward side
+  std::vector<index_t> next;        //! Successor on the backward side
+  std::vector<index_t> depth;       //! Hops from whichever side visited
+  std::vector<index_t> via;         //! Edge a node was reached by, from whichever side
+  std::vector<index_t> frontier;
+  std::vector<index_t> frontier_in;
+  std::vector<index_t> next_level;
+
+  // Work done by searches on this thread since the counts were zeroed.
+  // Only counted under GRAPH_ENABLE_STATS
+  std::uint64_t nodes_visited{0};
+  std::uint64_t edges_scanned{0};
+
+private:
+  index_t _epoch{0};
+  std::vector<index_t> _stamp;
+  std::vector<index_t> _stamp_in;
+};
+
+//! \brief Per-thread bump allocator for the temporary arrays of one
+//!        operation, handed out as a std::pmr::memory_resource. Nothing
+//!        is freed while a scope_c is open; when the outermost scope on
+//!        the thread closes, the arena rewinds to empty. Memory that did
+//!        not fit the retained buffer is freed then, and the buffer grows
+//!        by that much so the next operation of the same size fits.
+//!        Like search_scratch_c, each thread has its own, so it needs no
+//!        locking, and memory from it must not be allocated from other
+//!        threads (reading it from any thread is fine)
+class scratch_arena_c {
+public:
+  static constexpr std::size_t INITIAL_BYTES = 4096;
+
+  //! \brief Arena for the calling thread
+  static scratch_arena_c& local() {
+    thread_local scratch_arena_c arena;
+    return arena;
+  }
+
+  //! \brief Keeps the calling thread's arena from rewinding while open
+  class scope_c {
+  public:
+    scope_c() : _arena(local()) { _arena._depth++; }
+    ~scope_c() {
+      if (--_arena._depth == 0) { _arena.rewind(); }
+    }
+
+    scope_c(const scope_c&) = delete;
+    scope_c& operator=(const scope_c&) = delete;
+
+    //! \brief Resource to allocate this scope's arrays from
+    std::pmr::memory_resource* resource() const { return &*_arena._bump; }
+
+  private:
+    scratch_arena_c& _arena;
+  };
+
+  //! \brief Bytes an operation can take before the arena spills
+  std::size_t capacity() const { return _buffer.size(); }
+
+private:
+  //! \brief Forwards to the heap, counting what the bump allocator
+  //!        could not fit in the buffer
+  class spill_resource_c : public std::pmr::memory_resource {
+  public:
+    std::size_t bytes{0};
+
+  private:
+    void* do_allocate(std::size_t size, std::size_t alignment) override {
+      bytes += size;
+      return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+    void do_deallocate(void* p, std::size_t size, std::size_t alignment) override {
+      std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+  };
+
+  scratch_arena_c() : _buffer(INITIAL_BYTES) {
+    _bump.emplace(_buffer.data(), _buffer.size(), &_spill);
+  }
+
+  void rewind() {
+    _bump.reset();
+    if (_spill.bytes) {
+      _buffer = std::vector<std::byte>(std::bit_ceil(_buffer.size() + _spill.bytes));
+      _spill.bytes = 0;
+    }
+    _bump.emplace(_buffer.data(), _buffer.size(), &_spill);
+  }
+
+  std::size_t _depth{0};
+  std::vector<std::byte> _buffer;
+  spill_resource_c _spill;
+  std::optional<std::pmr::monotonic_buffer_resource> _bump;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,131 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_THREAD_POOL_HPP
+#define YOKEL_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yokel {
+
+//! \brief Fixed set of worker threads pulling tasks from one queue
+class thread_pool_c {
+public:
+  //! \brief Start `threads` workers. Zero starts one per hardware thread
+  explicit thread_pool_c(std::size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    _workers.reserve(threads);
+    for(std::size_t i = 0; i < threads; i++) {
+      _workers.emplace_back([this]() { work(); });
+    }
+  }
+
+  thread_pool_c(const thread_pool_c&) = delete;
+  thread_pool_c& operator=(const thread_pool_c&) = delete;
+
+  //! \brief Finishes every queued task, then joins the workers
+  ~thread_pool_c() {
+    {
+      std::lock_guard lock(_mutex);
+      _stopping = true;
+    }
+    _ready.notify_all();
+    for(auto& worker : _workers) {
+      worker.join();
+    }
+  }
+
+  //! \brief Number of worker threads
+  std::size_t size() const { return _workers.size(); }
+
+  //! \brief Queue a task to run on some worker
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard lock(_mutex);
+      _tasks.push_back(std::move(task));
+    }
+    _ready.notify_one();
+  }
+
+  //! \brief Run fn(i) for every i in [0, count) and wait for all of
+  //!        them. Indices are handed out one at a time, in order, to the
+  //!        workers and to the calling thread, which also does work
+  template<class FN>
+  void parallel_for(const std::size_t& count, FN&& fn) {
+    if (count == 0) { return; }
+
+    std::atomic<std::size_t> next{0};
+    auto drain = [&]() {
+      for(auto i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+        fn(i);
+      }
+    };
+
+    const std::size_t helpers = std::min(size(), count - 1);
+    std::latch done(static_cast<std::ptrdiff_t>(helpers));
+    for(std::size_t i = 0; i < helpers; i++) {
+      submit([&]() {
+        drain();
+        done.count_down();
+      });
+    }
+    drain();
+    done.wait();
+  }
+
+private:
+  std::vector<std::thread> _workers;
+  std::deque<std::function<void()>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _ready;
+  bool _stopping{false};
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(_mutex);
+        _ready.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+        if (_tasks.empty()) { return; }
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,238 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_VERSIONED_GRAPH_HPP
+#define YOKEL_VERSIONED_GRAPH_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Graph.hpp"
+#include "GraphVersion.hpp"
+
+namespace yokel {
+
+//! \brief A graph_c that writers change while readers query published,
+//!        immutable versions of it without taking locks.
+//!
+//!        Writers change the graph through write() (serialized by a
+//!        mutex), and nothing they do is seen until publish() builds a
+//!        new graph_version_c and swaps that in with one atomic store.
+//!        Readers pin() the current version and query it for as long as
+//!        they hold the pin.
+//!
+//!        Versions are built incrementally. The writers' graph records
+//!        the nodes each write changes (graph_c::track_changes), and a
+//!        publish rebuilds only the pages of 64 nodes holding them,
+//!        sharing every other page with the version before. A publish
+//!        costs the edges of the touched pages, not O(V+E), and pinned
+//!        versions hold only the pages they do not share. compact()
+//!        renumbers every node, so the publish after it rebuilds them all.
+//!        Edge data edited in place through a pointer is not seen by the
+//!        graph; call mark_changed on its source node in the same write.
+//!
+//!        Versions are reclaimed by epochs: pinning records the global
+//!        epoch in a reader slot, publishing advances the epoch and tags
+//!        the replaced version with it, and a tagged version is freed
+//!        once no slot holds an older epoch. Pinning and unpinning are a
+//!        compare-exchange on a free slot and a store; MAX_READERS pins
+//!        may be held at once, and pinning waits for a slot beyond that.
+//!        Pins must not outlive the versioned graph.
+//! \param NODE_ID_TYPE Data type nodes are identified by (must be ordered)
+//! \param EDGE_DATA Data type encoded into the edges
+//! \param STORAGE Identifier lookup policy of the writers' graph
+template<class NODE_ID_TYPE, class EDGE_DATA, class STORAGE = default_storage_t<NODE_ID_TYPE>>
+class versioned_graph_c {
+public:
+  using graph_t = graph_c<NODE_ID_TYPE, EDGE_DATA, STORAGE>;
+  using snapshot_t = graph_version_c<NODE_ID_TYPE, EDGE_DATA>;
+
+  static constexpr std::size_t MAX_READERS = 64;
+
+  //! \brief One published version of the graph
+  struct version_s {
+    snapshot_t graph;
+    std::uint64_t number{0};
+  };
+
+  //! \brief A version pinned by a reader, kept alive until this is
+  //!        destroyed. Any number of threads may query it at once
+  class reader_c {
+  public:
+    reader_c(const reader_c&) = delete;
+    reader_c& operator=(const reader_c&) = delete;
+
+    reader_c(reader_c&& o) noexcept
+      : _slot(std::exchange(o._slot, nullptr)),
+        _version(o._version) {}
+
+    reader_c& operator=(reader_c&& o) noexcept {
+      std::swap(_slot, o._slot);
+      std::swap(_version, o._version);
+      return *this;
+    }
+
+    ~reader_c() {
+      if (_slot) { _slot->store(IDLE, std::memory_order_release); }
+    }
+
+    const snapshot_t& operator*() const { return _version->graph; }
+    const snapshot_t* operator->() const { return &_version->graph; }
+
+    //! \brief Count of publishes before this version
+    std::uint64_t version() const { return _version->number; }
+
+  private:
+    friend class versioned_graph_c;
+
+    reader_c(std::atomic<std::uint64_t>* slot, const version_s* version)
+      : _slot(slot), _version(version) {}
+
+    std::atomic<std::uint64_t>* _slot;
+    const version_s* _version;
+  };
+
+  //! \brief Starts with an empty version 0 published
+  versioned_graph_c()
+    : _graph(false),
+      _current(new version_s{}) {
+    _graph.track_changes(true);
+  }
+
+  versioned_graph_c(const versioned_graph_c&) = delete;
+  versioned_graph_c& operator=(const versioned_graph_c&) = delete;
+
+  //! \brief Frees every version. No reader may still hold a pin
+  ~versioned_graph_c() {
+    delete _current.load();
+    for(auto& [version, tag] : _retired) {
+      delete version;
+    }
+  }
+
+  //! \brief Run fn(graph) on the writers' graph with the write lock held.
+  //!        Changes are not visible to readers until publish()
+  template<class FN>
+  decltype(auto) write(FN&& fn) {
+    std::lock_guard lock(_write_mutex);
+    return fn(_graph);
+  }
+
+  //! \brief Build the next version from the current one and what was
+  //!        written since, and make it current. Versions no reader still
+  //!        pins are freed
+  //! \returns the number of the new version
+  std::uint64_t publish() {
+    std::lock_guard lock(_write_mutex);
+    auto* next = new version_s{
+      snapshot_t::next(_current.load()->graph, _graph, _graph.take_changes()), _published + 1};
+    _published++;
+
+    // Readers that pin after the epoch moves can only load `next`, so
+    // the replaced version is safe to free once every older pin is gone
+    auto* replaced = _current.exchange(next);
+    const auto tag = _epoch.fetch_add(1) + 1;
+    _retired.push_back({replaced, tag});
+    reclaim_locked();
+    return next->number;
+  }
+
+  //! \brief Pin the current version. Lock-free unless MAX_READERS pins
+  //!        are already held
+  reader_c pin() const {
+    const std::size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    for(std::size_t i = start; ; i++) {
+      auto& slot = _slots[i % MAX_READERS].epoch;
+      std::uint64_t idle = IDLE;
+      if (slot.load(std::memory_order_relaxed) == IDLE &&
+          slot.compare_exchange_strong(idle, _epoch.load())) {
+        return reader_c(&slot, _current.load());
+      }
+      if ((i - start) % MAX_READERS == MAX_READERS - 1) { std::this_thread::yield(); }
+    }
+  }
+
+  //! \brief Free replaced versions that are no longer pinned. publish()
+  //!        already does this; it is only needed to let go of memory
+  //!        sooner after the last old pin goes away
+  void reclaim() {
+    std::lock_guard lock(_write_mutex);
+    reclaim_locked();
+  }
+
+  //! \brief Replaced versions still waiting for their readers
+  std::size_t retired() const {
+    std::lock_guard lock(_write_mutex);
+    return _retired.size();
+  }
+
+  //! \brief Number of the current version
+  std::uint64_t version() const {
+    std::lock_guard lock(_write_mutex);
+    return _published;
+  }
+
+private:
+  static constexpr std::uint64_t IDLE = 0;
+
+  struct alignas(64) reader_slot_s {
+    std::atomic<std::uint64_t> epoch{IDLE};
+  };
+
+  void reclaim_locked() {
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+    for(auto& slot : _slots) {
+      const auto pinned = slot.epoch.load();
+      if (pinned != IDLE) { oldest = std::min(oldest, pinned); }
+    }
+    auto kept = std::remove_if(_retired.begin(), _retired.end(), [&](const auto& retired) {
+      if (retired.second > oldest) { return false; }
+      delete retired.first;
+      return true;
+    });
+    _retired.erase(kept, _retired.end());
+  }
+
+  mutable std::mutex _write_mutex;
+  graph_t _graph;
+  std::uint64_t _published{0};
+  std::vector<std::pair<version_s*, std::uint64_t>> _retired;
+
+  // Epochs start at 1 so that IDLE never names one
+  std::atomic<std::uint64_t> _epoch{1};
+  std::atomic<version_s*> _current;
+  mutable std::array<reader_slot_s, MAX_READERS> _slots;
+};
+
+} // namespace
+
+#endif
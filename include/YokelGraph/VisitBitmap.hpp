@@ -0,0 +1,145 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_VISIT_BITMAP_HPP
+#define YOKEL_VISIT_BITMAP_HPP
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__AVX2__) && !defined(GRAPH_DISABLE_SIMD)
+#define GRAPH_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+/*
+  Built with AVX2 available (-mavx2 or -march=native), filtering a range
+  of neighbors against a bitmap gathers the bitmap words of eight
+  neighbors at a time. Everything else, and every other target, uses the
+  scalar loop. GRAPH_DISABLE_SIMD forces the scalar loop everywhere.
+*/
+
+namespace yokel {
+
+//! \brief One bit per dense node index, kept in 32 bit words so eight
+//!        of them can be gathered by one AVX2 instruction
+class visit_bitmap_c {
+public:
+  using index_t = std::uint32_t;
+  using word_t = std::uint32_t;
+  static constexpr std::size_t WORD_BITS = 32;
+
+  //! \brief Hold `bits` bits, all clear. Keeps the allocated words
+  void reset(const std::size_t& bits) {
+    _words.assign((bits + WORD_BITS - 1) / WORD_BITS, 0);
+    _bits = bits;
+  }
+
+  std::size_t size() const { return _bits; }
+
+  bool test(const index_t& bit) const {
+    return (_words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+  }
+
+  void set(const index_t& bit) {
+    _words[bit / WORD_BITS] |= word_t{1} << (bit % WORD_BITS);
+  }
+
+  //! \brief Number of bits set
+  std::size_t count() const {
+    std::size_t result{0};
+    for(auto word : _words) {
+      result += std::popcount(word);
+    }
+    return result;
+  }
+
+  std::span<const word_t> words() const { return _words; }
+
+  void swap(visit_bitmap_c& o) {
+    _words.swap(o._words);
+    std::swap(_bits, o._bits);
+  }
+
+  //! \brief Call fn(bit) for every set bit, in ascending order
+  template<class FN>
+  void for_each_set(FN&& fn) const {
+    for(std::size_t w = 0; w < _words.size(); w++) {
+      for(word_t word = _words[w]; word; word &= word - 1) {
+        fn(static_cast<index_t>(w * WORD_BITS + std::countr_zero(word)));
+      }
+    }
+  }
+
+  //! \brief Call fn(bit) for every clear bit below size(), in ascending
+  //!        order. Each word is read once before its bits are handed
+  //!        out, so fn may set bits as it goes
+  template<class FN>
+  void for_each_clear(FN&& fn) const {
+    for(std::size_t w = 0; w < _words.size(); w++) {
+      word_t word = ~_words[w];
+      if (w + 1 == _words.size() && _bits % WORD_BITS) {
+        word &= (word_t{1} << (_bits % WORD_BITS)) - 1;
+      }
+      for(; word; word &= word - 1) {
+        fn(static_cast<index_t>(w * WORD_BITS + std::countr_zero(word)));
+      }
+    }
+  }
+
+  //! \brief Call fn(bit) for every bit in `bits` that is clear, in order.
+  //!        The bits must be distinct and below size(); fn may set them
+  template<class FN>
+  void for_each_clear_in(std::span<const index_t> bits, FN&& fn) const {
+    std::size_t i{0};
+#ifdef GRAPH_SIMD_AVX2
+    const auto* words = reinterpret_cast<const int*>(_words.data());
+    const __m256i low = _mm256_set1_epi32(WORD_BITS - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    for(; i + 8 <= bits.size(); i += 8) {
+      const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits.data() + i));
+      const __m256i word = _mm256_i32gather_epi32(words, _mm256_srli_epi32(index, 5), 4);
+      const __m256i mask = _mm256_sllv_epi32(one, _mm256_and_si256(index, low));
+      const __m256i clear = _mm256_cmpeq_epi32(_mm256_and_si256(word, mask), _mm256_setzero_si256());
+      for(auto lanes = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(clear)));
+          lanes; lanes &= lanes - 1) {
+        fn(bits[i + std::countr_zero(lanes)]);
+      }
+    }
+#endif
+    for(; i < bits.size(); i++) {
+      if (!test(bits[i])) { fn(bits[i]); }
+    }
+  }
+
+private:
+  std::vector<word_t> _words;
+  std::size_t _bits{0};
+};
+
+} // namespace
+
+#endif
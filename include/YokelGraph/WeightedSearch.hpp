@@ -0,0 +1,153 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 bosley
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef YOKEL_WEIGHTED_SEARCH_HPP
+#define YOKEL_WEIGHTED_SEARCH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "SearchScratch.hpp"
+
+namespace yokel {
+
+//! \brief Min-heap with ARITY children per node. A wider node makes the
+//!        tree shallower, so pushes (the common operation in Dijkstra)
+//!        sift through fewer levels, and the children compared on a pop
+//!        sit next to each other in memory
+template<class PRIORITY, class VALUE, std::size_t ARITY = 4>
+class dary_heap_c {
+public:
+  struct entry_s {
+    PRIORITY priority;
+    VALUE value;
+  };
+
+  bool empty() const { return _entries.empty(); }
+  std::size_t size() const { return _entries.size(); }
+  void clear() { _entries.clear(); }
+
+  const entry_s& top() const { return _entries.front(); }
+
+  void push(const PRIORITY& priority, const VALUE& value) {
+    _entries.push_back({priority, value});
+    std::size_t i = _entries.size() - 1;
+    while (i > 0) {
+      const std::size_t parent = (i - 1) / ARITY;
+      if (!(_entries[i].priority < _entries[parent].priority)) { break; }
+      std::swap(_entries[i], _entries[parent]);
+      i = parent;
+    }
+  }
+
+  entry_s pop() {
+    entry_s result = _entries.front();
+    _entries.front() = _entries.back();
+    _entries.pop_back();
+
+    std::size_t i = 0;
+    const std::size_t count = _entries.size();
+    while (true) {
+      const std::size_t first = i * ARITY + 1;
+      if (first >= count) { break; }
+      const std::size_t last = std::min(first + ARITY, count);
+      std::size_t best = first;
+      for(std::size_t c = first + 1; c < last; c++) {
+        if (_entries[c].priority < _entries[best].priority) { best = c; }
+      }
+      if (!(_entries[best].priority < _entries[i].priority)) { break; }
+      std::swap(_entries[i], _entries[best]);
+      i = best;
+    }
+    return result;
+  }
+
+private:
+  std::vector<entry_s> _entries;
+};
+
+//! \brief Dijkstra's algorithm, or A* when heuristic is not zero, over
+//!        dense node indices. Stale heap entries are skipped on pop rather
+//!        than decreased in place. On success scratch.parent and
+//!        scratch.via hold the tree back from target to source, as in
+//!        the hop-count searches.
+//! \param for_each_out Called as for_each_out(node, fn) and must call
+//!        fn(neighbor, edge, cost) for every out edge. Costs must not be
+//!        negative
+//! \param heuristic Called as heuristic(node) and must never overestimate
+//!        the remaining cost to the target (and, for a result that is
+//!        truly cheapest, be consistent)
+//! \returns The cost of the cheapest path, if the target is reachable
+template<class COST, class OUT, class HEURISTIC>
+std::optional<COST> weighted_search(
+  const std::uint32_t& source,
+  const std::uint32_t& target,
+  const std::size_t& nodes,
+  OUT&& for_each_out,
+  HEURISTIC&& heuristic) {
+
+  auto& scratch = search_scratch_c::local();
+  scratch.begin(nodes);
+
+  auto& cost = search_scratch_c::typed<std::vector<COST>>();
+  if (cost.size() < nodes) {
+    cost.resize(nodes);
+  }
+  auto& heap = search_scratch_c::typed<dary_heap_c<COST, std::uint32_t>>();
+  heap.clear();
+
+  // Forward marks: a tentative cost is known. Backward marks: settled
+  scratch.visit(source);
+  cost[source] = COST{};
+  heap.push(heuristic(source), source);
+
+  while (!heap.empty()) {
+    const auto node = heap.pop().value;
+    if (scratch.visited_in(node)) { continue; }
+    scratch.visit_in(node);
+    if (node == target) { return {cost[target]}; }
+    GRAPH_STAT(scratch.nodes_visited++)
+
+    const COST base = cost[node];
+    for_each_out(node, [&](const std::uint32_t& neighbor, const std::uint32_t& edge, const COST& step) {
+      GRAPH_STAT(scratch.edges_scanned++)
+      if (scratch.visited_in(neighbor)) { return; }
+      const COST total = base + step;
+      if (scratch.visited(neighbor) && !(total < cost[neighbor])) { return; }
+      scratch.visit(neighbor);
+      cost[neighbor] = total;
+      scratch.parent[neighbor] = node;
+      scratch.via[neighbor] = edge;
+      heap.push(total + heuristic(neighbor), neighbor);
+    });
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+#endif
@@ -1,304 +1,58 @@
+#include "YokelGraph/AsyncTrace.hpp"
 #include "YokelGraph/Graph.hpp"
+#include "YokelGraph/MappedGraph.hpp"
+#include "YokelGraph/VersionedGraph.hpp"
+#include "test_graphs.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <set>
 #include <string>
+#include <thread>
+#include <unistd.h>
 #include <fmt/format.h>
 
 static constexpr bool SHOW_GRAPH_NUMBER = false;
 static constexpr std::size_t TEST_ITERATIONS = 20;
 
-namespace {
+using flat_test_graph_t = yokel::graph_c<std::string, std::string, yokel::flat_storage_s>;
+using cost_graph_t = yokel::graph_c<std::string, int>;
 
-using test_graph_t = yokel::graph_c<std::string, std::string>;
-using test_data_t = test_graph_t::source_s;
+//! \brief A file in the temp directory named for this process, so test
+//!        binaries running at once do not share it. Removed when this
+//!        goes out of scope, however the test returns
+class temp_file_c {
+public:
+  temp_file_c(const std::string& stem, const std::string& extension)
+    : _path((std::filesystem::temp_directory_path() /
+             fmt::format("{}.{}{}", stem, ::getpid(), extension)).string()) {}
 
-struct test_graph_s {
-  struct path_s {
-    std::string from;
-    std::string to;
-    std::size_t expected_distance{0};
-    std::vector<std::string> expected_path;
-    bool possible{true};
-  };
-  test_data_t data;
-  std::vector<path_s> paths;
-  bool contains_cycles{true};
-};
-
-test_graph_s graph_one() {
-/*
-           ┌────────┐
-           │        │
-           │   G─┐  │
-           │   ▲ │  ▼
-      ┌──► A ──┘ │  B ◄──┐
-      │    │     │       │
-      E ◄──┘     └─────► F ◄┐
-      │                  │  │
-      └──► C ◄───── D ◄──┘  │
-           │                │
-           └─► H ───────────┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E", "F", "G", "H"},
-      {
-        {"A", "G", "A->G"},
-        {"A", "E", "A->E"},
-        {"A", "B", "A->B"},
-        {"E", "A", "E->A"},
-        {"E", "C", "E->C"},
-        {"C", "H", "C->H"},
-        {"G", "F", "G->F"},
-        {"H", "F", "H->F"},
-        {"D", "C", "D->C"},
-        {"F", "B", "F->B"},
-        {"F", "D", "F->D"},
-      }
-    },
-    {
-      {"E", "C", 1, {"E->C"}},
-      {"A", "C", 2, {"A->E", "E->C"}},
-      {"G", "H", 4, {"G->F", "F->D", "D->C", "C->H"}},
-      {"F", "H", 3, {"F->D", "D->C", "C->H"}},
-      {"F", "A", 0, {}, false},
-    }
-  };
-}
+  temp_file_c(const temp_file_c&) = delete;
+  temp_file_c& operator=(const temp_file_c&) = delete;
 
-test_graph_s graph_two() {
-/*
-              ┌────┐
-              │    │
-        ┌────►B◄───┘
-        │     │
-        │     │
-        A     └───►C
-                   │
-                   │
-        E◄────D◄───┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E"},
-      {
-        {"A", "B", "A->B"},
-        {"B", "B", "B->B"},
-        {"B", "C", "B->C"},
-        {"C", "D", "C->D"},
-        {"D", "E", "D->E"},
-      }
-    },
-    {
-      {"B", "B", 1, {"B->B"}},
-      {"B", "A", 0, {}, false},
-      {"A", "C", 2, {"A->B", "B->C"}},
-      {"A", "E", 4, {"A->B", "B->C", "C->D", "D->E"}},
-    }
-  };
-} 
-
-test_graph_s graph_three() {
-/*
-            ┌────┐
-            │    │
-      ┌────►B◄───┘
-      │     │
-      │     │
-      A     └───►C────┐
-                 │    │
-                 │    │
-      E◄────D◄───┘    │
-      ▲               │
-      │               │
-      └───────────────┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E"},
-      {
-        {"A", "B", "A->B"},
-        {"B", "B", "B->B"},
-        {"B", "C", "B->C"},
-        {"C", "D", "C->D"},
-        {"D", "E", "D->E"},
-        {"C", "E", "C->E"},
-      }
-    },
-    {
-      {"B", "B", 1, {"B->B"}},
-      {"A", "C", 2, {"A->B", "B->C"}},
-      {"A", "E", 3, {"A->B", "B->C", "C->E"}},
-      {"X", "Y", 0, {}, false}, // no exist
-      {"Y", "Z", 0, {}, false}, // no exist
-      {"Z", "Z", 0, {}, false}, // no exist
-    }
-  };
-} 
-
-test_graph_s graph_four() {
-/*
-            ┌────────────────────────┐
-            │                        │
-            ▼                        │
-            B  ◄──────── C ◄──────── D ◄────────┐
-                                                │
-    A         ┌───────► E────────────► F ───────┘
-    │         │         │
-    │         │         │
-    └───────► G ◄───────┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E", "F", "G"},
-      {
-        {"A", "G", "A->G"},
-        {"G", "E", "G->E"},
-        {"E", "G", "E->G"},
-        {"E", "F", "E->F"},
-        {"F", "D", "F->D"},
-        {"D", "C", "D->C"},
-        {"D", "B", "D->B"},
-        {"C", "B", "C->B"},
-      }
-    },
-    {
-      {"A", "B", 5, {"A->G", "G->E", "E->F", "F->D", "D->B"}},
-      {"D", "B", 1, {"D->B"}},
-      {"E", "G", 1, {"E->G"}},
-      {"B", "A", 0, {}, false},
-      {"B", "A", 0, {}, false},
-      {"X", "Y", 0, {}, false}, // no exist
-      {"Y", "Z", 0, {}, false}, // no exist
-      {"Z", "Z", 0, {}, false}, // no exist
-    }
-  };
-} 
-
-test_graph_s graph_five() {
-/*
-    A────►C
-    │     │
-    └┐    └─►F
-     ▼       │
-     B─────┐ └──►G
-     │     │     │
-     ▼     ▼     └──►H
-     D     E
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E", "F", "G", "H"},
-      {
-        {"A", "B", "A->B"},
-        {"B", "D", "B->D"},
-        {"B", "E", "B->E"},
-        {"A", "C", "A->C"},
-        {"C", "F", "C->F"},
-        {"F", "G", "F->G"},
-        {"G", "H", "G->H"},
-      }
-    },
-    {
-      {"A", "H", 4, {"A->C", "C->F", "F->G", "G->H"}},
-      {"A", "D", 2, {"A->B", "B->D"}},
-      {"A", "E", 2, {"A->B", "B->E"}},
-      {"F", "H", 2, {"F->G", "G->H"}},
-      {"E", "H", 0, {}, false},
-      {"H", "A", 0, {}, false},
-      {"X", "Y", 0, {}, false}, // no exist
-      {"Y", "Z", 0, {}, false}, // no exist
-      {"Z", "Z", 0, {}, false}, // no exist
-    },
-    false // no cycles
-  };
-}
+  ~temp_file_c() {
+    std::error_code ignored;
+    std::filesystem::remove(_path, ignored);
+  }
 
-test_graph_s graph_six() {
-/*
-                  ┌──────────────────┐
-                  │                  ▼
-       ┌─────────►B───────┐          I
-       │          ▲       ▼
-       │          │       E◄───┐
-       │          │       │    │
-       │          C◄──────┘    │
-       │                       └───H◄─┐
-       │                              │
-   ┌──►A─────────────────►F───────┐   │
-   │   │                  ▲       ▼   │
-   │   │                  │       G───┘
-   │   └─────────►D───────┘
-   │              │
-   └──────────────┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D", "E", "F", "G", "H", "I"},
-      {
-        {"A", "F", "A->F"},
-        {"A", "D", "A->D"},
-        {"A", "B", "A->B"},
-        {"D", "A", "D->A"},
-        {"D", "F", "D->F"},
-        {"F", "G", "F->G"},
-        {"G", "H", "G->H"},
-        {"H", "E", "H->E"},
-        {"E", "C", "E->C"},
-        {"C", "B", "C->B"},
-        {"B", "I", "B->I"},
-        {"B", "E", "B->E"},
-      }
-    },
-    {
-      {"A", "I", 2, {"A->B", "B->I"}},
-      {"D", "I", 3, {"D->A", "A->B", "B->I"}},
-      {"F", "I", 6, {"F->G", "G->H", "H->E", "E->C", "C->B", "B->I"}},
-      {"C", "E", 2, {"C->B", "B->E"}},
-      {"I", "F", 0, {}, false},
-    },
-  };
-}
+  const std::string& path() const { return _path; }
 
-test_graph_s graph_seven() {
-/*
-         ┌──────────┐
-         │          │
-         │          ▼
-    ┌──► A─────┐    B◄───┐
-    │    │     │    │    │
-    │    │     │    │    │
-    │    │     │    │    │
-    │    ▼     │    ▼    │
-    │    C     └───►D────┘
-    │               │
-    │               │
-    └───────────────┘
-*/
-  return test_graph_s{
-    {
-      {"A", "B", "C", "D"},
-      {
-        {"A", "D", "A->D"},
-        {"A", "B", "A->B"},
-        {"A", "C", "A->C"},
-        {"D", "B", "D->B"},
-        {"D", "A", "D->A"},
-        {"B", "D", "B->D"},
-      }
-    },
-    {
-      {"A", "C", 1, {"A->C"}},
-      {"B", "C", 3, {"B->D", "D->A", "A->C"}},
-    },
-  };
-}
-} // namespace
+private:
+  std::string _path;
+};
 
-bool graph_tests() {
+template<class GRAPH>
+bool graph_tests(typename GRAPH::search_strategy_e strategy) {
 
   static constexpr bool CHECK_CYCLES = true;
 
-  using nodes_t = yokel::graph_c<std::string, std::string>::node_list_t;
+  using nodes_t = typename GRAPH::node_list_t;
 
   std::size_t i{1};
   for(auto graph_fn : {
@@ -315,7 +69,8 @@ bool graph_tests() {
       fmt::print(stderr, "Graph test # {}\n", i++);
     }
 
-    yokel::graph_c<std::string, std::string> graph;
+    GRAPH graph;
+    graph.set_search_strategy(strategy);
     auto graph_data = graph_fn();
 
     if (!graph.build_from(graph_data.data)) {
@@ -387,9 +142,2554 @@ bool graph_tests() {
   return true;
 }
 
-int main(void) {
-  for(std::size_t i = 0; i < TEST_ITERATIONS; i++) {
-    if (!graph_tests()) {
+bool frozen_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    test_graph_t graph;
+    auto graph_data = graph_fn();
+
+    if (!graph.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    auto frozen = graph.freeze();
+    if (frozen.node_count() != graph_data.data.nodes.size() ||
+        frozen.edge_count() != graph_data.data.edges.size()) {
+      fmt::print(stderr, "Frozen graph has the wrong shape\n");
+      return false;
+    }
+
+    test_graph_t::frozen_t::path_t result;
+    test_graph_t::frozen_t::edge_list_t edges;
+
+    for (auto& path : graph_data.paths) {
+      const bool found = frozen.trace(path.from, path.to, result);
+
+      if (found != path.possible) {
+        fmt::print(stderr, "Frozen trace {} to {} expected possible={}\n",
+            path.from, path.to, path.possible);
+        return false;
+      }
+
+      if (!found || (result.size() <= 1 && path.from != path.to)) {
+        continue;
+      }
+
+      if (frozen.id_of(result.front()) != path.from ||
+          frozen.id_of(result.back()) != path.to) {
+        fmt::print(stderr, "Frozen trace {} to {} has the wrong endpoints\n",
+            path.from, path.to);
+        return false;
+      }
+
+      if (!frozen.load_edges(result, edges) || edges.size() != path.expected_path.size()) {
+        fmt::print(stderr, "Unable to retrieve frozen edges for {} to {}\n", path.from, path.to);
+        return false;
+      }
+
+      for(std::size_t i = 0; i < path.expected_path.size(); i++) {
+        if (path.expected_path[i] != *edges[i]) {
+          fmt::print(stderr, "Unexpected frozen edge for {} to {}, Expected {} got {}\n",
+            path.from, path.to, path.expected_path[i], *edges[i]);
+          return false;
+        }
+      }
+    }
+  }
+
+  // 32 bit identifiers are the same type as indices, so trace by
+  // identifier and trace_index by index must stay apart: ids 10, 20 and 30
+  // sit at indices 0, 1 and 2
+  yokel::graph_c<std::uint32_t, int> narrow(false);
+  for(std::uint32_t id : {30, 10, 20}) {
+    narrow.add_node(id);
+  }
+  narrow.add_edge(10, 20, 1);
+  narrow.add_edge(20, 30, 2);
+  auto frozen = narrow.freeze();
+  yokel::graph_c<std::uint32_t, int>::frozen_t::path_t path;
+  if (!frozen.trace(10, 30, path) || path.size() != 3 ||
+      !frozen.trace_index(0, 2, path) || path.size() != 3 ||
+      frozen.trace(0, 2, path) || frozen.id_of(path.front()) != 10) {
+    fmt::print(stderr, "Frozen 32 bit identifiers were mixed up with indices\n");
+    return false;
+  }
+  return true;
+}
+
+bool wide_search_tests() {
+  using wide_graph_t = yokel::graph_c<std::uint64_t, int>;
+  using frozen_t = wide_graph_t::frozen_t;
+
+  // Dense enough for frontiers to go bottom-up within a couple of levels,
+  // plus a tail only reachable one hop at a time and an unreachable island
+  std::mt19937 rng(77);
+  const std::uint32_t nodes = 3000;
+  std::uniform_int_distribution<std::uint32_t> pick(0, 1999);
+  wide_graph_t graph(false);
+  for(std::uint32_t i = 0; i < nodes; i++) {
+    graph.add_node(i);
+  }
+  for(std::uint32_t i = 0; i < 2000; i++) {
+    for(int e = 0; e < 12; e++) {
+      graph.add_edge(i, pick(rng), 0);
+    }
+  }
+  for(std::uint32_t i = 1999; i < 2500; i++) {
+    graph.add_edge(i, i + 1, 0);
+  }
+  for(std::uint32_t i = 2600; i < 2999; i++) {
+    graph.add_edge(i, i + 1, 0);
+  }
+  auto frozen = graph.freeze();
+
+  frozen_t::path_t narrow;
+  frozen_t::path_t wide;
+  for(std::uint32_t q = 0; q < 200; q++) {
+    const auto from = *frozen.index_of(pick(rng));
+    const auto to = *frozen.index_of((q % 4 == 0) ? 2500 - q : pick(rng) + (q % 2) * 1000);
+    const bool found = frozen.trace_index(from, to, narrow);
+    if (frozen.trace_wide(from, to, wide) != found || wide.size() != narrow.size()) {
+      fmt::print(stderr, "Wide trace {} to {} disagrees with trace\n", from, to);
+      return false;
+    }
+    for(std::size_t i = 0; i + 1 < wide.size(); i++) {
+      if (!frozen.get_edge(wide[i], wide[i + 1])) {
+        fmt::print(stderr, "Wide trace {} to {} crossed a missing edge\n", from, to);
+        return false;
+      }
+    }
+    if (found && (wide.front() != from || wide.back() != to)) {
+      fmt::print(stderr, "Wide trace {} to {} has the wrong endpoints\n", from, to);
+      return false;
+    }
+  }
+
+  yokel::visit_bitmap_c reached;
+  if (frozen.reach(*frozen.index_of(0), reached) != 2501 || reached.test(*frozen.index_of(2600)) ||
+      frozen.reach(*frozen.index_of(2600), reached) != 400 || !reached.test(*frozen.index_of(2999)) ||
+      frozen.reach(*frozen.index_of(2550), reached) != 1) {
+    fmt::print(stderr, "Reach counted the wrong nodes\n");
+    return false;
+  }
+  if (!frozen.trace_wide(5, 5, wide) || wide.size() != 1 ||
+      frozen.trace_wide(*frozen.index_of(2600), *frozen.index_of(0), wide)) {
+    fmt::print(stderr, "Wide trace handled a trivial query wrongly\n");
+    return false;
+  }
+  return true;
+}
+
+bool edge_key_tests() {
+
+  // With std::hash<int> being the identity, hash(0) ^ (hash(1) << 1) and
+  // hash(2) ^ (hash(0) << 1) are equal. Both edges must still be accepted
+  // and traced independently
+  yokel::graph_c<int, std::string> graph;
+  if (!graph.build_from({{0, 1, 2}, {{0, 1, "0->1"}, {2, 0, "2->0"}}})) {
+    fmt::print(stderr, "Failed to build graph with colliding identifier hashes\n");
+    return false;
+  }
+
+  auto forward = graph.trace(0, 1);
+  auto backward = graph.trace(2, 0);
+  if (!forward.has_value() || !backward.has_value()) {
+    fmt::print(stderr, "Failed to trace graph with colliding identifier hashes\n");
+    return false;
+  }
+
+  auto forward_edges = graph.load_edges(*forward);
+  auto backward_edges = graph.load_edges(*backward);
+  if (!forward_edges.has_value() || !backward_edges.has_value() ||
+      *forward_edges->at(0) != "0->1" || *backward_edges->at(0) != "2->0") {
+    fmt::print(stderr, "Retrieved the wrong edge for colliding identifier hashes\n");
+    return false;
+  }
+
+  if (graph.add_edge(0, 1, "dup")) {
+    fmt::print(stderr, "Duplicate edge was accepted\n");
+    return false;
+  }
+  return true;
+}
+
+bool direct_storage_tests() {
+  static_assert(std::is_same_v<yokel::default_storage_t<std::uint32_t>, yokel::direct_storage_s>);
+  static_assert(std::is_same_v<yokel::default_storage_t<std::string>, yokel::ordered_storage_s>);
+
+  // Small dense identifiers land in the table, large and negative ones
+  // are spilled to the hash table; lookups must not care which
+  yokel::graph_c<std::int64_t, std::string> graph;
+  const std::vector<std::int64_t> ids = {0, 1, 2, 3, 5000000000LL, -7, 900, 1 << 20};
+  yokel::graph_source_s<std::int64_t, std::string> source;
+  source.nodes = ids;
+  for(std::size_t i = 0; i + 1 < ids.size(); i++) {
+    source.edges.push_back({ids[i], ids[i + 1], fmt::format("{}->{}", ids[i], ids[i + 1])});
+  }
+  if (!graph.build_from(source) || graph.add_node(-7) || graph.add_node(5000000000LL)) {
+    fmt::print(stderr, "Failed to build a graph with direct storage\n");
+    return false;
+  }
+
+  auto path = graph.trace(0, 1 << 20);
+  if (!path || path->size() != ids.size() || *path->at(4)->data() != 5000000000LL) {
+    fmt::print(stderr, "Failed to trace across spilled identifiers\n");
+    return false;
+  }
+
+  // Ids freed by removal can be added again, and survive compaction
+  if (!graph.remove_node(-7) || graph.trace(0, 900).has_value() ||
+      !graph.add_node(-7) || !graph.add_edge(5000000000LL, -7, "back") ||
+      !graph.add_edge(-7, 900, "again") || !graph.remove_node(2)) {
+    fmt::print(stderr, "Failed to remove and re-add nodes with direct storage\n");
+    return false;
+  }
+  graph.compact();
+  if (graph.trace(0, 900).has_value() || !graph.trace(3, 900) || graph.node_count() != ids.size() - 1) {
+    fmt::print(stderr, "Direct storage was wrong after compaction\n");
+    return false;
+  }
+
+  // Identifiers arriving in descending order still fill the table
+  // when the count is known up front
+  yokel::graph_c<std::uint32_t, int> descending(false);
+  yokel::graph_source_s<std::uint32_t, int> chain;
+  for(std::uint32_t i = 5000; i > 0; i--) {
+    chain.nodes.push_back(i - 1);
+    if (i < 5000) { chain.edges.push_back({i, i - 1, static_cast<int>(i)}); }
+  }
+  if (!descending.build_from(chain)) {
+    fmt::print(stderr, "Failed to build a descending chain\n");
+    return false;
+  }
+  auto hops = descending.trace(4999, 0);
+  if (!hops || hops->size() != 5000 || descending.trace(0, 1).has_value()) {
+    fmt::print(stderr, "Failed to trace a descending chain\n");
+    return false;
+  }
+  return true;
+}
+
+bool concurrent_trace_tests() {
+
+  static constexpr std::size_t THREADS = 8;
+  static constexpr std::size_t ROUNDS = 200;
+
+  for(bool cache : {false, true}) {
+    for(auto graph_fn : { graph_one, graph_four, graph_six, graph_seven }) {
+      test_graph_t graph(cache);
+      auto graph_data = graph_fn();
+      if (!graph.build_from(graph_data.data)) {
+        fmt::print(stderr, "Failed to build graph\n");
+        return false;
+      }
+
+      // Expected hop counts, traced before any threads start
+      std::vector<std::size_t> expected;
+      for(auto& path : graph_data.paths) {
+        auto result = graph.trace(path.from, path.to);
+        expected.push_back((result.has_value()) ? result->size() : 0);
+      }
+      graph.clear_cache();
+
+      std::atomic<bool> failed{false};
+      std::vector<std::thread> threads;
+      for(std::size_t t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+          for(std::size_t r = 0; r < ROUNDS; r++) {
+            for(std::size_t i = 0; i < graph_data.paths.size(); i++) {
+              auto& path = graph_data.paths[(i + t) % graph_data.paths.size()];
+              auto result = graph.trace(path.from, path.to);
+              const std::size_t len = (result.has_value()) ? result->size() : 0;
+              if (len != expected[(i + t) % graph_data.paths.size()]) {
+                failed = true;
+              }
+              if (len > 1 && !graph.load_edges(*result).has_value()) {
+                failed = true;
+              }
+            }
+          }
+        });
+      }
+      for(auto& thread : threads) {
+        thread.join();
+      }
+      if (failed) {
+        fmt::print(stderr, "Concurrent traces disagreed with sequential traces (cache={})\n", cache);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool batch_tests() {
+
+  yokel::thread_pool_c pool(4);
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    test_graph_t graph(false);
+    auto graph_data = graph_fn();
+    if (!graph.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    // Every path twice, so sources repeat within the batch
+    std::vector<test_graph_t::query_t> queries;
+    for(std::size_t i = 0; i < 2; i++) {
+      for(auto& path : graph_data.paths) {
+        queries.push_back({path.from, path.to});
+      }
+    }
+
+    for(bool pooled : {false, true}) {
+      auto batch = (pooled) ? graph.trace_batch(queries, pool) : graph.trace_batch(queries);
+      if (batch.size() != queries.size()) {
+        fmt::print(stderr, "Batch has {} results for {} queries\n", batch.size(), queries.size());
+        return false;
+      }
+
+      for(std::size_t i = 0; i < queries.size(); i++) {
+        auto expected = graph.trace(queries[i].first, queries[i].second);
+        if (expected.has_value() != batch.found(i)) {
+          fmt::print(stderr, "Batch disagrees on reachability of {} to {}\n",
+              queries[i].first, queries[i].second);
+          return false;
+        }
+        if (!batch.found(i)) { continue; }
+
+        auto path = batch.path(i);
+        if (!std::equal(path.begin(), path.end(), expected->begin(), expected->end())) {
+          fmt::print(stderr, "Batch path differs for {} to {}\n",
+              queries[i].first, queries[i].second);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool path_tree_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    test_graph_t graph(false);
+    auto graph_data = graph_fn();
+    if (!graph.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    for(auto& from : graph_data.data.nodes) {
+      auto tree = graph.trace_all_from(from);
+      if (!tree.has_value() || *tree->root()->data() != from) {
+        fmt::print(stderr, "Failed to trace all paths from {}\n", from);
+        return false;
+      }
+
+      for(auto& to : graph_data.data.nodes) {
+        auto expected = graph.trace(from, to);
+        auto path = tree->path_to(to);
+        if (expected.has_value() != path.has_value() ||
+            (path.has_value() && *path != *expected) ||
+            (path.has_value() && *tree->distance(to) != path->size() - 1)) {
+          fmt::print(stderr, "Path tree from {} disagrees with trace to {}\n", from, to);
+          return false;
+        }
+      }
+    }
+
+    if (graph.trace_all_from("no such node").has_value()) {
+      fmt::print(stderr, "Traced a tree from a missing node\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cache_invalidation_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    test_graph_t cached(true);
+    test_graph_t reference(false);
+    if (!cached.build_from(graph_data.data) || !reference.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    auto& nodes = graph_data.data.nodes;
+
+    // Every pair must match an uncached graph after each live change
+    auto all_pairs_match = [&]() {
+      for(auto& from : nodes) {
+        for(auto& to : nodes) {
+          auto expected = reference.trace(from, to);
+          auto result = cached.trace(from, to);
+          if (expected.has_value() != result.has_value() ||
+              (result.has_value() && result->size() != expected->size())) {
+            fmt::print(stderr, "Stale cached path for {} to {}\n", from, to);
+            return false;
+          }
+        }
+      }
+      return true;
+    };
+
+    if (!all_pairs_match()) { return false; }
+
+    if (!cached.add_node("new") || !reference.add_node("new")) {
+      fmt::print(stderr, "Failed to add node\n");
+      return false;
+    }
+    nodes.push_back("new");
+    if (!all_pairs_match()) { return false; }
+
+    for(std::size_t i = 0; i < nodes.size(); i++) {
+      auto& from = nodes[i];
+      auto& to = nodes[(i * 3 + 2) % nodes.size()];
+      if (cached.add_edge(from, to, "shortcut") != reference.add_edge(from, to, "shortcut")) {
+        fmt::print(stderr, "Graphs disagree on adding {} to {}\n", from, to);
+        return false;
+      }
+      if (!all_pairs_match()) { return false; }
+    }
+  }
+  return true;
+}
+
+bool bounded_cache_tests() {
+
+  auto graph_data = graph_seven();
+  auto& nodes = graph_data.data.nodes;
+
+  for(auto limits : {
+      yokel::path_cache_limits_s{4, 0},
+      yokel::path_cache_limits_s{0, 512},
+      yokel::path_cache_limits_s{1, 0}
+      }) {
+
+    test_graph_t bounded(true);
+    test_graph_t reference(false);
+    if (!bounded.build_from(graph_data.data) || !reference.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+    bounded.set_cache_limits(limits);
+
+    // Two passes so the second sees hits, evictions and re-inserts
+    for(std::size_t pass = 0; pass < 2; pass++) {
+      for(auto& from : nodes) {
+        for(auto& to : nodes) {
+          auto expected = reference.trace(from, to);
+          auto result = bounded.trace(from, to);
+          if (expected.has_value() != result.has_value() ||
+              (result.has_value() && result->size() != expected->size())) {
+            fmt::print(stderr, "Bounded cache returned a wrong path for {} to {}\n", from, to);
+            return false;
+          }
+          if (result.has_value() &&
+              bounded.load_edges(*result).has_value() != reference.load_edges(*expected).has_value()) {
+            fmt::print(stderr, "Bounded cache path has missing edges\n");
+            return false;
+          }
+        }
+      }
+    }
+
+    auto stats = bounded.cache_stats();
+    if ((limits.max_entries && stats.entries > limits.max_entries) ||
+        (limits.max_bytes && stats.bytes > limits.max_bytes)) {
+      fmt::print(stderr, "Cache exceeded its limits ({} entries, {} bytes)\n",
+        stats.entries, stats.bytes);
+      return false;
+    }
+    if (stats.evictions == 0 || stats.misses == 0 ||
+        stats.insertions != stats.entries + stats.evictions) {
+      fmt::print(stderr, "Unexpected cache counters\n");
+      return false;
+    }
+    if (!bounded.optimize_trace()) {
+      fmt::print(stderr, "Failed to optimize a bounded cache\n");
+      return false;
+    }
+
+    bounded.toggle_cache(false);
+    if (bounded.cache_stats().entries != 0 || bounded.cache_stats().bytes != 0) {
+      fmt::print(stderr, "Toggling the cache did not clear it\n");
+      return false;
+    }
+  }
+
+  // Unbounded, a repeat query is a hit
+  test_graph_t graph(true);
+  graph.build_from(graph_data.data);
+  graph.trace(nodes.front(), nodes.back());
+  graph.trace(nodes.front(), nodes.back());
+  auto stats = graph.cache_stats();
+  if (stats.hits != 1 || stats.misses != 1 || stats.evictions != 0) {
+    fmt::print(stderr, "Expected one hit and one miss, got {} and {}\n", stats.hits, stats.misses);
+    return false;
+  }
+  return true;
+}
+
+bool component_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    test_graph_t graph(false);
+    if (!graph.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    auto& components = graph.strongly_connected_components();
+    auto& nodes = graph_data.data.nodes;
+
+    // Two nodes share a component exactly when each reaches the other
+    for(auto& a : nodes) {
+      for(auto& b : nodes) {
+        const bool mutual = graph.trace(a, b).has_value() && graph.trace(b, a).has_value();
+        if (mutual != (*graph.component_of(a) == *graph.component_of(b))) {
+          fmt::print(stderr, "Wrong components for {} and {}\n", a, b);
+          return false;
+        }
+      }
+    }
+
+    // Components come in reverse topological order
+    for(auto& edge : graph_data.data.edges) {
+      if (*graph.component_of(edge.from) < *graph.component_of(edge.to)) {
+        fmt::print(stderr, "Components out of order on {} to {}\n", edge.from, edge.to);
+        return false;
+      }
+    }
+
+    std::size_t members{0};
+    for(std::size_t c = 0; c < components.size(); c++) {
+      members += components.members(c).size();
+    }
+    if (members != nodes.size()) {
+      fmt::print(stderr, "Components do not cover every node\n");
+      return false;
+    }
+  }
+
+  // A long ring would overflow a recursive search
+  test_graph_t ring(false);
+  const std::size_t ring_size = 100000;
+  for(std::size_t i = 0; i < ring_size; i++) {
+    ring.add_node(std::to_string(i));
+  }
+  for(std::size_t i = 0; i + 1 < ring_size; i++) {
+    ring.add_edge(std::to_string(i), std::to_string(i + 1), "");
+  }
+  if (ring.contains_cycles() || ring.strongly_connected_components().size() != ring_size) {
+    fmt::print(stderr, "Chain should have no cycles\n");
+    return false;
+  }
+  ring.add_edge(std::to_string(ring_size - 1), "0", "");
+  if (!ring.contains_cycles() || ring.strongly_connected_components().size() != 1) {
+    fmt::print(stderr, "Closed ring should be one cyclic component\n");
+    return false;
+  }
+  return true;
+}
+
+bool reachability_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    test_graph_t graph(false);
+    if (!graph.build_from(graph_data.data)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    auto& nodes = graph_data.data.nodes;
+    std::vector<bool> expected;
+    for(auto& a : nodes) {
+      for(auto& b : nodes) {
+        expected.push_back(graph.trace(a, b).has_value());
+      }
+    }
+
+    // With the index built, trace and reachable agree with a plain search
+    graph.index_reachability();
+    std::size_t i{0};
+    for(auto& a : nodes) {
+      for(auto& b : nodes) {
+        const bool reached = expected[i++];
+        if (graph.reachable(a, b) != reached || graph.trace(a, b).has_value() != reached) {
+          fmt::print(stderr, "Reachability from {} to {} should be {}\n", a, b, reached);
+          return false;
+        }
+      }
+    }
+  }
+
+  // The unreachable pair of the first graph is answered without a search
+  auto first = graph_one();
+  test_graph_t graph(false);
+  graph.build_from(first.data);
+  graph.index_reachability();
+#ifdef GRAPH_ENABLE_STATS
+  std::uint64_t visited{1};
+  graph.set_trace_hook([&](const yokel::trace_stats_s& query) { visited = query.nodes_visited; });
+#endif
+  if (graph.trace("F", "A").has_value() || graph.reachable("F", "A")) {
+    fmt::print(stderr, "F should not reach A\n");
+    return false;
+  }
+#ifdef GRAPH_ENABLE_STATS
+  if (visited != 0) {
+    fmt::print(stderr, "Unreachable trace still visited {} nodes\n", visited);
+    return false;
+  }
+#endif
+
+  // Changing the graph drops the index
+  graph.add_edge("B", "A", "B->A");
+  if (!graph.reachable("F", "A") || !graph.trace("F", "A").has_value()) {
+    fmt::print(stderr, "Reachability was not updated by a new edge\n");
+    return false;
+  }
+  graph.remove_edge("B", "A");
+  if (graph.reachable("F", "A") || !graph.reachable("A", "F")) {
+    fmt::print(stderr, "Reachability was not updated by a removed edge\n");
+    return false;
+  }
+
+  // Random sparse graph: a few large components and long chains of small
+  // ones, so pairs reach both through labels and through the fallback search
+  std::mt19937 rng(2718);
+  const std::size_t count = 1500;
+  std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+  test_graph_t sparse(false);
+  for(std::size_t n = 0; n < count; n++) {
+    sparse.add_node(std::to_string(n));
+  }
+  for(std::size_t e = 0; e < count * 3 / 2; e++) {
+    const auto a = pick(rng);
+    const auto b = pick(rng);
+    sparse.add_edge(std::to_string(std::max(a, b)), std::to_string(std::min(a, b)), "");
+    if (e % 10 == 0) {
+      sparse.add_edge(std::to_string(std::min(a, b)), std::to_string(std::max(a, b)), "");
+    }
+  }
+  std::vector<std::pair<std::string, std::string>> pairs;
+  std::vector<bool> reached;
+  for(std::size_t q = 0; q < 2000; q++) {
+    pairs.emplace_back(std::to_string(pick(rng)), std::to_string(pick(rng)));
+    reached.push_back(sparse.trace(pairs.back().first, pairs.back().second).has_value());
+  }
+  for(std::size_t q = 0; q < pairs.size(); q++) {
+    if (sparse.reachable(pairs[q].first, pairs[q].second) != reached[q]) {
+      fmt::print(stderr, "Reachability from {} to {} should be {}\n", pairs[q].first, pairs[q].second, reached[q]);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool path_view_tests() {
+
+  for(auto cache : {true, false}) {
+    for(auto graph_fn : {
+        graph_one,
+        graph_two,
+        graph_three,
+        graph_four,
+        graph_five,
+        graph_six,
+        graph_seven
+        }) {
+
+      auto graph_data = graph_fn();
+      test_graph_t graph(cache);
+      if (!graph.build_from(graph_data.data)) {
+        fmt::print(stderr, "Failed to build graph\n");
+        return false;
+      }
+
+      // Twice, so the second pass views cached paths
+      for(std::size_t pass = 0; pass < 2; pass++) {
+        for(auto& from : graph_data.data.nodes) {
+          for(auto& to : graph_data.data.nodes) {
+            auto expected = graph.trace(from, to);
+            auto view = graph.trace_view(from, to);
+            if (expected.has_value() != view.has_value()) {
+              fmt::print(stderr, "View disagrees with trace for {} to {}\n", from, to);
+              return false;
+            }
+            if (!view.has_value()) { continue; }
+            if (!std::equal(view->begin(), view->end(), expected->begin(), expected->end()) ||
+                view->cached() != cache) {
+              fmt::print(stderr, "Wrong view for {} to {}\n", from, to);
+              return false;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // A view keeps its path readable after the cache lets go of it
+  auto graph_data = graph_seven();
+  test_graph_t graph(true);
+  graph.build_from(graph_data.data);
+  graph.set_cache_limits({1, 0});
+
+  auto view = graph.trace_view("B", "C");
+  if (!view.has_value() || view->size() != 4) {
+    fmt::print(stderr, "Expected a 4 node view\n");
+    return false;
+  }
+  const std::vector<test_graph_t::node_if*> copy(view->begin(), view->end());
+  const auto epoch = graph.epoch();
+
+  graph.trace_view("A", "C");      // Evicts B->C
+  graph.add_edge("B", "C", "B->C"); // Changes the graph
+  graph.clear_cache();
+  graph.trace_view("D", "C");      // Reuses arena blocks
+  graph.trace_view("A", "B");
+
+  auto later = *view;
+  if (!std::equal(later.begin(), later.end(), copy.begin(), copy.end()) ||
+      view->epoch() != epoch || graph.epoch() == epoch) {
+    fmt::print(stderr, "Pinned view changed under eviction\n");
+    return false;
+  }
+  auto fresh = graph.trace_view("B", "C");
+  if (!fresh.has_value() || fresh->size() != 2 || fresh->epoch() != graph.epoch()) {
+    fmt::print(stderr, "Expected the new direct edge\n");
+    return false;
+  }
+  return true;
+}
+
+bool indexed_path_tests() {
+
+  for(auto strategy : {
+      test_graph_t::search_strategy_e::BREADTH_FIRST,
+      test_graph_t::search_strategy_e::BIDIRECTIONAL
+      }) {
+    for(auto graph_fn : {
+        graph_one,
+        graph_two,
+        graph_three,
+        graph_four,
+        graph_five,
+        graph_six,
+        graph_seven
+        }) {
+
+      auto graph_data = graph_fn();
+      test_graph_t graph(false);
+      if (!graph.build_from(graph_data.data)) {
+        fmt::print(stderr, "Failed to build graph\n");
+        return false;
+      }
+      graph.set_search_strategy(strategy);
+
+      test_graph_t::indexed_path_s path;
+      test_graph_t::edge_list_t edges;
+      std::vector<std::uint32_t> nodes;
+      for(auto& from : graph_data.data.nodes) {
+        for(auto& to : graph_data.data.nodes) {
+          auto expected = graph.trace(from, to);
+          if (expected.has_value() != graph.trace_indexed(from, to, path)) {
+            fmt::print(stderr, "Indexed trace disagrees for {} to {}\n", from, to);
+            return false;
+          }
+          if (!expected.has_value()) { continue; }
+
+          graph.path_nodes(path, nodes);
+          if (nodes.size() != expected->size()) {
+            fmt::print(stderr, "Indexed path length differs for {} to {}\n", from, to);
+            return false;
+          }
+          for(std::size_t i = 0; i < nodes.size(); i++) {
+            if (graph.id_of(nodes[i]) != *(*expected)[i]->data() ||
+                nodes[i] != *graph.index_of(*(*expected)[i]->data())) {
+              fmt::print(stderr, "Indexed path differs for {} to {}\n", from, to);
+              return false;
+            }
+          }
+          for(std::size_t i = 0; i < path.edges.size(); i++) {
+            if (graph.edge_source(path.edges[i]) != nodes[i] ||
+                graph.edge_target(path.edges[i]) != nodes[i + 1]) {
+              fmt::print(stderr, "Indexed path edges are not connected\n");
+              return false;
+            }
+          }
+
+          if (!graph.load_edges(path, edges) || edges.size() != path.edges.size()) {
+            fmt::print(stderr, "Failed to load indexed edges for {} to {}\n", from, to);
+            return false;
+          }
+          if (expected->size() < 2) { continue; }
+          auto expected_edges = graph.load_edges(*expected);
+          if (!expected_edges.has_value() || *expected_edges != edges) {
+            fmt::print(stderr, "Indexed edges differ for {} to {}\n", from, to);
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool trace_with_edges_tests() {
+
+  for(auto cache : {true, false}) {
+    for(auto graph_fn : {
+        graph_one,
+        graph_two,
+        graph_three,
+        graph_four,
+        graph_five,
+        graph_six,
+        graph_seven
+        }) {
+
+      auto graph_data = graph_fn();
+      test_graph_t graph(cache);
+      test_graph_t reference(false);
+      if (!graph.build_from(graph_data.data) || !reference.build_from(graph_data.data)) {
+        fmt::print(stderr, "Failed to build graph\n");
+        return false;
+      }
+      auto& nodes = graph_data.data.nodes;
+
+      auto all_pairs_match = [&]() {
+        for(auto& from : nodes) {
+          for(auto& to : nodes) {
+            auto expected = reference.trace(from, to);
+            auto result = graph.trace_with_edges(from, to);
+            if (expected.has_value() != result.has_value()) {
+              fmt::print(stderr, "trace_with_edges disagrees for {} to {}\n", from, to);
+              return false;
+            }
+            if (!result.has_value()) { continue; }
+            if (result->nodes.size() != expected->size() ||
+                result->edges.size() + 1 != result->nodes.size() ||
+                *result->nodes.front()->data() != from ||
+                *result->nodes.back()->data() != to) {
+              fmt::print(stderr, "trace_with_edges returned a wrong path for {} to {}\n", from, to);
+              return false;
+            }
+            // Each edge must be the one joining its two nodes
+            for(std::size_t i = 0; i < result->edges.size(); i++) {
+              auto edge = graph.load_edges(std::span(result->nodes).subspan(i, 2));
+              if (!edge.has_value() || edge->front() != result->edges[i]) {
+                fmt::print(stderr, "trace_with_edges returned a wrong edge for {} to {}\n", from, to);
+                return false;
+              }
+            }
+          }
+        }
+        return true;
+      };
+
+      // Twice so the second pass is served from the cache
+      if (!all_pairs_match() || !all_pairs_match()) { return false; }
+
+      for(std::size_t i = 0; i < nodes.size(); i++) {
+        auto& from = nodes[i];
+        auto& to = nodes[(i * 5 + 1) % nodes.size()];
+        graph.add_edge(from, to, "shortcut");
+        reference.add_edge(from, to, "shortcut");
+        if (!all_pairs_match()) { return false; }
+      }
+    }
+  }
+  return true;
+}
+
+bool weighted_tests() {
+
+  // The fewest-hop route A->B is the most expensive one
+  {
+    cost_graph_t graph(false);
+    for(auto id : {"A", "B", "C", "D"}) {
+      graph.add_node(id);
+    }
+    graph.add_edge("A", "B", 10);
+    graph.add_edge("A", "C", 1);
+    graph.add_edge("C", "D", 1);
+    graph.add_edge("D", "B", 1);
+
+    auto result = graph.trace_weighted("A", "B", [](const int& cost) { return cost; });
+    if (!result.has_value() || result->cost != 3 || result->nodes.size() != 4) {
+      fmt::print(stderr, "Expected the 3 hop route of cost 3\n");
+      return false;
+    }
+    if (graph.trace_weighted("B", "A", [](const int& cost) { return cost; }).has_value()) {
+      fmt::print(stderr, "Expected no weighted path from B to A\n");
+      return false;
+    }
+  }
+
+  // Random graph checked against Floyd-Warshall
+  const std::size_t count = 40;
+  constexpr int INF = std::numeric_limits<int>::max() / 4;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+  std::uniform_int_distribution<int> weight(1, 20);
+
+  cost_graph_t graph(true);
+  std::vector<std::string> ids;
+  std::vector<std::vector<int>> dist(count, std::vector<int>(count, INF));
+  for(std::size_t i = 0; i < count; i++) {
+    ids.push_back(std::to_string(i));
+    graph.add_node(ids.back());
+    dist[i][i] = 0;
+  }
+  auto add_edge = [&](std::size_t a, std::size_t b, int w) {
+    if (graph.add_edge(ids[a], ids[b], w)) {
+      dist[a][b] = std::min(dist[a][b], w);
+    }
+  };
+  for(std::size_t e = 0; e < count * 3; e++) {
+    add_edge(pick(rng), pick(rng), weight(rng));
+  }
+
+  auto solve = [&]() {
+    auto all = dist;
+    for(std::size_t k = 0; k < count; k++) {
+      for(std::size_t i = 0; i < count; i++) {
+        for(std::size_t j = 0; j < count; j++) {
+          all[i][j] = std::min(all[i][j], all[i][k] + all[k][j]);
+        }
+      }
+    }
+    return all;
+  };
+
+  auto cost_of = [](const int& cost) { return cost; };
+  graph.set_edge_cost([](const int& cost) { return static_cast<double>(cost); });
+
+  auto check = [&]() {
+    auto all = solve();
+    auto frozen = graph.freeze();
+    cost_graph_t::frozen_t::path_t frozen_path;
+    for(std::size_t a = 0; a < count; a++) {
+      for(std::size_t b = 0; b < count; b++) {
+        const bool reachable = all[a][b] < INF;
+        auto exact = [&](const std::string& id) { return all[std::stoul(id)][b]; };
+
+        auto dijkstra = graph.trace_weighted(ids[a], ids[b], cost_of);
+        auto astar = graph.trace_weighted(ids[a], ids[b], cost_of, exact);
+        auto cached = graph.trace_weighted(ids[a], ids[b]);
+        auto snapshot = frozen.trace_weighted(
+          *frozen.index_of(ids[a]), *frozen.index_of(ids[b]), cost_of, frozen_path);
+
+        if (dijkstra.has_value() != reachable || astar.has_value() != reachable ||
+            cached.has_value() != reachable || snapshot.has_value() != reachable) {
+          fmt::print(stderr, "Weighted reachability wrong for {} to {}\n", a, b);
+          return false;
+        }
+        if (!reachable) { continue; }
+        if (dijkstra->cost != all[a][b] || astar->cost != all[a][b] ||
+            cached->cost != all[a][b] || *snapshot != all[a][b]) {
+          fmt::print(stderr, "Weighted cost wrong for {} to {}\n", a, b);
+          return false;
+        }
+
+        int total{0};
+        for(auto* edge : dijkstra->edges) {
+          total += *edge;
+        }
+        if (total != dijkstra->cost || *dijkstra->nodes.front()->data() != ids[a] ||
+            *dijkstra->nodes.back()->data() != ids[b]) {
+          fmt::print(stderr, "Weighted path does not add up for {} to {}\n", a, b);
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  // Twice so the cached form is served from the cache, then after edges
+  // that can make cached paths cheaper
+  if (!check() || !check()) { return false; }
+  for(std::size_t e = 0; e < 10; e++) {
+    add_edge(pick(rng), pick(rng), 1);
+    if (!check()) { return false; }
+  }
+  return true;
+}
+
+bool mapped_graph_tests() {
+
+  const temp_file_c temp("yokel_mapped_test", ".graph");
+  const auto& path = temp.path();
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    // Edge data must be trivially copyable, so number the edges
+    auto graph_data = graph_fn();
+    cost_graph_t graph(false);
+    for(auto& node : graph_data.data.nodes) {
+      graph.add_node(node);
+    }
+    int cost{1};
+    for(auto& edge : graph_data.data.edges) {
+      graph.add_edge(edge.from, edge.to, cost++);
+    }
+
+    if (!yokel::write_graph_file(graph, path)) {
+      fmt::print(stderr, "Failed to write graph file\n");
+      return false;
+    }
+    auto mapped = yokel::mapped_graph_c<std::string, int>::open(path);
+    if (!mapped.has_value() || !mapped->verify()) {
+      fmt::print(stderr, "Failed to map graph file\n");
+      return false;
+    }
+
+    auto frozen = graph.freeze();
+    if (mapped->node_count() != frozen.node_count() || mapped->edge_count() != frozen.edge_count()) {
+      fmt::print(stderr, "Mapped graph has the wrong size\n");
+      return false;
+    }
+
+    cost_graph_t::frozen_t::path_t expected;
+    cost_graph_t::frozen_t::path_t result;
+    cost_graph_t::frozen_t::edge_list_t expected_edges;
+    cost_graph_t::frozen_t::edge_list_t result_edges;
+    auto cost_of = [](const int& cost) { return cost; };
+    for(auto& from : graph_data.data.nodes) {
+      for(auto& to : graph_data.data.nodes) {
+        if (frozen.trace(from, to, expected) != mapped->trace(from, to, result) || expected != result) {
+          fmt::print(stderr, "Mapped trace differs for {} to {}\n", from, to);
+          return false;
+        }
+        if (!expected.empty() && (
+            frozen.load_edges(expected, expected_edges) != mapped->load_edges(result, result_edges) ||
+            !std::equal(expected_edges.begin(), expected_edges.end(), result_edges.begin(), result_edges.end(),
+              [](const int* a, const int* b) { return *a == *b; }))) {
+          fmt::print(stderr, "Mapped edges differ for {} to {}\n", from, to);
+          return false;
+        }
+        auto a = frozen.trace_weighted(*frozen.index_of(from), *frozen.index_of(to), cost_of, expected);
+        auto b = mapped->trace_weighted(*mapped->index_of(from), *mapped->index_of(to), cost_of, result);
+        if (a != b || expected != result) {
+          fmt::print(stderr, "Mapped weighted trace differs for {} to {}\n", from, to);
+          return false;
+        }
+      }
+    }
+    if (mapped->index_of("missing").has_value()) {
+      fmt::print(stderr, "Found a node that is not in the file\n");
+      return false;
+    }
+  }
+
+  // 32 bit ids are the same type as indices, and stay apart from them
+  {
+    yokel::graph_c<std::uint32_t, int> graph(false);
+    for(std::uint32_t id : {30, 10, 20}) {
+      graph.add_node(id);
+    }
+    graph.add_edge(10, 20, 1);
+    graph.add_edge(20, 30, 2);
+    yokel::mapped_graph_c<std::uint32_t, int>::path_t narrow_path;
+    auto mapped = (yokel::write_graph_file(graph, path)) ?
+      yokel::mapped_graph_c<std::uint32_t, int>::open(path) : std::nullopt;
+    if (!mapped.has_value() || !mapped->trace(10, 30, narrow_path) || narrow_path.size() != 3 ||
+        !mapped->trace_index(0, 2, narrow_path) || narrow_path.size() != 3 || mapped->trace(0, 2, narrow_path)) {
+      fmt::print(stderr, "Mapped 32 bit identifiers were mixed up with indices\n");
+      return false;
+    }
+  }
+
+  // Integer ids are stored as a plain array
+  {
+    yokel::graph_c<std::uint64_t, double> graph(false);
+    for(std::uint64_t i = 0; i < 100; i++) {
+      graph.add_node(i * 7);
+    }
+    for(std::uint64_t i = 0; i < 100; i++) {
+      graph.add_edge(i * 7, ((i * 13 + 5) % 100) * 7, 0.5 * static_cast<double>(i));
+    }
+    // Node 0 gets a second target, to have a node whose targets have an order
+    graph.add_edge(0, 2 * 7, 1.0);
+    if (!yokel::write_graph_file(graph, path)) {
+      fmt::print(stderr, "Failed to write graph file\n");
+      return false;
+    }
+    auto mapped = yokel::mapped_graph_c<std::uint64_t, double>::open(path);
+    if (!mapped.has_value() || mapped->node_count() != 100 || mapped->id_of(3) != 21) {
+      fmt::print(stderr, "Failed to map integer graph\n");
+      return false;
+    }
+    for(std::uint64_t i = 0; i < 100; i++) {
+      auto path_nodes = graph.trace(0, i * 7);
+      yokel::mapped_graph_c<std::uint64_t, double>::path_t mapped_path;
+      if (path_nodes.has_value() != mapped->trace(0, i * 7, mapped_path) ||
+          (path_nodes.has_value() && path_nodes->size() != mapped_path.size())) {
+        fmt::print(stderr, "Mapped integer trace differs\n");
+        return false;
+      }
+    }
+    // Written for other types
+    if (yokel::mapped_graph_c<std::uint64_t, float>::open(path).has_value() ||
+        yokel::mapped_graph_c<std::string, double>::open(path).has_value()) {
+      fmt::print(stderr, "Opened a graph file written for other types\n");
+      return false;
+    }
+  }
+
+  // Damage to edge data is caught by verify, truncation by open. Every
+  // other patch is undone by copying the written file back
+  const temp_file_c pristine("yokel_mapped_test", ".pristine");
+  std::filesystem::copy_file(path, pristine.path(), std::filesystem::copy_options::overwrite_existing);
+  auto restore = [&]() {
+    std::filesystem::copy_file(pristine.path(), path, std::filesystem::copy_options::overwrite_existing);
+  };
+  yokel::graph_file_header_s header{};
+  auto patch = [&](const std::uint64_t& at, const void* bytes, const std::size_t& size) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    file.seekp(static_cast<std::streamoff>(at));
+    file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+  };
+  patch(0, nullptr, 0);
+  const auto original = header;
+  const char flipped = '\x7f';
+  patch(original.edges_at + 3, &flipped, 1);
+  auto damaged = yokel::mapped_graph_c<std::uint64_t, double>::open(path);
+  if (!damaged.has_value() || damaged->verify()) {
+    fmt::print(stderr, "Damaged graph file passed verification\n");
+    return false;
+  }
+  damaged.reset();
+  restore();
+
+  // Offsets, targets and counts that would index out of the file, and
+  // targets or ids out of the order lookups bisect, are refused by open
+  // before any search can use them
+  auto refused = [&](const std::uint64_t& at, const void* bytes, const std::size_t& size) {
+    patch(at, bytes, size);
+    const bool opened = yokel::mapped_graph_c<std::uint64_t, double>::open(path).has_value();
+    restore();
+    return !opened;
+  };
+  const std::uint32_t past_end = 100;
+  const std::uint32_t falling = 99;
+  const std::uint32_t unsorted_targets[2] = {5, 2};
+  const std::uint64_t unsorted_ids[2] = {7, 0};
+  const std::uint64_t duplicate_ids[2] = {0, 0};
+  auto wrapping = original;
+  wrapping.edge_count = (std::uint64_t{1} << 62) + 1;
+  if (!refused(original.targets_at + 4 * sizeof(std::uint32_t), &past_end, sizeof(past_end)) ||
+      !refused(original.offsets_at + sizeof(std::uint32_t), &falling, sizeof(falling)) ||
+      !refused(0, &wrapping, sizeof(wrapping))) {
+    fmt::print(stderr, "Opened a graph file indexing out of bounds\n");
+    return false;
+  }
+  if (!refused(original.targets_at, unsorted_targets, sizeof(unsorted_targets)) ||
+      !refused(original.ids_at, unsorted_ids, sizeof(unsorted_ids)) ||
+      !refused(original.ids_at, duplicate_ids, sizeof(duplicate_ids))) {
+    fmt::print(stderr, "Opened a graph file with targets or ids out of order\n");
+    return false;
+  }
+  if (!yokel::mapped_graph_c<std::uint64_t, double>::open(path).has_value()) {
+    fmt::print(stderr, "Failed to map a restored graph file\n");
+    return false;
+  }
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  if (yokel::mapped_graph_c<std::uint64_t, double>::open(path).has_value() ||
+      yokel::mapped_graph_c<std::uint64_t, double>::open(path + ".missing").has_value()) {
+    fmt::print(stderr, "Opened a truncated graph file\n");
+    return false;
+  }
+  return true;
+}
+
+// Data on the edge from->to, looked up through a frozen copy
+const std::string* streamed_edge(const yokel::frozen_graph_c<std::string, std::string>& frozen,
+    const std::string& from, const std::string& to) {
+  auto a = frozen.index_of(from);
+  auto b = frozen.index_of(to);
+  if (!a || !b) { return nullptr; }
+  return frozen.get_edge(*a, *b);
+}
+
+bool stream_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    auto& source = graph_data.data;
+    test_graph_t expected(false);
+    if (!expected.build_from(source)) {
+      fmt::print(stderr, "Failed to build graph\n");
+      return false;
+    }
+
+    // Edges ahead of their nodes, every edge and node twice
+    test_graph_t graph(false);
+    const bool streamed = graph.stream_from(source.nodes.size(), source.edges.size(), [&](auto& builder) {
+      for(auto& edge : source.edges) {
+        builder.add_edge(edge.from, edge.to, edge.data);
+      }
+      for(auto& edge : source.edges) {
+        builder.add_edge(edge.from, edge.to, "repeat");
+      }
+      for(auto& node : source.nodes) {
+        builder.add_node(node);
+        builder.add_node(node);
+      }
+    });
+    if (!streamed || graph.freeze().edge_count() != source.edges.size()) {
+      fmt::print(stderr, "Failed to stream graph\n");
+      return false;
+    }
+
+    auto frozen = graph.freeze();
+    for(auto& edge : source.edges) {
+      auto* data = streamed_edge(frozen, edge.from, edge.to);
+      if (!data || *data != edge.data) {
+        fmt::print(stderr, "Streamed edge {} to {} lost its data\n", edge.from, edge.to);
+        return false;
+      }
+    }
+    for(auto& from : source.nodes) {
+      for(auto& to : source.nodes) {
+        auto a = expected.trace(from, to);
+        auto b = graph.trace(from, to);
+        if (a.has_value() != b.has_value()) {
+          fmt::print(stderr, "Streamed trace differs for {} to {}\n", from, to);
+          return false;
+        }
+        if (!a) { continue; }
+        if (!std::equal(a->begin(), a->end(), b->begin(), b->end(),
+              [](auto* x, auto* y) { return *x->data() == *y->data(); })) {
+          fmt::print(stderr, "Streamed path differs for {} to {}\n", from, to);
+          return false;
+        }
+      }
+    }
+  }
+
+  // An edge to a node that never arrives keeps none of the edges
+  test_graph_t graph(false);
+  graph.add_node("a");
+  graph.add_node("b");
+  graph.add_edge("a", "b", "ab");
+  {
+    auto builder = graph.stream();
+    builder.add_node("c");
+    builder.add_edge("b", "c", "bc");
+    builder.add_edge("c", "missing", "cm");
+    if (builder.finish()) {
+      fmt::print(stderr, "Streamed an edge to a missing node\n");
+      return false;
+    }
+  }
+  if (graph.freeze().edge_count() != 1 || streamed_edge(graph.freeze(), "b", "c") || !graph.trace("a", "b")) {
+    fmt::print(stderr, "Failed stream changed the edges\n");
+    return false;
+  }
+
+  // Abandoned builders leave the graph as it was, existing edges win
+  {
+    auto builder = graph.stream();
+    builder.add_edge("b", "c", "bc");
+  }
+  {
+    auto builder = graph.stream();
+    builder.add_edge("a", "b", "again");
+    builder.add_edge("b", "c", "bc");
+    if (!builder.finish()) {
+      fmt::print(stderr, "Failed to stream into a graph\n");
+      return false;
+    }
+  }
+  if (graph.freeze().edge_count() != 2 || *streamed_edge(graph.freeze(), "a", "b") != "ab" || !graph.trace("a", "c")) {
+    fmt::print(stderr, "Streamed edges were not merged\n");
+    return false;
+  }
+  return true;
+}
+
+// Counts what a graph allocates through it
+class counting_resource_c : public std::pmr::memory_resource {
+public:
+  std::size_t allocations{0};
+  std::size_t live{0};
+
+private:
+  void* do_allocate(std::size_t size, std::size_t alignment) override {
+    allocations++;
+    live += size;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+  }
+  void do_deallocate(void* p, std::size_t size, std::size_t alignment) override {
+    live -= size;
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+bool cache_file_tests() {
+  const temp_file_c temp("yokel_cache_test", ".paths");
+  const auto& path = temp.path();
+
+  std::mt19937 rng(404);
+  const std::size_t count = 2000;
+  std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+  test_data_t source;
+  for(std::size_t n = 0; n < count; n++) {
+    source.nodes.push_back(std::to_string(n));
+  }
+  std::set<std::pair<std::size_t, std::size_t>> pairs;
+  while (pairs.size() < count * 3) {
+    pairs.insert({pick(rng), pick(rng)});
+  }
+  for(auto& [a, b] : pairs) {
+    source.edges.push_back({std::to_string(a), std::to_string(b), ""});
+  }
+
+  test_graph_t graph;
+  graph.build_from(source);
+  std::vector<std::pair<std::string, std::string>> queries;
+  std::vector<std::size_t> lengths;
+  for(std::size_t q = 0; q < 200; q++) {
+    queries.emplace_back(std::to_string(pick(rng)), std::to_string(pick(rng)));
+    auto traced = graph.trace(queries.back().first, queries.back().second);
+    lengths.push_back((traced) ? traced->size() : 0);
+  }
+  graph.optimize_trace();
+  const auto cached = graph.cache_stats().entries;
+  if (!graph.save_cache(path)) {
+    fmt::print(stderr, "Failed to save the path cache\n");
+    return false;
+  }
+
+  // The same nodes and edges in another order, on another storage policy
+  auto shuffled = source;
+  std::shuffle(shuffled.nodes.begin(), shuffled.nodes.end(), rng);
+  std::shuffle(shuffled.edges.begin(), shuffled.edges.end(), rng);
+  flat_test_graph_t restored;
+  restored.build_from(shuffled);
+  if (restored.content_hash() != graph.content_hash()) {
+    fmt::print(stderr, "Equal graphs hashed differently\n");
+    return false;
+  }
+  if (!restored.load_cache(path) || restored.cache_stats().entries != cached) {
+    fmt::print(stderr, "Restored {} of {} cached paths\n", restored.cache_stats().entries, cached);
+    return false;
+  }
+
+  // Every query is now a hit, on a path as short as the original
+  for(std::size_t q = 0; q < queries.size(); q++) {
+    auto traced = restored.trace(queries[q].first, queries[q].second);
+    auto edges = (traced) ? restored.load_edges(*traced) : std::nullopt;
+    if (((traced) ? traced->size() : 0) != lengths[q] || (traced && !edges) ||
+        (traced && (*(*traced).front()->data() != queries[q].first ||
+                    *(*traced).back()->data() != queries[q].second))) {
+      fmt::print(stderr, "Restored path from {} to {} is wrong\n", queries[q].first, queries[q].second);
+      return false;
+    }
+  }
+  const auto found = std::count_if(lengths.begin(), lengths.end(), [](auto& l) { return l != 0; });
+  if (restored.cache_stats().hits != static_cast<std::uint64_t>(found)) {
+    fmt::print(stderr, "Restored cache served {} of {} paths\n", restored.cache_stats().hits, found);
+    return false;
+  }
+
+  // Bounded dumps keep only the first max_paths
+  if (!graph.save_cache(path, 10)) { return false; }
+  test_graph_t bounded;
+  bounded.build_from(source);
+  if (!bounded.load_cache(path) || bounded.cache_stats().entries != 10) {
+    fmt::print(stderr, "Bounded dump restored {} paths\n", bounded.cache_stats().entries);
+    return false;
+  }
+
+  // Another graph, a corrupt file, or a disabled cache restore nothing
+  test_graph_t changed;
+  changed.build_from(source);
+  changed.add_node("extra");
+  test_graph_t disabled(false);
+  disabled.build_from(source);
+  if (changed.content_hash() == graph.content_hash() || changed.load_cache(path) ||
+      disabled.load_cache(path) || changed.cache_stats().entries != 0) {
+    fmt::print(stderr, "A cache file was loaded into the wrong graph\n");
+    return false;
+  }
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-3, std::ios::end);
+    file.put('\x7f');
+  }
+  test_graph_t corrupt;
+  corrupt.build_from(source);
+  if (corrupt.load_cache(path) || corrupt.cache_stats().entries != 0) {
+    fmt::print(stderr, "A corrupt cache file was loaded\n");
+    return false;
+  }
+
+  // Fixed size identifiers are stored as they are
+  using wide_graph_t = yokel::graph_c<std::uint64_t, int>;
+  wide_graph_t wide;
+  wide_graph_t wide_restored;
+  for(std::uint64_t n = 0; n < 50; n++) {
+    wide.add_node(n * 1000003);
+    wide_restored.add_node(n * 1000003);
+  }
+  for(std::uint64_t n = 0; n + 1 < 50; n++) {
+    wide.add_edge(n * 1000003, (n + 1) * 1000003, 0);
+    wide_restored.add_edge(n * 1000003, (n + 1) * 1000003, 0);
+  }
+  wide.trace(0, 49 * 1000003);
+  if (!wide.save_cache(path) || !wide_restored.load_cache(path) ||
+      wide_restored.cache_stats().entries != 1 || wide_restored.trace(0, 49 * 1000003)->size() != 50 ||
+      wide_restored.cache_stats().hits != 1) {
+    fmt::print(stderr, "Integral identifiers did not round trip\n");
+    return false;
+  }
+
+  // A file in another layout version is refused
+  {
+    const std::uint32_t version = yokel::cache_file_header_s::VERSION + 1;
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(yokel::cache_file_header_s, version));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+  wide_graph_t versioned;
+  for(std::uint64_t n = 0; n < 50; n++) {
+    versioned.add_node(n * 1000003);
+  }
+  for(std::uint64_t n = 0; n + 1 < 50; n++) {
+    versioned.add_edge(n * 1000003, (n + 1) * 1000003, 0);
+  }
+  if (versioned.content_hash() != wide.content_hash() || versioned.load_cache(path)) {
+    fmt::print(stderr, "A cache file of another version was loaded\n");
+    return false;
+  }
+  return true;
+}
+
+bool allocator_tests() {
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    test_graph_t expected(false);
+    expected.build_from(graph_data.data);
+
+    counting_resource_c counter;
+    std::pmr::monotonic_buffer_resource bump(&counter);
+    {
+      test_graph_t graph(&bump, false);
+      if (!graph.build_from(graph_data.data) || graph.resource() != &bump) {
+        fmt::print(stderr, "Failed to build graph on a memory resource\n");
+        return false;
+      }
+      if (!graph_data.data.edges.empty() && counter.allocations == 0) {
+        fmt::print(stderr, "Graph did not allocate from its memory resource\n");
+        return false;
+      }
+      for(auto& from : graph_data.data.nodes) {
+        for(auto& to : graph_data.data.nodes) {
+          auto a = expected.trace(from, to);
+          auto b = graph.trace(from, to);
+          if (a.has_value() != b.has_value() || (a && a->size() != b->size())) {
+            fmt::print(stderr, "Trace differs on a memory resource for {} to {}\n", from, to);
+            return false;
+          }
+        }
+      }
+    }
+    bump.release();
+    if (counter.live != 0) {
+      fmt::print(stderr, "Memory resource still holds {} bytes\n", counter.live);
+      return false;
+    }
+  }
+
+  // The scratch arena grows to fit an operation, then stops growing
+  test_graph_t graph(false);
+  for(int i = 0; i < 2000; i++) {
+    graph.add_node(std::to_string(i));
+  }
+  for(int i = 0; i < 2000; i++) {
+    graph.add_edge(std::to_string(i), std::to_string((i * 7 + 1) % 2000), "");
+  }
+  auto& arena = yokel::scratch_arena_c::local();
+  graph.strongly_connected_components();
+  const auto grown = arena.capacity();
+  graph.add_node("extra");
+  graph.strongly_connected_components();
+  graph.add_node("another");
+  graph.strongly_connected_components();
+  if (grown <= yokel::scratch_arena_c::INITIAL_BYTES || arena.capacity() != grown) {
+    fmt::print(stderr, "Scratch arena did not settle ({} then {})\n", grown, arena.capacity());
+    return false;
+  }
+  return true;
+}
+
+// Every pair traced by a graph under test has the same hop count as in
+// a graph freshly built from the same nodes and edges
+template<class GRAPH>
+bool same_distances(GRAPH& graph, const test_data_t& source, const std::string& what) {
+  test_graph_t expected(false);
+  if (!expected.build_from(source)) {
+    fmt::print(stderr, "Failed to build reference graph\n");
+    return false;
+  }
+  if (graph.node_count() != source.nodes.size() || graph.edge_count() != source.edges.size()) {
+    fmt::print(stderr, "Wrong counts after {}\n", what);
+    return false;
+  }
+  for(auto& from : source.nodes) {
+    for(auto& to : source.nodes) {
+      auto a = expected.trace(from, to);
+      auto b = graph.trace(from, to);
+      auto c = graph.trace_with_edges(from, to);
+      auto d = graph.trace_weighted(from, to);
+      if (a.has_value() != b.has_value() || a.has_value() != c.has_value() || a.has_value() != d.has_value() ||
+          (a && (a->size() != b->size() || a->size() != c->nodes.size() || a->size() != d->nodes.size()))) {
+        fmt::print(stderr, "Trace from {} to {} differs after {}\n", from, to, what);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool removal_tests() {
+
+  // Keys shift back over erased ones without breaking any probe run
+  {
+    yokel::edge_index_c index;
+    std::map<std::uint64_t, std::uint32_t> expected;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<std::uint32_t> node(0, 60);
+    for(std::uint32_t i = 0; i < 4000; i++) {
+      const auto key = yokel::edge_index_c::make_key(node(rng), node(rng));
+      if (rng() % 3 == 0) {
+        if (index.erase(key) != (expected.erase(key) == 1)) {
+          fmt::print(stderr, "Edge index erase disagrees\n");
+          return false;
+        }
+      } else if (index.insert(key, i) == expected.emplace(key, i).second) {
+        continue;
+      } else {
+        fmt::print(stderr, "Edge index insert disagrees\n");
+        return false;
+      }
+    }
+    for(auto& [key, value] : expected) {
+      auto* found = index.find(key);
+      if (!found || *found != value || index.size() != expected.size()) {
+        fmt::print(stderr, "Edge index lost a key\n");
+        return false;
+      }
+    }
+  }
+
+  for(auto graph_fn : {
+      graph_one,
+      graph_two,
+      graph_three,
+      graph_four,
+      graph_five,
+      graph_six,
+      graph_seven
+      }) {
+
+    auto graph_data = graph_fn();
+    auto source = graph_data.data;
+
+    // Cached paths are warmed first so removal has to drop the right ones
+    test_graph_t graph;
+    flat_test_graph_t flat;
+    graph.build_from(source);
+    flat.build_from(source);
+    if (!same_distances(graph, source, "building") || !same_distances(flat, source, "building")) {
+      return false;
+    }
+
+    std::mt19937 rng(static_cast<std::uint32_t>(source.edges.size()));
+    while (source.edges.size() > source.edges.size() / 2) {
+      const auto victim = rng() % source.edges.size();
+      auto edge = source.edges[victim];
+      source.edges.erase(source.edges.begin() + static_cast<std::ptrdiff_t>(victim));
+      if (!graph.remove_edge(edge.from, edge.to) || !flat.remove_edge(edge.from, edge.to) ||
+          graph.remove_edge(edge.from, edge.to)) {
+        fmt::print(stderr, "Failed to remove edge {} to {}\n", edge.from, edge.to);
+        return false;
+      }
+      if (!same_distances(graph, source, "removing an edge") || !same_distances(flat, source, "removing an edge")) {
+        return false;
+      }
+    }
+
+    // A node takes its edges with it, and may come back without them
+    const auto node = source.nodes[rng() % source.nodes.size()];
+    std::erase(source.nodes, node);
+    std::erase_if(source.edges, [&node](const auto& edge) { return edge.from == node || edge.to == node; });
+    if (!graph.remove_node(node) || !flat.remove_node(node) || graph.remove_node(node)) {
+      fmt::print(stderr, "Failed to remove node {}\n", node);
+      return false;
+    }
+    if (graph.trace(node, node) || graph.component_of(node) ||
+        !same_distances(graph, source, "removing a node") || !same_distances(flat, source, "removing a node")) {
+      return false;
+    }
+    if (graph.freeze().node_count() != source.nodes.size() ||
+        graph.strongly_connected_components().nodes.size() != source.nodes.size()) {
+      fmt::print(stderr, "Removed node was frozen or placed in a component\n");
+      return false;
+    }
+
+    auto* kept = graph.trace(source.nodes.front(), source.nodes.front())->front();
+    graph.add_node(node);
+    flat.add_node(node);
+    source.nodes.push_back(node);
+    if (kept != graph.trace(source.nodes.front(), source.nodes.front())->front() ||
+        !same_distances(graph, source, "adding a node back") || !same_distances(flat, source, "adding a node back")) {
+      fmt::print(stderr, "Adding back {} disturbed the graph\n", node);
+      return false;
+    }
+
+    graph.compact();
+    flat.compact();
+    if (!same_distances(graph, source, "compacting") || !same_distances(flat, source, "compacting")) {
+      return false;
+    }
+    for(auto& edge : source.edges) {
+      auto path = graph.trace_with_edges(edge.from, edge.to);
+      if (edge.from != edge.to && (!path || path->edges.size() != 1 || *path->edges.front() != edge.data)) {
+        fmt::print(stderr, "Compacting lost the data of {} to {}\n", edge.from, edge.to);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Edge data that counts how often it is copied
+struct copy_counted_s {
+  static inline std::size_t copies{0};
+
+  std::string label;
+  int weight{0};
+
+  copy_counted_s() = default;
+  copy_counted_s(std::string label, int weight) : label(std::move(label)), weight(weight) {}
+  copy_counted_s(const copy_counted_s& o) : label(o.label), weight(o.weight) { copies++; }
+  copy_counted_s(copy_counted_s&&) = default;
+  copy_counted_s& operator=(const copy_counted_s& o) {
+    label = o.label;
+    weight = o.weight;
+    copies++;
+    return *this;
+  }
+  copy_counted_s& operator=(copy_counted_s&&) = default;
+};
+
+bool move_tests() {
+  using counted_graph_t = yokel::graph_c<std::string, copy_counted_s>;
+
+  // Long enough to live on the heap, so a moved-from id is visibly empty
+  auto id = [](int i) { return fmt::format("a node identifier long enough to allocate {}", i); };
+
+  counted_graph_t::source_s source;
+  for(int i = 0; i < 50; i++) {
+    source.nodes.push_back(id(i));
+  }
+  for(int i = 0; i < 50; i++) {
+    source.edges.push_back({id(i), id((i * 3 + 1) % 50), copy_counted_s(fmt::format("edge {}", i), i)});
+  }
+
+  copy_counted_s::copies = 0;
+  counted_graph_t copied(false);
+  copied.build_from(source);
+  if (copy_counted_s::copies != source.edges.size()) {
+    fmt::print(stderr, "Building from an lvalue made {} copies\n", copy_counted_s::copies);
+    return false;
+  }
+
+  copy_counted_s::copies = 0;
+  counted_graph_t graph(false);
+  if (!graph.build_from(std::move(source)) || copy_counted_s::copies != 0) {
+    fmt::print(stderr, "Building from an rvalue made {} copies\n", copy_counted_s::copies);
+    return false;
+  }
+  if (!source.nodes.front().empty() || !source.edges.front().data.label.empty()) {
+    fmt::print(stderr, "Building from an rvalue did not consume the source\n");
+    return false;
+  }
+
+  auto extra = id(50);
+  if (!graph.add_node(std::move(extra)) || !extra.empty() || !graph.add_node(id(51))) {
+    fmt::print(stderr, "Failed to move a node in\n");
+    return false;
+  }
+  copy_counted_s moved("moved", 7);
+  if (!graph.add_edge(id(50), id(0), std::move(moved)) ||
+      !graph.emplace_edge(id(51), id(50), "emplaced", 9) ||
+      graph.emplace_edge(id(51), id(50), "repeat", 10) ||
+      copy_counted_s::copies != 0) {
+    fmt::print(stderr, "Edges were copied in ({} copies)\n", copy_counted_s::copies);
+    return false;
+  }
+
+  // Streaming moves too
+  counted_graph_t streamed(false);
+  streamed.stream_from(2, 2, [&](auto& builder) {
+    builder.emplace_edge("x", "y", "x to y", 1);
+    builder.add_edge("y", "x", copy_counted_s("y to x", 2));
+    builder.add_node(std::string("x"));
+    builder.add_node(std::string("y"));
+  });
+  if (copy_counted_s::copies != 0 || streamed.edge_count() != 2) {
+    fmt::print(stderr, "Streaming copied edges ({} copies)\n", copy_counted_s::copies);
+    return false;
+  }
+
+  auto path = graph.trace_with_edges(id(51), id(0));
+  if (!path || path->edges.size() != 2 ||
+      path->edges[0]->label != "emplaced" || path->edges[1]->weight != 7 ||
+      *path->nodes.back()->data() != id(0)) {
+    fmt::print(stderr, "Moved nodes and edges were not found\n");
+    return false;
+  }
+  return true;
+}
+
+// A graph built in a function and returned by value
+test_graph_t chain_graph(const std::size_t& length) {
+  test_graph_t graph;
+  for(std::size_t n = 0; n < length; n++) {
+    graph.add_node(std::to_string(n));
+  }
+  for(std::size_t n = 0; n + 1 < length; n++) {
+    graph.add_edge(std::to_string(n), std::to_string(n + 1), fmt::format("{} to {}", n, n + 1));
+  }
+  return graph;
+}
+
+bool graph_move_tests() {
+  auto source = chain_graph(10);
+  auto view = source.trace_view("0", "9");
+  const auto edges = (view) ? source.load_edges(view->span()) : std::nullopt;
+  if (!view || view->size() != 10 || !edges) {
+    fmt::print(stderr, "Failed to trace the graph to move\n");
+    return false;
+  }
+
+  // Nodes, edges and cached paths follow the graph, and views into it
+  // stay valid
+  test_graph_t moved(std::move(source));
+  if (moved.node_count() != 10 || moved.edge_count() != 9 || moved.load_edges(view->span()) != edges ||
+      *(*view)[9]->data() != "9" || moved.trace("0", "9")->size() != 10 ||
+      moved.cache_stats().hits != 1) {
+    fmt::print(stderr, "A moved graph lost its nodes, edges or cache\n");
+    return false;
+  }
+
+  // The moved-from graph is empty and usable again
+  if (source.node_count() != 0 || source.edge_count() != 0 || source.cache_stats().entries != 0 ||
+      source.trace("0", "9").has_value()) {
+    fmt::print(stderr, "A moved-from graph was not left empty\n");
+    return false;
+  }
+  source.add_node("a");
+  source.add_node("b");
+  source.add_edge("a", "b", "a to b");
+  if (!source.trace("a", "b") || source.trace("a", "b")->size() != 2 || source.cache_stats().hits != 1) {
+    fmt::print(stderr, "A moved-from graph could not be reused\n");
+    return false;
+  }
+
+  // Assignment replaces the graph, and graphs can be kept in containers.
+  // Views must not outlive the cache they pin, so let go first
+  view.reset();
+  moved = chain_graph(3);
+  std::vector<test_graph_t> graphs;
+  for(std::size_t n = 2; n < 6; n++) {
+    graphs.push_back(chain_graph(n));
+  }
+  if (moved.node_count() != 3 || moved.trace("0", "9").has_value() || moved.trace("0", "2")->size() != 3 ||
+      graphs[3].trace("0", "4")->size() != 5 || !graphs[0].add_edge("1", "0", "back") ||
+      !graphs[0].contains_cycles()) {
+    fmt::print(stderr, "Assigned or stored graphs are wrong\n");
+    return false;
+  }
+  return true;
+}
+
+bool stats_tests() {
+  test_graph_t graph;
+  test_data_t source = {
+    {"a", "b", "c", "d", "lonely"},
+    {
+      {"a", "b", "a->b"},
+      {"b", "c", "b->c"},
+      {"c", "d", "c->d"},
+      {"a", "c", "a->c"},
+    }
+  };
+  if (!graph.build_from(source)) {
+    fmt::print(stderr, "Failed to build stats graph\n");
+    return false;
+  }
+
+  std::vector<yokel::trace_stats_s> seen;
+  graph.set_trace_hook([&](const yokel::trace_stats_s& query) { seen.push_back(query); });
+
+  graph.trace("a", "d");
+  graph.trace("a", "d");
+  graph.trace("a", "lonely");
+  test_graph_t::indexed_path_s indexed;
+  graph.trace_indexed("b", "d", indexed);
+
+  // Cache counters are kept whether or not the stats layer is built in
+  auto stats = graph.stats();
+  if (stats.cache_hits != 1 || stats.cache_misses != 2) {
+    fmt::print(stderr, "Stats saw {} cache hits, {} misses\n", stats.cache_hits, stats.cache_misses);
+    return false;
+  }
+
+#ifdef GRAPH_ENABLE_STATS
+  if (stats.traces != 4 || stats.found != 3 || seen.size() != 4) {
+    fmt::print(stderr, "Stats counted {} traces ({} found), hook saw {}\n",
+               stats.traces, stats.found, seen.size());
+    return false;
+  }
+  if (seen[0].cache_hit || !seen[0].found || seen[0].nodes_visited == 0 || seen[0].edges_scanned == 0 ||
+      !seen[1].cache_hit || seen[1].nodes_visited != 0 ||
+      seen[2].found || seen[3].kind != yokel::trace_kind_e::INDEXED) {
+    fmt::print(stderr, "The trace hook saw the wrong queries\n");
+    return false;
+  }
+  if (stats.nodes_visited != seen[0].nodes_visited + seen[2].nodes_visited + seen[3].nodes_visited) {
+    fmt::print(stderr, "Stats totals do not match the queries\n");
+    return false;
+  }
+#else
+  if (stats.traces != 0 || !seen.empty()) {
+    fmt::print(stderr, "Stats were kept without GRAPH_ENABLE_STATS\n");
+    return false;
+  }
+#endif
+
+  graph.reset_stats();
+  stats = graph.stats();
+  if (stats.traces != 0 || stats.cache_hits != 0 || stats.cache_misses != 0) {
+    fmt::print(stderr, "Stats were not reset\n");
+    return false;
+  }
+  return true;
+}
+
+template<class GRAPH>
+bool same_build(GRAPH& serial, GRAPH& parallel, const test_data_t& source, const std::string& what) {
+  if (serial.node_count() != parallel.node_count() || serial.edge_count() != parallel.edge_count()) {
+    fmt::print(stderr, "{}: parallel build kept {} edges, serial {}\n", what,
+               parallel.edge_count(), serial.edge_count());
+    return false;
+  }
+  // Identical adjacency order gives identical searches, down to the edge
+  // index of every hop
+  typename GRAPH::indexed_path_s a;
+  typename GRAPH::indexed_path_s b;
+  for(std::size_t i = 0; i < source.nodes.size(); i += 29) {
+    for(std::size_t j = 3; j < source.nodes.size(); j += 31) {
+      const bool found = serial.trace_indexed(source.nodes[i], source.nodes[j], a);
+      if (parallel.trace_indexed(source.nodes[i], source.nodes[j], b) != found ||
+          (found && (a.source != b.source || a.edges != b.edges))) {
+        fmt::print(stderr, "{}: parallel build traced {} to {} differently\n", what,
+                   source.nodes[i], source.nodes[j]);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool parallel_build_tests() {
+  yokel::thread_pool_c pool(4);
+
+  std::mt19937 rng(5150);
+  test_data_t source;
+  const std::size_t nodes = 400;
+  std::uniform_int_distribution<std::size_t> pick(0, nodes - 1);
+  for(std::size_t i = 0; i < nodes; i++) {
+    source.nodes.push_back(fmt::format("n{}", i));
+  }
+  std::set<std::pair<std::size_t, std::size_t>> used;
+  while (source.edges.size() < 3000) {
+    const auto from = pick(rng);
+    const auto to = pick(rng);
+    if (!used.insert({from, to}).second) { continue; }
+    source.edges.push_back({source.nodes[from], source.nodes[to], fmt::format("{}->{}", from, to)});
+  }
+
+  {
+    test_graph_t serial;
+    test_graph_t parallel;
+    if (!serial.build_from(source) || !parallel.build_from(source, pool) ||
+        !same_build(serial, parallel, source, "clean")) {
+      return false;
+    }
+    auto edges = parallel.load_edges(*parallel.trace("n0", "n399"));
+    auto expected = serial.load_edges(*serial.trace("n0", "n399"));
+    if (!edges || !expected || edges->size() != expected->size() ||
+        !std::equal(edges->begin(), edges->end(), expected->begin(),
+                    [](auto* x, auto* y) { return *x == *y; })) {
+      fmt::print(stderr, "Parallel build linked the wrong edge data\n");
+      return false;
+    }
+  }
+
+  // Repeated pairs, a missing node, and a pair the graph already has:
+  // the first of them stops both builds at the same edge
+  auto missing = source;
+  missing.edges[1700].to = "nowhere";
+  auto repeated = source;
+  repeated.edges[2900] = repeated.edges[1200];
+  repeated.edges[2100] = repeated.edges[15];
+  for(auto* bad : {&missing, &repeated}) {
+    test_graph_t serial;
+    test_graph_t parallel;
+    if (serial.build_from(*bad) || parallel.build_from(*bad, pool) ||
+        !same_build(serial, parallel, source, "bad edge")) {
+      fmt::print(stderr, "Parallel build did not fail like build_from\n");
+      return false;
+    }
+  }
+  {
+    test_data_t more = {{"extra"}, {{"extra", "n1", "new"}, {"n2", "extra", "new"}, source.edges[40]}};
+    test_graph_t serial;
+    test_graph_t parallel;
+    serial.build_from(source);
+    parallel.build_from(source, pool);
+    if (serial.build_from(more) || parallel.build_from(more, pool) ||
+        !same_build(serial, parallel, source, "existing edge")) {
+      fmt::print(stderr, "Parallel build accepted an edge the graph already had\n");
+      return false;
+    }
+  }
+
+  // Moving out of the source, into flat storage
+  auto moved = source;
+  flat_test_graph_t flat;
+  flat_test_graph_t flat_serial;
+  if (!flat.build_from(std::move(moved), pool) || !moved.edges.front().data.empty() ||
+      !flat_serial.build_from(source) || !same_build(flat_serial, flat, source, "moved")) {
+    fmt::print(stderr, "Parallel build from an rvalue failed\n");
+    return false;
+  }
+  return true;
+}
+
+//! \brief Hop counts of every simple path from one node to another, by brute force
+void simple_path_lengths(
+  const test_data_t& source,
+  const std::string& at,
+  const std::string& to,
+  std::set<std::string>& on_path,
+  std::size_t hops,
+  std::vector<std::size_t>& lengths) {
+
+  if (at == to) {
+    lengths.push_back(hops);
+    return;
+  }
+  on_path.insert(at);
+  for(auto& edge : source.edges) {
+    if (edge.from != at || on_path.count(edge.to)) { continue; }
+    simple_path_lengths(source, edge.to, to, on_path, hops + 1, lengths);
+  }
+  on_path.erase(at);
+}
+
+bool alternate_paths_tests() {
+  // A grid with right and down edges: every corner to corner path is a
+  // fewest-hop path, and there are (2n-2 choose n-1) of them
+  test_data_t grid;
+  const std::size_t n = 6;
+  auto cell = [](std::size_t r, std::size_t c) { return fmt::format("{},{}", r, c); };
+  for(std::size_t r = 0; r < n; r++) {
+    for(std::size_t c = 0; c < n; c++) {
+      grid.nodes.push_back(cell(r, c));
+      if (c + 1 < n) { grid.edges.push_back({cell(r, c), cell(r, c + 1), "right"}); }
+      if (r + 1 < n) { grid.edges.push_back({cell(r, c), cell(r + 1, c), "down"}); }
+    }
+  }
+  test_graph_t graph;
+  graph.build_from(grid);
+
+  auto all = graph.trace_all_shortest(cell(0, 0), cell(n - 1, n - 1));
+  if (!all || all->count() != 252 || all->hops() != 10) {
+    fmt::print(stderr, "Wrong count of corner to corner paths\n");
+    return false;
+  }
+  std::set<std::vector<test_graph_t::node_if*>> seen;
+  for(auto& path : *all) {
+    if (path.nodes.size() != 11 || path.edges.size() != 10 ||
+        *path.nodes.front()->data() != cell(0, 0) || *path.nodes.back()->data() != cell(n - 1, n - 1) ||
+        !seen.insert(path.nodes).second) {
+      fmt::print(stderr, "Enumerated a wrong or repeated shortest path\n");
+      return false;
+    }
+    auto edges = graph.load_edges(path.nodes);
+    for(std::size_t i = 0; i < path.edges.size(); i++) {
+      if (edges->at(i) != path.edges[i]) {
+        fmt::print(stderr, "Shortest path edges do not match its nodes\n");
+        return false;
+      }
+    }
+  }
+  if (seen.size() != 252) {
+    fmt::print(stderr, "Enumerated {} shortest paths, expected 252\n", seen.size());
+    return false;
+  }
+
+  auto self = graph.trace_all_shortest(cell(2, 2), cell(2, 2));
+  if (!self || self->count() != 1 || self->begin()->nodes.size() != 1 ||
+      graph.trace_all_shortest(cell(2, 2), cell(0, 0)).has_value()) {
+    fmt::print(stderr, "Wrong shortest paths for a trivial query\n");
+    return false;
+  }
+
+  // 70 diamonds in a row have 2^70 fewest-hop paths: the count saturates,
+  // and enumeration only ever holds one of them
+  test_graph_t diamonds;
+  diamonds.add_node("d0");
+  for(int i = 0; i < 70; i++) {
+    const auto next = fmt::format("d{}", i + 1);
+    for(const auto* side : {"a", "b"}) {
+      const auto middle = fmt::format("{}{}", side, i);
+      diamonds.add_node(middle);
+      diamonds.add_node(next);
+      diamonds.add_edge(fmt::format("d{}", i), middle, "in");
+      diamonds.add_edge(middle, next, "out");
+    }
+  }
+  auto many = diamonds.trace_all_shortest("d0", "d70");
+  if (!many || many->count() != std::numeric_limits<std::uint64_t>::max()) {
+    fmt::print(stderr, "Path count did not saturate\n");
+    return false;
+  }
+  auto it = many->begin();
+  ++it;
+  if (it == many->end() || *it->nodes[139]->data() != "b69") {
+    fmt::print(stderr, "Second of many paths was wrong\n");
+    return false;
+  }
+
+  // k shortest simple paths against brute force, on random small graphs
+  std::mt19937 rng(31337);
+  for(int round = 0; round < 5; round++) {
+    test_data_t source;
+    std::uniform_int_distribution<int> pick(0, 8);
+    for(int i = 0; i < 9; i++) {
+      source.nodes.push_back(fmt::format("v{}", i));
+    }
+    std::set<std::pair<int, int>> used;
+    while (source.edges.size() < 22) {
+      const int from = pick(rng);
+      const int to = pick(rng);
+      if (from == to || !used.insert({from, to}).second) { continue; }
+      source.edges.push_back({source.nodes[from], source.nodes[to], fmt::format("{}{}", from, to)});
+    }
+    test_graph_t small;
+    small.build_from(source);
+
+    std::vector<std::size_t> expected;
+    std::set<std::string> on_path;
+    simple_path_lengths(source, "v0", "v8", on_path, 0, expected);
+    std::sort(expected.begin(), expected.end());
+
+    for(std::size_t k : {std::size_t{1}, std::size_t{3}, expected.size() + 5}) {
+      auto paths = small.trace_k("v0", "v8", k);
+      if (paths.has_value() == expected.empty()) {
+        fmt::print(stderr, "trace_k disagrees about whether a path exists\n");
+        return false;
+      }
+      if (!paths) { continue; }
+
+      std::vector<std::size_t> lengths;
+      std::set<std::vector<test_graph_t::node_if*>> distinct;
+      for(auto& path : *paths) {
+        std::set<test_graph_t::node_if*> nodes(path.nodes.begin(), path.nodes.end());
+        if (nodes.size() != path.nodes.size() || !distinct.insert(path.nodes).second ||
+            *path.nodes.back()->data() != "v8") {
+          fmt::print(stderr, "trace_k produced a repeated or non-simple path\n");
+          return false;
+        }
+        lengths.push_back(path.edges.size());
+      }
+      const auto want = std::min(k, expected.size());
+      if (lengths.size() != want || !std::equal(lengths.begin(), lengths.end(), expected.begin())) {
+        fmt::print(stderr, "trace_k found {} paths, expected {}\n", lengths.size(), want);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool versioned_tests() {
+  using versioned_t = yokel::versioned_graph_c<std::string, std::string>;
+  versioned_t graph;
+
+  graph.write([](auto& g) {
+    g.add_node("a");
+    g.add_node("b");
+    return g.add_edge("a", "b", "a->b");
+  });
+  auto empty = graph.pin();
+  if (empty.version() != 0 || empty->node_count() != 0) {
+    fmt::print(stderr, "Unpublished changes were visible\n");
+    return false;
+  }
+
+  graph.publish();
+  auto first = graph.pin();
+  graph.write([](auto& g) {
+    g.add_node("c");
+    return g.add_edge("b", "c", "b->c");
+  });
+  graph.publish();
+  auto second = graph.pin();
+
+  // Each reader keeps seeing the version it pinned
+  versioned_t::snapshot_t::path_t path;
+  if (first.version() != 1 || first->trace("a", "c", path) || !first->trace("a", "b", path) ||
+      second.version() != 2 || !second->trace("a", "c", path) || path.size() != 3) {
+    fmt::print(stderr, "Pinned versions saw the wrong graph\n");
+    return false;
+  }
+
+  // Versions 0 and 1 are pinned, so neither may be freed until let go
+  if (graph.retired() != 2) {
+    fmt::print(stderr, "Pinned versions were reclaimed ({} retired)\n", graph.retired());
+    return false;
+  }
+  { auto drop = std::move(empty); }
+  { auto drop = std::move(first); }
+  graph.reclaim();
+  if (graph.retired() != 0) {
+    fmt::print(stderr, "Unpinned versions were not reclaimed ({} retired)\n", graph.retired());
+    return false;
+  }
+
+  // Readers trace a growing chain while a writer extends and publishes
+  // it. Within any one version, the chain must be whole
+  std::atomic<bool> stop{false};
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> readers;
+  for(int t = 0; t < 3; t++) {
+    readers.emplace_back([&]() {
+      versioned_t::snapshot_t::path_t chain;
+      while (!stop.load()) {
+        auto reader = graph.pin();
+        const auto nodes = reader->node_count();
+        if (nodes < 4) { continue; }
+        const auto last = fmt::format("n{}", nodes - 4);
+        if (!reader->trace("n0", last, chain) || chain.size() != nodes - 3) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for(int i = 0; i < 40; i++) {
+    graph.write([i](auto& g) {
+      g.add_node(fmt::format("n{}", i));
+      if (i) { g.add_edge(fmt::format("n{}", i - 1), fmt::format("n{}", i), "next"); }
+    });
+    graph.publish();
+  }
+  stop = true;
+  for(auto& reader : readers) {
+    reader.join();
+  }
+  if (failed || graph.version() != 42) {
+    fmt::print(stderr, "A reader saw a torn version\n");
+    return false;
+  }
+  { auto drop = std::move(second); }
+  graph.reclaim();
+  if (graph.retired() != 0) {
+    fmt::print(stderr, "Versions were left unreclaimed ({} retired)\n", graph.retired());
+    return false;
+  }
+
+  // A publish rebuilds only the pages holding changed nodes
+  versioned_t large;
+  large.write([](auto& g) {
+    for(int i = 0; i < 1000; i++) {
+      g.add_node(fmt::format("m{}", i));
+      if (i) { g.add_edge(fmt::format("m{}", i - 1), fmt::format("m{}", i), "next"); }
+    }
+  });
+  large.publish();
+  auto before = large.pin();
+  large.write([](auto& g) { return g.add_edge("m500", "m10", "back"); });
+  large.publish();
+  auto after = large.pin();
+  const auto pages = (after->index_limit() + 63) / 64;
+  if (after->shared_pages(*before) != pages - 1 || !after->get_edge(*after->index_of("m500"), *after->index_of("m10")) ||
+      before->get_edge(*before->index_of("m500"), *before->index_of("m10"))) {
+    fmt::print(stderr, "A small write did not share the unchanged pages ({} of {})\n",
+               after->shared_pages(*before), pages);
+    return false;
+  }
+
+  // Removing a node leaves its slot dead, and adding the id back gives
+  // it a new one
+  large.write([](auto& g) { return g.remove_node("m20"); });
+  large.publish();
+  auto removed = large.pin();
+  if (removed->index_of("m20") || removed->node_count() != 999 || removed->trace("m0", "m30", path)) {
+    fmt::print(stderr, "A removed node was still seen\n");
+    return false;
+  }
+  large.write([](auto& g) {
+    g.add_node("m20");
+    g.add_edge("m19", "m20", "next");
+    return g.add_edge("m20", "m21", "next");
+  });
+  large.publish();
+  auto readded = large.pin();
+  if (!readded->index_of("m20") || readded->id_of(*readded->index_of("m20")) != "m20" ||
+      !readded->trace("m0", "m30", path) || path.size() != 31 || removed->trace("m0", "m30", path)) {
+    fmt::print(stderr, "A re-added node was not seen\n");
+    return false;
+  }
+
+  // Edge data edited in place is seen once its source is marked
+  large.write([](auto& g) {
+    const auto from = *g.index_of("m20");
+    g.for_each_out(from, [&](const std::uint32_t&, const std::uint32_t& edge) {
+      g.edge_data(edge) = "a much longer edge";
+    });
+    g.mark_changed(from);
+  });
+  large.publish();
+  auto marked = large.pin();
+  const auto cost = [](const std::string& edge) { return edge.size(); };
+  auto cheapest = marked->trace_weighted(*marked->index_of("m19"), *marked->index_of("m21"), cost, path);
+  if (!cheapest || *cheapest != 4 + 18 || *readded->get_edge(*readded->index_of("m20"), *readded->index_of("m21")) != "next") {
+    fmt::print(stderr, "An edge edited in place was not published\n");
+    return false;
+  }
+
+  // Compacting renumbers every node, so nothing can be shared
+  large.write([](auto& g) { g.compact(); });
+  large.publish();
+  auto compacted = large.pin();
+  if (compacted->shared_pages(*marked) != 0 || compacted->index_limit() != 1000 ||
+      !compacted->trace("m0", "m999", path) || path.size() != 1000) {
+    fmt::print(stderr, "A compacted graph was published wrong\n");
+    return false;
+  }
+  return true;
+}
+
+//! \brief Coroutine that starts at once and frees itself when it ends
+struct detached_s {
+  struct promise_type {
+    detached_s get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+using async_tracer_t = yokel::async_tracer_c<test_graph_t>;
+
+detached_s await_trace(async_tracer_t& tracer, std::string from, std::string to,
+                       std::optional<test_graph_t::node_list_t>& result, std::latch& done) {
+  result = co_await tracer.trace_async(from, to);
+  done.count_down();
+}
+
+// Awaits one trace and, once resumed on the worker, another, before
+// reading the tracer's stats
+detached_s await_chained(async_tracer_t& tracer, std::string from, std::string to, std::atomic<int>& stage) {
+  auto first = co_await tracer.trace_async(from, to);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto second = co_await tracer.trace_async(to, from);
+  stage = (first.has_value() && tracer.stats().searches == 2 && !second) ? 2 : 1;
+}
+
+bool async_trace_tests() {
+  test_graph_t graph;
+  const std::size_t chain = 200;
+  for(std::size_t n = 0; n < chain; n++) {
+    graph.add_node(std::to_string(n));
+  }
+  for(std::size_t n = 0; n + 1 < chain; n++) {
+    graph.add_edge(std::to_string(n), std::to_string(n + 1), "");
+  }
+  const auto last = std::to_string(chain - 1);
+
+  yokel::thread_pool_c pool(1);
+  async_tracer_t tracer(graph, pool);
+
+  // Hold the only worker so every request arrives while its search waits
+  std::latch gate(1);
+  pool.submit([&]() { gate.wait(); });
+
+  const std::size_t same = 8;
+  std::vector<std::optional<test_graph_t::node_list_t>> results(same + 2);
+  std::latch done(static_cast<std::ptrdiff_t>(results.size()));
+  for(std::size_t i = 0; i < same; i++) {
+    await_trace(tracer, "0", last, results[i], done);
+  }
+  await_trace(tracer, last, "0", results[same], done);
+  await_trace(tracer, "0", "nowhere", results[same + 1], done);
+
+  auto stats = tracer.stats();
+  if (stats.requests != same + 2 || stats.immediate != 1 || stats.searches != 2 || stats.merged != same - 1) {
+    fmt::print(stderr, "Async requests were not merged ({} requests, {} immediate, {} searches, {} merged)\n",
+               stats.requests, stats.immediate, stats.searches, stats.merged);
+    return false;
+  }
+  gate.count_down();
+  done.wait();
+
+  for(std::size_t i = 0; i < same; i++) {
+    if (!results[i] || results[i]->size() != chain) {
+      fmt::print(stderr, "A merged request got the wrong path\n");
+      return false;
+    }
+  }
+  if (results[same] || results[same + 1]) {
+    fmt::print(stderr, "Async trace found a path that does not exist\n");
+    return false;
+  }
+
+  // The search filled the cache, so the pair is now answered at once
+  std::latch again(1);
+  std::optional<test_graph_t::node_list_t> cached;
+  await_trace(tracer, "0", last, cached, again);
+  stats = tracer.stats();
+  if (!cached || cached->size() != chain || stats.immediate != 2 || stats.searches != 2) {
+    fmt::print(stderr, "Async trace did not use the cache\n");
+    return false;
+  }
+
+  // A pair with no path is searched once, then answered from the pairs
+  // known unreachable until the graph changes
+  const std::size_t repeats = 5;
+  std::vector<std::optional<test_graph_t::node_list_t>> unreachable(repeats);
+  std::latch repeated(static_cast<std::ptrdiff_t>(repeats));
+  for(auto& result : unreachable) {
+    await_trace(tracer, last, "0", result, repeated);
+  }
+  repeated.wait();
+  stats = tracer.stats();
+  if (stats.searches != 2 || stats.unreachable != repeats || stats.immediate != 2 + repeats ||
+      std::any_of(unreachable.begin(), unreachable.end(), [](auto& r) { return r.has_value(); })) {
+    fmt::print(stderr, "Unreachable pairs were searched again ({} searches, {} unreachable)\n",
+               stats.searches, stats.unreachable);
+    return false;
+  }
+  graph.add_edge(last, "0", "");
+  std::latch changed(1);
+  std::optional<test_graph_t::node_list_t> now_reachable;
+  await_trace(tracer, last, "0", now_reachable, changed);
+  changed.wait();
+  if (!now_reachable || now_reachable->size() != 2 || tracer.stats().searches != 3) {
+    fmt::print(stderr, "A pair known unreachable was not searched after the graph changed\n");
+    return false;
+  }
+
+  // Only the most recent max_unreachable pairs are remembered
+  {
+    test_graph_t sparse(false);
+    for(auto* name : {"a", "b", "c"}) {
+      sparse.add_node(name);
+    }
+    yokel::thread_pool_c one(1);
+    async_tracer_t bounded(sparse, one, 1);
+    for(auto [from, to] : {std::pair{"a", "b"}, std::pair{"a", "c"}, std::pair{"a", "c"}, std::pair{"a", "b"}}) {
+      std::latch one_done(1);
+      std::optional<test_graph_t::node_list_t> none;
+      await_trace(bounded, from, to, none, one_done);
+      one_done.wait();
+    }
+    if (bounded.stats().searches != 3 || bounded.stats().unreachable != 1) {
+      fmt::print(stderr, "Unreachable pairs were not bounded ({} searches)\n", bounded.stats().searches);
+      return false;
+    }
+  }
+
+  // The tracer is not destroyed while a resumed waiter is still using it
+  {
+    test_graph_t chained(false);
+    chained.build_from(graph_one().data);
+    yokel::thread_pool_c one(1);
+    std::atomic<int> stage{0};
+    {
+      async_tracer_t chained_tracer(chained, one);
+      await_chained(chained_tracer, "A", "C", stage);
+    }
+    if (stage != 2) {
+      fmt::print(stderr, "Async tracer was destroyed under a running waiter\n");
+      return false;
+    }
+  }
+
+  // Many coroutines over a handful of pairs, on several workers
+  yokel::thread_pool_c workers(4);
+  test_graph_t wide(false);
+  wide.build_from(graph_one().data);
+  yokel::async_tracer_c<test_graph_t> wide_tracer(wide, workers);
+  const std::vector<std::string> names = {"A", "B", "C", "D", "E", "F", "G", "H"};
+  std::vector<std::optional<test_graph_t::node_list_t>> many(names.size() * names.size() * 4);
+  std::latch all(static_cast<std::ptrdiff_t>(many.size()));
+  for(std::size_t i = 0; i < many.size(); i++) {
+    await_trace(wide_tracer, names[i % names.size()], names[(i / names.size()) % names.size()], many[i], all);
+  }
+  all.wait();
+  for(std::size_t i = 0; i < many.size(); i++) {
+    const auto& from = names[i % names.size()];
+    const auto& to = names[(i / names.size()) % names.size()];
+    auto expected = wide.trace(from, to);
+    if (expected.has_value() != many[i].has_value() || (expected && expected->size() != many[i]->size())) {
+      fmt::print(stderr, "Async trace from {} to {} disagrees with trace\n", from, to);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(void) {
+  for(std::size_t i = 0; i < TEST_ITERATIONS; i++) {
+    for(auto strategy : {
+        test_graph_t::search_strategy_e::BREADTH_FIRST,
+        test_graph_t::search_strategy_e::BIDIRECTIONAL
+        }) {
+      if (!graph_tests<test_graph_t>(strategy) ||
+          !graph_tests<flat_test_graph_t>(
+            static_cast<flat_test_graph_t::search_strategy_e>(strategy))) {
+        fmt::print(stderr, "Failure\n");
+        return 1;
+      }
+    }
+    if (!frozen_tests() || !wide_search_tests() || !edge_key_tests() || !direct_storage_tests() || !concurrent_trace_tests() ||
+        !batch_tests() || !path_tree_tests() ||
+        !cache_invalidation_tests() ||
+        !bounded_cache_tests() ||
+        !component_tests() ||
+        !reachability_tests() ||
+        !path_view_tests() ||
+        !indexed_path_tests() ||
+        !trace_with_edges_tests() ||
+        !weighted_tests() ||
+        !mapped_graph_tests() ||
+        !stream_tests() ||
+        !allocator_tests() ||
+        !removal_tests() ||
+        !move_tests() ||
+        !graph_move_tests() ||
+        !stats_tests() ||
+        !parallel_build_tests() ||
+        !alternate_paths_tests() ||
+        !versioned_tests() ||
+        !cache_file_tests() ||
+        !async_trace_tests()) {
       fmt::print(stderr, "Failure\n");
       return 1;
     }
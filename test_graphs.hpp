@@ -0,0 +1,299 @@
+#ifndef YOKEL_TEST_GRAPHS_HPP
+#define YOKEL_TEST_GRAPHS_HPP
+
+// Hand-drawn graphs with known paths, shared by test.cpp and bench.cpp
+
+#include "YokelGraph/Graph.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using test_graph_t = yokel::graph_c<std::string, std::string>;
+using test_data_t = test_graph_t::source_s;
+
+struct test_graph_s {
+  struct path_s {
+    std::string from;
+    std::string to;
+    std::size_t expected_distance{0};
+    std::vector<std::string> expected_path;
+    bool possible{true};
+  };
+  test_data_t data;
+  std::vector<path_s> paths;
+  bool contains_cycles{true};
+};
+
+test_graph_s graph_one() {
+/*
+           ┌────────┐
+           │        │
+           │   G─┐  │
+           │   ▲ │  ▼
+      ┌──► A ──┘ │  B ◄──┐
+      │    │     │       │
+      E ◄──┘     └─────► F ◄┐
+      │                  │  │
+      └──► C ◄───── D ◄──┘  │
+           │                │
+           └─► H ───────────┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E", "F", "G", "H"},
+      {
+        {"A", "G", "A->G"},
+        {"A", "E", "A->E"},
+        {"A", "B", "A->B"},
+        {"E", "A", "E->A"},
+        {"E", "C", "E->C"},
+        {"C", "H", "C->H"},
+        {"G", "F", "G->F"},
+        {"H", "F", "H->F"},
+        {"D", "C", "D->C"},
+        {"F", "B", "F->B"},
+        {"F", "D", "F->D"},
+      }
+    },
+    {
+      {"E", "C", 1, {"E->C"}},
+      {"A", "C", 2, {"A->E", "E->C"}},
+      {"G", "H", 4, {"G->F", "F->D", "D->C", "C->H"}},
+      {"F", "H", 3, {"F->D", "D->C", "C->H"}},
+      {"F", "A", 0, {}, false},
+    }
+  };
+}
+
+test_graph_s graph_two() {
+/*
+              ┌────┐
+              │    │
+        ┌────►B◄───┘
+        │     │
+        │     │
+        A     └───►C
+                   │
+                   │
+        E◄────D◄───┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E"},
+      {
+        {"A", "B", "A->B"},
+        {"B", "B", "B->B"},
+        {"B", "C", "B->C"},
+        {"C", "D", "C->D"},
+        {"D", "E", "D->E"},
+      }
+    },
+    {
+      {"B", "B", 1, {"B->B"}},
+      {"B", "A", 0, {}, false},
+      {"A", "C", 2, {"A->B", "B->C"}},
+      {"A", "E", 4, {"A->B", "B->C", "C->D", "D->E"}},
+    }
+  };
+} 
+
+test_graph_s graph_three() {
+/*
+            ┌────┐
+            │    │
+      ┌────►B◄───┘
+      │     │
+      │     │
+      A     └───►C────┐
+                 │    │
+                 │    │
+      E◄────D◄───┘    │
+      ▲               │
+      │               │
+      └───────────────┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E"},
+      {
+        {"A", "B", "A->B"},
+        {"B", "B", "B->B"},
+        {"B", "C", "B->C"},
+        {"C", "D", "C->D"},
+        {"D", "E", "D->E"},
+        {"C", "E", "C->E"},
+      }
+    },
+    {
+      {"B", "B", 1, {"B->B"}},
+      {"A", "C", 2, {"A->B", "B->C"}},
+      {"A", "E", 3, {"A->B", "B->C", "C->E"}},
+      {"X", "Y", 0, {}, false}, // no exist
+      {"Y", "Z", 0, {}, false}, // no exist
+      {"Z", "Z", 0, {}, false}, // no exist
+    }
+  };
+} 
+
+test_graph_s graph_four() {
+/*
+            ┌────────────────────────┐
+            │                        │
+            ▼                        │
+            B  ◄──────── C ◄──────── D ◄────────┐
+                                                │
+    A         ┌───────► E────────────► F ───────┘
+    │         │         │
+    │         │         │
+    └───────► G ◄───────┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E", "F", "G"},
+      {
+        {"A", "G", "A->G"},
+        {"G", "E", "G->E"},
+        {"E", "G", "E->G"},
+        {"E", "F", "E->F"},
+        {"F", "D", "F->D"},
+        {"D", "C", "D->C"},
+        {"D", "B", "D->B"},
+        {"C", "B", "C->B"},
+      }
+    },
+    {
+      {"A", "B", 5, {"A->G", "G->E", "E->F", "F->D", "D->B"}},
+      {"D", "B", 1, {"D->B"}},
+      {"E", "G", 1, {"E->G"}},
+      {"B", "A", 0, {}, false},
+      {"B", "A", 0, {}, false},
+      {"X", "Y", 0, {}, false}, // no exist
+      {"Y", "Z", 0, {}, false}, // no exist
+      {"Z", "Z", 0, {}, false}, // no exist
+    }
+  };
+} 
+
+test_graph_s graph_five() {
+/*
+    A────►C
+    │     │
+    └┐    └─►F
+     ▼       │
+     B─────┐ └──►G
+     │     │     │
+     ▼     ▼     └──►H
+     D     E
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E", "F", "G", "H"},
+      {
+        {"A", "B", "A->B"},
+        {"B", "D", "B->D"},
+        {"B", "E", "B->E"},
+        {"A", "C", "A->C"},
+        {"C", "F", "C->F"},
+        {"F", "G", "F->G"},
+        {"G", "H", "G->H"},
+      }
+    },
+    {
+      {"A", "H", 4, {"A->C", "C->F", "F->G", "G->H"}},
+      {"A", "D", 2, {"A->B", "B->D"}},
+      {"A", "E", 2, {"A->B", "B->E"}},
+      {"F", "H", 2, {"F->G", "G->H"}},
+      {"E", "H", 0, {}, false},
+      {"H", "A", 0, {}, false},
+      {"X", "Y", 0, {}, false}, // no exist
+      {"Y", "Z", 0, {}, false}, // no exist
+      {"Z", "Z", 0, {}, false}, // no exist
+    },
+    false // no cycles
+  };
+}
+
+test_graph_s graph_six() {
+/*
+                  ┌──────────────────┐
+                  │                  ▼
+       ┌─────────►B───────┐          I
+       │          ▲       ▼
+       │          │       E◄───┐
+       │          │       │    │
+       │          C◄──────┘    │
+       │                       └───H◄─┐
+       │                              │
+   ┌──►A─────────────────►F───────┐   │
+   │   │                  ▲       ▼   │
+   │   │                  │       G───┘
+   │   └─────────►D───────┘
+   │              │
+   └──────────────┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D", "E", "F", "G", "H", "I"},
+      {
+        {"A", "F", "A->F"},
+        {"A", "D", "A->D"},
+        {"A", "B", "A->B"},
+        {"D", "A", "D->A"},
+        {"D", "F", "D->F"},
+        {"F", "G", "F->G"},
+        {"G", "H", "G->H"},
+        {"H", "E", "H->E"},
+        {"E", "C", "E->C"},
+        {"C", "B", "C->B"},
+        {"B", "I", "B->I"},
+        {"B", "E", "B->E"},
+      }
+    },
+    {
+      {"A", "I", 2, {"A->B", "B->I"}},
+      {"D", "I", 3, {"D->A", "A->B", "B->I"}},
+      {"F", "I", 6, {"F->G", "G->H", "H->E", "E->C", "C->B", "B->I"}},
+      {"C", "E", 2, {"C->B", "B->E"}},
+      {"I", "F", 0, {}, false},
+    },
+  };
+}
+
+test_graph_s graph_seven() {
+/*
+         ┌──────────┐
+         │          │
+         │          ▼
+    ┌──► A─────┐    B◄───┐
+    │    │     │    │    │
+    │    │     │    │    │
+    │    │     │    │    │
+    │    ▼     │    ▼    │
+    │    C     └───►D────┘
+    │               │
+    │               │
+    └───────────────┘
+*/
+  return test_graph_s{
+    {
+      {"A", "B", "C", "D"},
+      {
+        {"A", "D", "A->D"},
+        {"A", "B", "A->B"},
+        {"A", "C", "A->C"},
+        {"D", "B", "D->B"},
+        {"D", "A", "D->A"},
+        {"B", "D", "B->D"},
+      }
+    },
+    {
+      {"A", "C", 1, {"A->C"}},
+      {"B", "C", 3, {"B->D", "D->A", "A->C"}},
+    },
+  };
+}
+} // namespace
+
+#endif